@@ -0,0 +1,73 @@
+/// Two-pass rendering which lays down depth before running expensive fragment shaders.
+
+#if ! defined(__THEIA_GFX_DEPTH_PREPASS__)
+#define __THEIA_GFX_DEPTH_PREPASS__
+
+#include <stdint.h>
+#include <boost/shared_ptr.hpp>
+#include <theia/graphics/frame_sync.h>
+#include <theia/graphics/gl/gl_loader.h>
+
+namespace theia
+{
+  struct DepthPrepass;
+  typedef boost::shared_ptr<DepthPrepass> DepthPrepassPtr;
+
+  /// Samples counted by GL_SAMPLES_PASSED queries, summed over the frames collected so far.
+  struct DepthPrepassStats
+  {
+    DepthPrepassStats() : frames(0), droppedFrames(0), depthSamples(0), shadedSamples(0) { }
+
+    int       frames;
+    int       droppedFrames;  // whose queries hadn't finished when their slot came round again
+    uint64_t  depthSamples;   // samples passing GL_LESS in the depth pass: what shading would have cost without it
+    uint64_t  shadedSamples;  // samples which ran the shading pass's fragment shader
+  };
+
+  /// Sets up the depth state for drawing a scene once or twice.
+  ///
+  /// With a pre-pass, the scene is first drawn with a position-only program and colour
+  /// writes off, then drawn again with the real program, depth writes off and GL_EQUAL, so
+  /// that only the nearest sample of each pixel is ever shaded. Both programs must compute
+  /// exactly the same positions, so their vertex stages should declare
+  /// "invariant gl_Position".
+  ///
+  /// Each pass counts its samples with an occlusion query. The queries are read a few
+  /// frames later, once they have finished, so measuring doesn't stall the pipeline; frames
+  /// whose queries still haven't finished by then are dropped rather than waited for.
+  struct DepthPrepass
+  {
+    /// Number of frames of queries in flight: one more than the CPU can be ahead of the GPU.
+    static const int Latency = FrameSync::MaxFramesInFlight + 1;
+
+    static DepthPrepassPtr Create();
+
+    ~DepthPrepass();
+
+    /// Start the depth-only pass of a frame.
+    void BeginDepthPass();
+
+    /// Start the shading pass of a frame, testing for equality with the depth laid down by
+    /// the depth pass if there was one this frame, or as a normal depth-tested pass if not.
+    void BeginShadingPass();
+
+    /// Finish the frame's passes and restore the default depth state: GL_LESS with depth
+    /// and colour writes on.
+    void End();
+
+    DepthPrepassStats stats;
+
+  private:
+    DepthPrepass();
+
+    void EndQuery();
+    void CollectFrame(int slot);
+
+    GLuint  queries[Latency][2];  // depth pass and shading pass of each frame
+    bool    used[Latency][2];
+    int     slot;                 // frame being recorded
+    int     activePass;           // pass whose query is running, or -1
+  };
+}
+
+#endif // __THEIA_GFX_DEPTH_PREPASS__
@@ -0,0 +1,55 @@
+/// Batched submission of indexed draws which share a program and vertex array object.
+
+#if ! defined(__THEIA_GFX_DRAW_BATCH__)
+#define __THEIA_GFX_DRAW_BATCH__
+
+#include <vector>
+#include <theia/graphics/indirect_buffer.h>
+#include <theia/graphics/gl/gl_loader.h>
+
+namespace theia
+{
+  /// Collects draw commands and issues them all with a single call: glMultiDrawElementsIndirect
+  /// where GL 4.3 is available, otherwise glMultiDrawElementsBaseVertex.
+  ///
+  /// The fallback cannot pass instanceCount or baseInstance, so shaders which need to know
+  /// which draw they belong to should derive it from gl_VertexID (which includes the base
+  /// vertex) rather than from gl_InstanceID or an instanced attribute.
+  struct DrawBatch
+  {
+    DrawBatch();
+
+    /// Whether the driver provides glMultiDrawElementsIndirect.
+    static bool IsIndirectSupported();
+
+    void Clear();
+
+    /// Append a command.
+    ///
+    /// @param[in] count        Number of indices to draw.
+    /// @param[in] firstIndex   Offset into the index buffer, in indices.
+    /// @param[in] baseVertex   Value added to each index.
+    /// @param[in] baseInstance Only honoured on the indirect path.
+    void Add(GLuint count, GLuint firstIndex, GLint baseVertex, GLuint baseInstance);
+
+    /// Issue every command. The caller must have bound the vertex array object and program.
+    ///
+    /// @param[in] mode       Primitive type, e.g. GL_TRIANGLES.
+    /// @param[in] indexType  GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+    void Submit(GLenum mode, GLenum indexType);
+
+    bool useIndirect; // defaults to IsIndirectSupported(); may be cleared to compare the two paths
+
+    std::vector<DrawElementsIndirectCommand> commands; // call Clear and Add rather than editing directly
+    IndirectBufferPtr indirect;
+    size_t            indirectCapacity; // in commands
+    bool              indirectDirty;    // commands have changed since they were last uploaded
+
+    // Scratch arrays for glMultiDrawElementsBaseVertex...
+    std::vector<GLsizei>      counts;
+    std::vector<const void*>  offsets;
+    std::vector<GLint>        baseVertices;
+  };
+}
+
+#endif // __THEIA_GFX_DRAW_BATCH__
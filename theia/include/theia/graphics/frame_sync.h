@@ -0,0 +1,78 @@
+/// Bounds how far the CPU can run ahead of the GPU.
+
+#if ! defined(__THEIA_GFX_FRAME_SYNC__)
+#define __THEIA_GFX_FRAME_SYNC__
+
+#include <stdint.h>
+#include <boost/shared_ptr.hpp>
+#include <theia/graphics/gl/gl_loader.h>
+
+namespace theia
+{
+  struct FrameSync;
+  typedef boost::shared_ptr<FrameSync> FrameSyncPtr;
+
+  /// How often, and for how long, the CPU waited for the GPU to catch up.
+  struct FrameSyncStats
+  {
+    FrameSyncStats() : frames(0), stalls(0), waitMS(0) { }
+
+    int     frames;
+    int     stalls;   // frames which had to wait
+    double  waitMS;
+  };
+
+  /// Puts a fence after each frame's commands and, before the CPU starts frame N, waits for
+  /// the fence of frame N - framesInFlight. Without it the driver decides how many frames to
+  /// queue after a swap, which adds input latency or stalls at unpredictable points; with it
+  /// the overlap between CPU and GPU is explicit. One frame in flight gives the least latency
+  /// and no overlap; each extra frame trades a frame of latency for more slack.
+  ///
+  /// Each of the frames in flight has a slot, which resources rewritten every frame, such as
+  /// streamed buffers, can be indexed by: once BeginFrame returns a slot, the GPU has finished
+  /// with whatever the slot's resources held the last time round.
+  ///
+  /// Without fence syncs (before GL 3.2) the slots still rotate but nothing is waited for.
+  struct FrameSync
+  {
+    static const int MaxFramesInFlight = 4;
+
+    /// Whether the driver provides glFenceSync.
+    static bool IsSupported();
+
+    /// @param[in] framesInFlight From 1 to MaxFramesInFlight.
+    static FrameSyncPtr Create(int framesInFlight = 2);
+
+    ~FrameSync();
+
+    /// Wait until the GPU has finished the frame which last used the next slot, and return
+    /// that slot, from 0 to FramesInFlight() - 1.
+    int BeginFrame();
+
+    /// Fence the commands of the frame started by BeginFrame. Call after the swap, so that
+    /// the fence covers it too.
+    void EndFrame();
+
+    /// Change the number of frames in flight, first waiting for every frame still in flight.
+    void SetFramesInFlight(int count);
+
+    int FramesInFlight() const { return framesInFlight; }
+
+    /// Number of frames started so far.
+    uint64_t Frame() const { return frame; }
+
+    FrameSyncStats stats;
+
+  private:
+    FrameSync(int framesInFlight);
+
+    void WaitForSlot(int index);
+
+    GLsync    fences[MaxFramesInFlight];
+    int       framesInFlight;
+    int       slot;   // of the frame being recorded
+    uint64_t  frame;
+  };
+}
+
+#endif // __THEIA_GFX_FRAME_SYNC__
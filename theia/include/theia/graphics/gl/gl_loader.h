@@ -5,6 +5,8 @@
 #define GL_LOADER
 
 #include <theia/graphics/gl/gl_4_3.h>
-#include <theia/graphics/gl/wgl_wgl.h>
+#if defined(_WIN32)
+  #include <theia/graphics/gl/wgl_wgl.h>
+#endif
 
 #endif // GL_LOADER
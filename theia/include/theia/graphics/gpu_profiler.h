@@ -0,0 +1,98 @@
+/// Timing of GPU work with timestamp queries.
+
+#if ! defined(__THEIA_GFX_GPU_PROFILER__)
+#define __THEIA_GFX_GPU_PROFILER__
+
+#include <stdint.h>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <theia/graphics/frame_sync.h>
+#include <theia/graphics/gl/gl_loader.h>
+#include <theia/misc/profiler.h>
+
+namespace theia
+{
+  struct GpuProfiler;
+  typedef boost::shared_ptr<GpuProfiler> GpuProfilerPtr;
+
+  /// Times scopes of GL commands as the GPU runs them. Each scope writes a GL_TIMESTAMP at
+  /// its start and end, so scopes may nest, unlike GL_TIME_ELAPSED queries. Each frame has
+  /// its own set of queries, read back Latency frames later when they should have finished,
+  /// so measuring doesn't stall the pipeline; frames whose queries still haven't finished by
+  /// then are dropped rather than waited for.
+  ///
+  /// Results go into a summary, and onto a "GPU" track of the CPU profiler with the times
+  /// converted to its clock, so GPU scopes line up with the CPU scopes which issued them in
+  /// a trace. Only ARB_timer_query (GL 3.3) is needed, which Mesa's software rasterisers
+  /// also provide; without it every call does nothing.
+  struct GpuProfiler
+  {
+    /// Number of frames of queries in flight: one more than the CPU can be ahead of the GPU.
+    static const int Latency = FrameSync::MaxFramesInFlight + 1;
+
+    /// Scopes which can be timed in a frame. Any more are ignored.
+    static const int MaxScopes = 64;
+
+    /// Whether the driver provides timestamp queries.
+    static bool IsSupported();
+
+    static GpuProfilerPtr Create();
+
+    ~GpuProfiler();
+
+    /// Collect the results of the frame Latency frames ago and start recording a new one.
+    void BeginFrame();
+
+    /// Start timing a scope, returning its index for EndScope, or -1 if it won't be timed.
+    /// The name must outlive the profiler, so is normally a string literal.
+    int BeginScope(const char* name);
+    void EndScope(int scope);
+
+    /// Fill entries with the GPU time spent in each scope since the last call, most expensive
+    /// first, and return the number of frames they cover.
+    int TakeSummary(std::vector<ProfileSummaryEntry>& entries);
+
+    int droppedFrames;  // frames whose queries hadn't finished in time
+
+  private:
+    GpuProfiler();
+
+    void Collect(int frame);
+    void Calibrate();
+
+    GLuint      queries[Latency][MaxScopes * 2];  // start and end of each scope
+    const char* names[Latency][MaxScopes];
+    bool        ended[Latency][MaxScopes];
+    int         numScopes[Latency];
+    int         lastQuery[Latency];           // index of the query issued most recently
+    int         slot;           // frame being recorded
+    int         track;          // in the CPU profiler
+    int64_t     clockOffset;    // from GPU to CPU profiler nanoseconds
+    int         framesSinceCalibration;
+
+    std::vector<ProfileSummaryEntry> summary;
+    int         summaryFrames;
+  };
+
+  /// Times the GL commands issued during its lifetime.
+  struct GpuProfileScope
+  {
+    GpuProfileScope(GpuProfiler& profiler, const char* name)
+      : profiler(profiler), scope(profiler.BeginScope(name))
+    {
+    }
+
+    ~GpuProfileScope()
+    {
+      profiler.EndScope(scope);
+    }
+
+  private:
+    GpuProfileScope& operator=(const GpuProfileScope&);
+
+    GpuProfiler&  profiler;
+    int           scope;
+  };
+}
+
+#endif // __THEIA_GFX_GPU_PROFILER__
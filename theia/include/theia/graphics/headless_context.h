@@ -0,0 +1,62 @@
+/// A GL context with no window, for running unattended.
+
+#if ! defined(__THEIA_GFX_HEADLESS_CONTEXT__)
+#define __THEIA_GFX_HEADLESS_CONTEXT__
+
+#include <stdint.h>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <theia/graphics/gl/gl_loader.h>
+
+namespace theia
+{
+  struct HeadlessContext;
+  typedef boost::shared_ptr<HeadlessContext> HeadlessContextPtr;
+
+  /// Creates a GL context through EGL with no window and no display connection, and renders
+  /// into a framebuffer object in place of a window's back buffer. This runs wherever EGL
+  /// does, including Mesa's llvmpipe on a machine with no GPU, so that a scene can be drawn by
+  /// an automated benchmark or regression test. Frames can be read back and saved as PNGs.
+  ///
+  /// Only available when built with THEIA_EGL defined; otherwise Create fails.
+  struct HeadlessContext
+  {
+    /// Whether this build can create headless contexts at all.
+    static bool IsSupported();
+
+    /// Create a context, make it current on the calling thread, load the GL functions and bind
+    /// a width x height framebuffer with colour and depth attachments. Returns NULL on failure.
+    static HeadlessContextPtr Create(int width, int height);
+
+    ~HeadlessContext();
+
+    /// End a frame, in place of swapping buffers. Rebinds the framebuffer, in case the frame
+    /// bound another.
+    void Present();
+
+    /// Read the framebuffer back as rows of 8 bit RGBA, top row first. This waits for the GPU
+    /// to finish the frame, so costs far more than the frame itself on a real GPU.
+    void ReadPixels(std::vector<uint8_t>& rgba) const;
+
+    /// Read the framebuffer back and write it to a PNG file.
+    bool SaveFrame(const char* path) const;
+
+    int     width;
+    int     height;
+    GLuint  framebuffer;
+    GLuint  colour;       // renderbuffers
+    GLuint  depth;
+
+  private:
+    HeadlessContext(int width, int height);
+
+    bool CreateContext();
+    bool CreateFramebuffer();
+
+    void*   display;      // EGL handles, kept opaque so EGL's headers don't leak
+    void*   surface;
+    void*   context;
+  };
+}
+
+#endif // __THEIA_GFX_HEADLESS_CONTEXT__
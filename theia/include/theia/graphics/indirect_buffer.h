@@ -0,0 +1,36 @@
+#if ! defined(__INDIRECT_BUFFER__)
+#define __INDIRECT_BUFFER__
+
+#include <boost/shared_ptr.hpp>
+#include <theia/graphics/gl/gl_loader.h>
+
+namespace theia
+{
+  struct IndirectBuffer;
+  typedef boost::shared_ptr<IndirectBuffer> IndirectBufferPtr;
+
+  /// Layout of one command read by glMultiDrawElementsIndirect.
+  struct DrawElementsIndirectCommand
+  {
+    GLuint  count;          // number of indices
+    GLuint  instanceCount;
+    GLuint  firstIndex;     // offset into the index buffer, in indices
+    GLint   baseVertex;     // added to each index
+    GLuint  baseInstance;
+  };
+
+  /// A buffer of draw commands bound to GL_DRAW_INDIRECT_BUFFER.
+  struct IndirectBuffer
+  {
+    GLuint buffer;
+
+    static IndirectBufferPtr Create(size_t sizeInBytes);
+
+    IndirectBuffer();
+    ~IndirectBuffer();
+
+    void SetData(size_t sizeInBytes, size_t offsetInBytes, const void* const data);
+  };
+}
+
+#endif // __INDIRECT_BUFFER__
@@ -0,0 +1,47 @@
+/// Reordering of mesh indices for the post-transform vertex cache.
+
+#if ! defined(__THEIA_GRAPHICS_MESH_OPTIMISER__)
+#define __THEIA_GRAPHICS_MESH_OPTIMISER__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace theia
+{
+  namespace MeshOptimiser
+  {
+    /// A cache size which suits most hardware when the real one isn't known.
+    static const int DefaultCacheSize = 24;
+
+    /// Results of running an index list through a simulated FIFO vertex cache.
+    struct CacheStats
+    {
+      size_t numTriangles;
+      size_t numVertices;   // distinct vertices referenced by the indices
+      size_t transforms;    // cache misses, i.e. vertex shader invocations
+      float  acmr;          // average cache miss ratio: transforms per triangle (0.5 is ideal for a large grid, 3 is the worst)
+      float  atvr;          // average transformed vertex ratio: transforms per vertex (1 is ideal)
+    };
+
+    /// Simulate a FIFO post-transform cache over a triangle list.
+    ///
+    /// @param[in] numVertices One more than the largest index.
+    CacheStats AnalyseCache(const uint32_t* indices, size_t numIndices, size_t numVertices, int cacheSize);
+
+    /// Convert a triangle strip into a triangle list with the same winding. Triangles with a
+    /// repeated index (the ones used to join strips) are dropped.
+    void StripToList(const uint32_t* strip, size_t numIndices, std::vector<uint32_t>& list);
+
+    /// Reorder the triangles of a list so that vertices are reused while they're still in
+    /// the cache, using the Tipsify algorithm (Sander, Nehab & Barczak, 2007). Runs in time
+    /// linear in the size of the mesh and keeps the winding of every triangle.
+    ///
+    /// @param[in]  numVertices One more than the largest index.
+    /// @param[in]  cacheSize   Size of the cache to optimise for.
+    /// @param[out] output      Receives numIndices indices; must not overlap the input.
+    void OptimiseTriangleList(const uint32_t* indices, size_t numIndices, size_t numVertices, int cacheSize, uint32_t* output);
+  }
+}
+
+#endif // __THEIA_GRAPHICS_MESH_OPTIMISER__
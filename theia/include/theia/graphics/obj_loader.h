@@ -0,0 +1,28 @@
+/// Loading of Wavefront OBJ meshes.
+
+#if ! defined(__THEIA_GRAPHICS_OBJ_LOADER__)
+#define __THEIA_GRAPHICS_OBJ_LOADER__
+
+#include <stdint.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace theia
+{
+  /// An indexed triangle mesh. The normals and texcoords arrays are either empty or have one
+  /// entry per position.
+  struct ObjMesh
+  {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texcoords;
+    std::vector<uint32_t>  indices;
+  };
+
+  /// Parse the text of an OBJ file. Each distinct position/texcoord/normal combination used by
+  /// a face becomes one vertex, and polygons are split into triangle fans.
+  /// Returns false if a face refers to an element which doesn't exist.
+  bool ReadOBJ(const char* text, ObjMesh& mesh);
+}
+
+#endif // __THEIA_GRAPHICS_OBJ_LOADER__
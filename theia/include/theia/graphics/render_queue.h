@@ -0,0 +1,148 @@
+/// Sortable, deferred draw submission.
+
+#if ! defined(__THEIA_GFX_RENDER_QUEUE__)
+#define __THEIA_GFX_RENDER_QUEUE__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <theia/graphics/shader.h>
+#include <theia/graphics/gl/gl_loader.h>
+
+namespace theia
+{
+  struct DrawBatch;
+  struct MaterialState;
+
+  /// 64-bit keys which order draws by layer, then by the state they need, then by depth:
+  ///
+  ///   63..60  layer     e.g. opaque before transparent
+  ///   59..48  program
+  ///   47..36  material
+  ///   35..24  vertex array object
+  ///   23..0   depth     quantised distance in [0,1], nearest first
+  ///
+  /// The program and VAO fields are normally GL object names, which drivers hand out as
+  /// small consecutive integers. Two objects sharing a field only costs extra state changes,
+  /// since the backend compares the objects themselves.
+  namespace SortKey
+  {
+    static const int LayerBits = 4;
+    static const int ProgramBits = 12;
+    static const int MaterialBits = 12;
+    static const int VaoBits = 12;
+    static const int DepthBits = 24;
+
+    uint64_t Make(uint32_t layer, uint32_t program, uint32_t material, uint32_t vao, float depth);
+  }
+
+  /// Up to this many textures can be bound by one draw, to units 0, 1, ...
+  static const int MaxDrawTextures = 2;
+
+  /// Everything needed to issue one draw call. Packets are recorded with RenderQueue::Add
+  /// and only touch GL when the queue is submitted.
+  struct DrawPacket
+  {
+    uint64_t              key;
+    Shader*               program;
+    const MaterialState*  material;     // NULL to leave the program's material parameters alone
+    GLuint                vao;
+    GLenum                mode;         // e.g. GL_TRIANGLES, or GL_PATCHES
+    GLint                 patchVertices;// vertices per patch when mode is GL_PATCHES
+    GLenum                indexType;    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, or 0 to draw arrays
+    GLuint                first;        // first index, or first vertex when drawing arrays
+    GLsizei               count;        // indices or vertices
+    GLint                 baseVertex;
+    GLsizei               instanceCount;
+    DrawBatch*            batch;        // if set, submitted instead of first/count/baseVertex
+    GLenum                textureTargets[MaxDrawTextures];  // 0 for none
+    GLuint                textures[MaxDrawTextures];
+    uint32_t              firstConstant;
+    uint32_t              numConstants;
+  };
+
+  /// Counters for one Submit.
+  struct RenderQueueStats
+  {
+    RenderQueueStats() : draws(0), programChanges(0), materialChanges(0), vaoChanges(0), textureChanges(0), patchVerticesChanges(0) { }
+
+    int draws;
+    int programChanges;
+    int materialChanges;
+    int vaoChanges;
+    int textureChanges;
+    int patchVerticesChanges;
+  };
+
+  struct RenderQueue;
+  typedef boost::shared_ptr<RenderQueue> RenderQueuePtr;
+
+  /// Collects draw packets from scene code, sorts them by key and replays them, emitting only
+  /// the GL state which differs from the previous draw. Parameters set on a program persist
+  /// in its cache between draws, so per-draw constants are only uploaded when they change.
+  ///
+  /// Recording touches no GL state, so any thread may record into a queue that no other
+  /// thread is using at the same time. Submit must be called on the GL thread.
+  struct RenderQueue
+  {
+    static RenderQueuePtr Create();
+
+    /// Start a packet drawing count indices (or vertices, if indexType is 0) with a program
+    /// and vertex array object. The other fields can be filled in through the returned
+    /// packet, which is only valid until the next Add.
+    DrawPacket& Add(uint64_t key, Shader* program, GLuint vao, GLenum mode, GLenum indexType, GLuint first, GLsizei count);
+
+    /// Give the last packet added a value for one of its program's parameters.
+    template <typename T>
+    void AddConstant(Shader::Parameter* const param, const T& value)
+    {
+      AddConstant(param, &value, sizeof(value));
+    }
+    void AddConstant(Shader::Parameter* const param, const void* const data, size_t sizeInBytes);
+
+    /// Sort the packets by key. Stable, so packets with equal keys keep the order they were added in.
+    void Sort();
+
+    /// Sort and issue every packet, then clear the queue. Must be called on the GL thread.
+    void Submit();
+
+    void Clear();
+
+    /// Move every packet of another queue, with its constants, onto the end of this one and
+    /// leave the other empty. Packets can be recorded into a queue per thread, with no locks
+    /// and no allocation once the queues have grown to fit a frame, then merged on the GL
+    /// thread for a single sort and submission.
+    void Merge(RenderQueue& other);
+
+    bool Empty() const { return packets.empty(); }
+
+    RenderQueueStats stats; // of the last Submit
+
+  private:
+    struct Constant
+    {
+      Shader::Parameter*  param;
+      uint32_t            offset;   // into constantData
+      uint32_t            size;
+    };
+
+    struct SortEntry
+    {
+      uint64_t key;
+      uint32_t index;
+    };
+
+    RenderQueue();
+
+    void Replay(const DrawPacket& packet, Shader*& program, const MaterialState*& material, GLuint& vao, GLuint textures[MaxDrawTextures], GLint& patchVertices);
+
+    std::vector<DrawPacket> packets;
+    std::vector<Constant>   constants;
+    std::vector<uint8_t>    constantData;
+    std::vector<SortEntry>  order;
+    std::vector<SortEntry>  scratch;
+  };
+}
+
+#endif // __THEIA_GFX_RENDER_QUEUE__
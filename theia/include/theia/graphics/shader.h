@@ -37,11 +37,39 @@ namespace theia
     bool Compile(const char* commonSrc, const char* vertexSrc, const char* fragmentSrc);
     bool Compile(uint32_t commonResource, uint32_t vertexShaderResource, uint32_t fragmentShaderResource);
 
+    /// Compile a shader program with tessellation control and evaluation stages between the
+    /// vertex and fragment stages, to be drawn as GL_PATCHES.
+    ///
+    /// As with compute, the tessellation stages may begin with their own #version line
+    /// (e.g. "#version 400") to replace the common one.
+    ///
+    /// @return true if compilation succeeded, otherwise false.
+    bool Compile(const char* commonSrc, const char* vertexSrc, const char* controlSrc, const char* evaluationSrc, const char* fragmentSrc);
+    bool Compile(uint32_t commonResource, uint32_t vertexShaderResource, uint32_t controlShaderResource,
+                 uint32_t evaluationShaderResource, uint32_t fragmentShaderResource);
+
+    /// Compile a shader program containing a single compute stage.
+    ///
+    /// The common source is written for the vertex and fragment stages, so the compute source
+    /// may begin with its own #version line (e.g. "#version 430") to replace the common one.
+    ///
+    /// @return true if compilation succeeded, otherwise false.
+    bool CompileCompute(const char* commonSrc, const char* computeSrc);
+    bool CompileCompute(uint32_t commonResource, uint32_t computeShaderResource);
+
     /// Make this shader active and copy all modified parameter values to the GPU.
     void Activate();
 
+    /// Copy all modified parameter values to the GPU. The shader must already be the active
+    /// program, e.g. after an earlier Activate, so that a run of draws with the same program
+    /// only uploads what changes between them.
+    void Flush();
+
     Parameter* const GetParameter(const char* const name);
 
+    /// Set an int parameter, or the texture unit read by a sampler.
+    void SetParameter(Parameter* const param, int value);
+
     void SetParameter(Parameter* const param, float value);
     void SetParameter(Parameter* const param, const glm::vec2& value);
     void SetParameter(Parameter* const param, const glm::vec3& value);
@@ -56,6 +84,10 @@ namespace theia
     void SetParameter(Parameter* const param, const glm::dmat3& value);
     void SetParameter(Parameter* const param, const glm::dmat4& value);
 
+    /// Set a parameter from raw data laid out as the typed setters would cache it, e.g. a
+    /// value recorded earlier for a deferred draw.
+    void SetParameter(Parameter* const param, const void* const data, size_t sizeInBytes);
+
 
     GLuint program;
     std::vector<Parameter> params;
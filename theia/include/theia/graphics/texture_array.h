@@ -0,0 +1,39 @@
+#if ! defined(__TEXTURE_ARRAY__)
+#define __TEXTURE_ARRAY__
+
+#include <boost/shared_ptr.hpp>
+#include <theia/graphics/gl/gl_loader.h>
+
+namespace theia
+{
+  struct TextureArray;
+  typedef boost::shared_ptr<TextureArray> TextureArrayPtr;
+
+  /// A 2D array texture whose layers are filled individually, exposed to shaders as a sampler2DArray.
+  struct TextureArray
+  {
+    GLuint  texture;
+    GLsizei width;
+    GLsizei height;
+    GLsizei layers;
+
+    /// Allocate every layer, filtered linearly and clamped at the edges.
+    ///
+    /// @param[in] internalFormat How the texels are stored, e.g. GL_RG16F.
+    static TextureArrayPtr Create(GLsizei width, GLsizei height, GLsizei layers, GLenum internalFormat);
+
+    TextureArray();
+    ~TextureArray();
+
+    /// Replace the contents of one layer.
+    ///
+    /// @param[in] format The components in data, e.g. GL_RG.
+    /// @param[in] type   The type of each component, e.g. GL_FLOAT.
+    void SetLayer(GLint layer, GLenum format, GLenum type, const void* const data);
+
+    /// Bind the texture to a texture unit.
+    void Bind(GLuint unit) const;
+  };
+}
+
+#endif // __TEXTURE_ARRAY__
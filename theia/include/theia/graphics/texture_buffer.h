@@ -0,0 +1,33 @@
+#if ! defined(__TEXTURE_BUFFER__)
+#define __TEXTURE_BUFFER__
+
+#include <boost/shared_ptr.hpp>
+#include <theia/graphics/gl/gl_loader.h>
+
+namespace theia
+{
+  struct TextureBuffer;
+  typedef boost::shared_ptr<TextureBuffer> TextureBufferPtr;
+
+  /// A buffer object exposed to shaders as a samplerBuffer, for per-draw data too large
+  /// or too numerous for uniforms.
+  struct TextureBuffer
+  {
+    GLuint buffer;
+    GLuint texture;
+    size_t sizeInBytes;
+
+    /// @param[in] internalFormat How the shader interprets each texel, e.g. GL_RGBA32F.
+    static TextureBufferPtr Create(size_t sizeInBytes, GLenum internalFormat);
+
+    TextureBuffer();
+    ~TextureBuffer();
+
+    void SetData(size_t sizeInBytes, size_t offsetInBytes, const void* const data);
+
+    /// Bind the texture to a texture unit.
+    void Bind(GLuint unit) const;
+  };
+}
+
+#endif // __TEXTURE_BUFFER__
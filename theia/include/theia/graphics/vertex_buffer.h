@@ -19,6 +19,19 @@ namespace theia
     ~VertexBuffer();
 
     void SetData(size_t sizeInBytes, size_t offsetInBytes, const void* const data);
+
+    /// Map a range of the buffer for writing, discarding its previous contents. The pointer
+    /// may be written from any thread, but Map and Unmap must be called on the GL thread.
+    /// Returns NULL if the range could not be mapped.
+    void* Map(size_t sizeInBytes, size_t offsetInBytes);
+
+    /// Release a mapping made by Map. Returns false if the contents were lost while mapped
+    /// and must be written again.
+    bool Unmap();
+
+    /// Bind the whole buffer to a shader storage block binding point so that a compute
+    /// shader can write the vertices in place.
+    void BindStorage(GLuint binding);
   };
 }
 
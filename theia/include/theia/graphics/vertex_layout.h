@@ -0,0 +1,136 @@
+/// Declarative vertex layouts and the compact formats they can describe.
+
+#if ! defined(__THEIA_GRAPHICS_VERTEX_LAYOUT__)
+#define __THEIA_GRAPHICS_VERTEX_LAYOUT__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include <theia/graphics/gl/gl_loader.h>
+
+namespace theia
+{
+  struct ObjMesh;
+
+  /// How a vertex attribute is stored, and so how the vertex fetch turns it into the shader's
+  /// input. Every normalized and half-float format arrives in the shader as floats with no
+  /// decoding needed; octahedral normals and positions relative to a patch need the decode
+  /// functions in common.glsl.
+  namespace VertexFormat
+  {
+    enum Enum
+    {
+      Float1,
+      Float2,
+      Float3,
+      Float4,
+      Half2,          // e.g. texture coordinates
+      Half4,
+      UNorm16x2,      // [0,1], e.g. a coordinate within a cube face
+      UNorm16x4,      // [0,1], e.g. a position within a patch's bounds (DecodePatchPosition)
+      SNorm16x2,      // [-1,1], e.g. an octahedral normal (DecodeOctahedral)
+      SNorm8x2,       // [-1,1], a coarser octahedral normal
+      UNorm8x4,       // [0,1], e.g. a colour
+      UInt8,          // integer input, e.g. a face index
+      NumFormats
+    };
+
+    /// Size of one attribute in bytes.
+    GLsizei Size(Enum format);
+  }
+
+  /// One attribute of a vertex.
+  struct VertexElement
+  {
+    GLuint              location;   // as given by the "layout (location = n)" declaration
+    VertexFormat::Enum  format;
+    GLsizei             offset;     // from the start of the vertex, in bytes
+  };
+
+  /// The attributes of one vertex buffer and the distance between its vertices.
+  ///
+  /// Layouts are built up with Add and then applied to the bound vertex array object and
+  /// GL_ARRAY_BUFFER with Configure, in place of hand-written glVertexAttribPointer calls.
+  struct VertexLayout
+  {
+    /// @param[in] stride Size of a whole vertex, or 0 to use the end of the last element.
+    explicit VertexLayout(GLsizei stride = 0);
+
+    /// Append an attribute. Returns the layout so that calls can be chained.
+    VertexLayout& Add(GLuint location, VertexFormat::Enum format, GLsizei offset);
+
+    /// Size of a whole vertex in bytes.
+    GLsizei Stride() const;
+
+    /// Point the attributes at the currently bound GL_ARRAY_BUFFER.
+    ///
+    /// @param[in] divisor Non-zero to step the attributes per instance rather than per vertex.
+    void Configure(GLuint divisor = 0) const;
+
+    std::vector<VertexElement> elements;
+    GLsizei stride;
+  };
+
+  //--------------------------------------------------------------------------------
+
+  /// Conversions to and from the compact formats. Each encoder matches the way GL
+  /// normalizes the format on fetch, so the decoders return what the shader will see.
+  namespace VertexEncoding
+  {
+    /// IEEE 754 half-precision floats, rounding to nearest even.
+    uint16_t FloatToHalf(float value);
+    float HalfToFloat(uint16_t value);
+
+    /// Map a unit vector onto the octahedron and unfold it into [-1,1]^2, which spreads the
+    /// precision of two components evenly over the sphere (Meyer et al. 2010).
+    glm::vec2 OctahedralEncode(const glm::vec3& n);
+    glm::vec3 OctahedralDecode(const glm::vec2& e);
+
+    void EncodeNormal(const glm::vec3& n, int16_t out[2]);
+    void EncodeNormal(const glm::vec3& n, int8_t out[2]);
+    glm::vec3 DecodeNormal(const int16_t in[2]);
+
+    /// Pack a colour with components in [0,1] into UNorm8x4, red in the lowest byte.
+    uint32_t EncodeColour(const glm::vec4& colour);
+
+    /// Positions stored as UNorm16x4 relative to a bounding box, such as that of a terrain
+    /// patch or an imported mesh. The precision is the box's extent / 65535 on each axis.
+    /// The fourth component is left for the caller.
+    struct PositionQuantiser
+    {
+      PositionQuantiser();
+      PositionQuantiser(const glm::vec3& origin, const glm::vec3& extent);
+
+      /// The smallest box holding every position.
+      static PositionQuantiser FromBounds(const glm::vec3* positions, size_t count);
+
+      void Encode(const glm::vec3& position, uint16_t out[3]) const;
+      glm::vec3 Decode(const uint16_t in[3]) const;
+
+      glm::vec3 origin;   // the corner of the box which encodes as (0,0,0)
+      glm::vec3 extent;   // size of the box, the position which encodes as 65535 on each axis
+    };
+  }
+
+  //--------------------------------------------------------------------------------
+
+  /// A mesh vertex in 16 bytes rather than the 32 of three float vectors: a quantised
+  /// position, an octahedral normal and half-float texture coordinates.
+  struct CompactVertex
+  {
+    uint16_t  position[4];  // x, y, z in the mesh's PositionQuantiser, w is 0
+    int16_t   normal[2];
+    uint16_t  texcoord[2];
+
+    /// The layout with position, normal and texcoord at locations 0, 1 and 2.
+    static VertexLayout Layout();
+  };
+
+  /// Encode every vertex of an imported mesh. Missing normals or texcoords are left at 0.
+  ///
+  /// @param[out] quantiser The box the positions were encoded in, for the shader to decode with.
+  void CompactMesh(const ObjMesh& mesh, std::vector<CompactVertex>& vertices, VertexEncoding::PositionQuantiser& quantiser);
+}
+
+#endif // __THEIA_GRAPHICS_VERTEX_LAYOUT__
@@ -0,0 +1,46 @@
+/// A view frustum described by six planes.
+
+#if ! defined(__THEIA_MATH_FRUSTUM__)
+#define __THEIA_MATH_FRUSTUM__
+
+#include <glm/glm.hpp>
+
+namespace theia
+{
+  struct Frustum
+  {
+    enum Plane
+    {
+      Plane_Left,
+      Plane_Right,
+      Plane_Bottom,
+      Plane_Top,
+      Plane_Near,
+      Plane_Far,
+      NumPlanes
+    };
+
+    enum Result
+    {
+      Outside,      // entirely on the outer side of at least one plane
+      Intersecting, // may straddle one or more planes
+      Inside        // entirely on the inner side of every plane
+    };
+
+    Frustum();
+
+    /// Extract the planes of a projection matrix. The planes are in whatever space the
+    /// matrix transforms from, e.g. passing (perspective * view * world) gives object-space planes.
+    explicit Frustum(const glm::mat4& projection);
+
+    /// Classify an axis-aligned box against the frustum.
+    Result TestBox(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const;
+
+    /// Classify a sphere against the frustum.
+    Result TestSphere(const glm::vec3& centre, float radius) const;
+
+    glm::vec4 planes[NumPlanes]; // xyz == inward-facing unit normal, w == distance
+  };
+}
+
+#endif // __THEIA_MATH_FRUSTUM__
@@ -0,0 +1,60 @@
+/// Simplex noise and fractal sums which reproduce the GLSL terrain functions on the CPU.
+
+#if ! defined(__THEIA_MATH_NOISE__)
+#define __THEIA_MATH_NOISE__
+
+#include <stddef.h>
+#include <glm/glm.hpp>
+#include <theia/misc/job_system.h>
+
+namespace theia
+{
+  /// Each function follows its namesake in common.glsl step for step, in single
+  /// precision, so results agree with the shaders to within the GPU's rounding (around 1e-5).
+  /// Change both together, and run tools/noisecheck to compare them.
+  namespace Noise
+  {
+    /// Octave parameters of a fractal sum. The defaults are the ones GetHeightAt uses.
+    struct FractalSettings
+    {
+      FractalSettings();
+
+      int   octaves;
+      float lacunarity; // frequency multiplier per octave
+      float gain;       // amplitude multiplier per octave
+    };
+
+    /// Number of points evaluated by one call to the batch functions.
+    static const int BatchSize = 8;
+
+    /// 2D and 3D simplex noise, snoise() in common.glsl. Range is about [-1,1].
+    float Simplex(const glm::vec2& P);
+    float Simplex(const glm::vec3& P);
+
+    /// Sum of octaves of noise, fBm() in common.glsl.
+    float fBm(const glm::vec2& P, const FractalSettings& settings);
+    float fBm(const glm::vec3& P, const FractalSettings& settings);
+
+    /// Sum of octaves of abs(noise), Turbulence() in common.glsl.
+    float Turbulence(const glm::vec2& P, const FractalSettings& settings);
+
+    /// Terrain height at a point on the unit sphere, GetHeightAt() in common.glsl.
+    /// The shader treats heights <= 0 as land.
+    float GetHeightAt(const glm::vec3& P);
+
+    /// The instructions the batch functions were compiled for: "AVX", "SSE2" or "scalar".
+    const char* BatchInstructionSet();
+
+    /// Evaluate BatchSize points at once, given as separate x, y and z arrays, using SSE2
+    /// (or AVX when compiled with /arch:AVX).
+    void Simplex(const float* x, const float* y, const float* z, float* result);
+    void fBm(const float* x, const float* y, const float* z, const FractalSettings& settings, float* result);
+
+    /// Evaluate fBm at any number of points in batches, spread across a job system.
+    ///
+    /// @param[in] jobs Job system to run on, or NULL to run on the calling thread.
+    void fBm(JobSystem* jobs, const glm::vec3* points, size_t count, const FractalSettings& settings, float* result);
+  }
+}
+
+#endif // __THEIA_MATH_NOISE__
@@ -3,10 +3,12 @@
 #if ! defined(__THEIA_DEBUG__)
 #define __THEIA_DEBUG__
 
+#include <assert.h>
 #include <stdio.h>
 #include <stdarg.h>
 
-#define LOG(msg, ...) fprintf(stderr, msg, __VA_ARGS__)
+// The ## drops the comma when there are no arguments, as MSVC does anyway...
+#define LOG(msg, ...) fprintf(stderr, msg, ##__VA_ARGS__)
 
 #define ASSERT(pred) ASSERTM(pred, "")
 
@@ -15,7 +17,7 @@
   { \
     if (!(pred)) \
     { \
-      LOG("%s:%d:%s - %s", #pred, msg, __VA_ARGS__); \
+      LOG("%s:%d: %s - " msg "\n", __FILE__, __LINE__, #pred, ##__VA_ARGS__); \
       assert(0); \
     } \
   } while (0)
@@ -0,0 +1,85 @@
+/// Timing for the frame loop: a monotonic clock, fixed simulation steps and frame pacing.
+
+#if ! defined(__THEIA_MISC_FRAME_CLOCK__)
+#define __THEIA_MISC_FRAME_CLOCK__
+
+namespace theia
+{
+  /// Divides real time into simulation steps of a fixed length, so that the simulation behaves
+  /// the same however fast frames are drawn. Time left over after the last whole step is kept
+  /// for the next frame, and Alpha says how far it is towards the next step, for rendering
+  /// state interpolated between the last two steps.
+  struct FixedTimestep
+  {
+    /// @param[in] stepSeconds  Length of each step.
+    /// @param[in] maxSteps     Most steps to run in one frame. After a long stall the time
+    ///                         beyond this is dropped rather than caught up, which would make
+    ///                         the next frame slower still.
+    FixedTimestep(double stepSeconds, int maxSteps);
+
+    /// Add the time since the last call and return the number of steps now due. The first
+    /// call starts the clock and returns zero.
+    ///
+    /// @param[in] now  Seconds, from FrameClock::Now.
+    int Advance(double now);
+
+    /// The time since the last step as a fraction of a step, from 0 to 1.
+    float Alpha() const { return (float)(accumulator / stepSeconds); }
+
+    double  stepSeconds;
+    int     maxSteps;
+    double  accumulator;  // real time not yet simulated
+    double  previousTime; // negative until started
+    int     droppedSteps; // steps skipped because a frame was too long
+  };
+
+  /// Frame times collected by a FrameClock.
+  struct FrameTimeStats
+  {
+    FrameTimeStats();
+
+    double MeanMS() const { return (frames > 0) ? totalMS / frames : 0.0; }
+
+    /// Standard deviation of the frame times.
+    double JitterMS() const;
+
+    int     frames;
+    double  totalMS;
+    double  minMS;
+    double  maxMS;
+    double  sumSquaresMS; // of each frame's time, for the jitter
+  };
+
+  /// Measures the time between frames and, if given a maximum frame rate, holds each frame
+  /// back until it is due. Waiting sleeps until shortly before the frame is due and then
+  /// spins, since a sleep can wake late by as much as the OS's timer resolution.
+  struct FrameClock
+  {
+    FrameClock();
+
+    /// Seconds on a monotonic, high resolution clock, from an arbitrary start.
+    static double Now();
+
+    /// Mark the start of a frame, returning the seconds since the previous one.
+    double Tick();
+
+    /// Limit the frame rate to at most framesPerSecond, or remove the limit with zero.
+    void SetMaxFrameRate(double framesPerSecond);
+
+    /// Wait until the next frame is due, if the frame rate is limited. Due times follow on
+    /// from each other rather than from when Pace returns, so a frame which wakes late doesn't
+    /// delay the ones after it, unless it was late by a whole frame or more.
+    void Pace();
+
+    /// Return the frame times so far and start collecting again.
+    FrameTimeStats TakeStats();
+
+    double          maxFrameRate;   // zero if unlimited
+    double          spinSeconds;    // how long before a frame is due to stop sleeping
+    double          frameStart;     // negative until the first Tick
+    double          nextFrame;      // when the next frame is due, if limited
+    FrameTimeStats  stats;
+  };
+}
+
+#endif // __THEIA_MISC_FRAME_CLOCK__
@@ -0,0 +1,134 @@
+/// Hands frames from one pipeline stage to the next, each on its own thread.
+
+#if ! defined(__THEIA_MISC_FRAME_PIPELINE__)
+#define __THEIA_MISC_FRAME_PIPELINE__
+
+#include <stddef.h>
+#include <boost/chrono.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <theia/misc/profiler.h>
+
+namespace theia
+{
+  /// Time each side of a pipeline spent blocked, waiting for the other.
+  struct FramePipelineStats
+  {
+    FramePipelineStats() : frames(0), producerWaitMS(0), consumerWaitMS(0) { }
+
+    int     frames;
+    double  producerWaitMS; // for a free slot: the consumer is the slower stage
+    double  consumerWaitMS; // for a finished frame: the producer is the slower stage
+  };
+
+  /// A fixed ring of frames passed from a producer thread, which fills them in, to a consumer
+  /// thread, which only reads them. With two slots the producer builds frame N+1 while the
+  /// consumer works on frame N, so a frame costs the slower of the two stages rather than
+  /// both. Slots are reused rather than reallocated, so containers in a Frame keep their
+  /// capacity from one frame to the next.
+  template <typename Frame, int NumSlots = 2>
+  struct FramePipeline
+  {
+    FramePipeline()
+      : readIndex(0), writeIndex(0), filled(0), closed(false)
+    {
+    }
+
+    /// Wait for a free slot and return it to be filled in, or NULL once the pipeline has been
+    /// closed. Producer thread only.
+    Frame* BeginWrite()
+    {
+      PROFILE_SCOPE("FramePipeline::BeginWrite");
+      const boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+      boost::mutex::scoped_lock lock(mutex);
+      while (!closed && (filled == NumSlots))
+      {
+        changed.wait(lock);
+      }
+      stats.producerWaitMS += ElapsedMS(start);
+      if (closed)
+      {
+        return NULL;
+      }
+      return &slots[writeIndex];
+    }
+
+    /// Pass the slot returned by BeginWrite on to the consumer.
+    void EndWrite()
+    {
+      {
+        boost::mutex::scoped_lock lock(mutex);
+        writeIndex = (writeIndex + 1) % NumSlots;
+        ++filled;
+      }
+      changed.notify_all();
+    }
+
+    /// Wait for the oldest finished frame, or return NULL once the pipeline has been closed.
+    /// Consumer thread only.
+    const Frame* BeginRead()
+    {
+      PROFILE_SCOPE("FramePipeline::BeginRead");
+      const boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+      boost::mutex::scoped_lock lock(mutex);
+      while (!closed && (0 == filled))
+      {
+        changed.wait(lock);
+      }
+      stats.consumerWaitMS += ElapsedMS(start);
+      if (closed)
+      {
+        return NULL;
+      }
+      return &slots[readIndex];
+    }
+
+    /// Give the slot returned by BeginRead back to the producer.
+    void EndRead()
+    {
+      {
+        boost::mutex::scoped_lock lock(mutex);
+        readIndex = (readIndex + 1) % NumSlots;
+        --filled;
+        ++stats.frames;
+      }
+      changed.notify_all();
+    }
+
+    /// Make both sides' Begin calls return NULL from now on, waking either if it is waiting.
+    void Close()
+    {
+      {
+        boost::mutex::scoped_lock lock(mutex);
+        closed = true;
+      }
+      changed.notify_all();
+    }
+
+    /// Return the waiting times so far and start counting again.
+    FramePipelineStats TakeStats()
+    {
+      boost::mutex::scoped_lock lock(mutex);
+      const FramePipelineStats taken(stats);
+      stats = FramePipelineStats();
+      return taken;
+    }
+
+  private:
+    static double ElapsedMS(const boost::chrono::steady_clock::time_point& start)
+    {
+      return boost::chrono::duration<double, boost::milli>(boost::chrono::steady_clock::now() - start).count();
+    }
+
+    Frame                     slots[NumSlots];
+    int                       readIndex;
+    int                       writeIndex;
+    int                       filled;
+    bool                      closed;
+    FramePipelineStats        stats;
+    boost::mutex              mutex;
+    boost::condition_variable changed;
+  };
+}
+
+#endif // __THEIA_MISC_FRAME_PIPELINE__
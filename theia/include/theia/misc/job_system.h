@@ -0,0 +1,134 @@
+/// A work-stealing scheduler for running engine tasks across cores.
+
+#if ! defined(__THEIA_MISC_JOB_SYSTEM__)
+#define __THEIA_MISC_JOB_SYSTEM__
+
+#include <deque>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
+
+namespace theia
+{
+  struct JobCounter;
+
+  /// A job and the counter to decrement once it has run.
+  struct JobEntry
+  {
+    boost::function<void ()>  job;
+    JobCounter*               counter;
+  };
+
+  /// Counts the jobs of a group which have still to finish. A counter is incremented as each
+  /// job is queued against it, and can be waited on or made a dependency of later jobs. It
+  /// must outlive every job queued against it or waiting for it.
+  struct JobCounter
+  {
+    JobCounter();
+
+    bool IsDone() const { return 0 == pending; }
+
+    boost::atomic<int>    pending;
+    boost::mutex          mutex;
+    std::vector<JobEntry> continuations;  // jobs to queue once pending reaches zero
+  };
+
+  struct JobSystem;
+  typedef boost::shared_ptr<JobSystem> JobSystemPtr;
+
+  /// Worker threads which each take jobs from their own deque, newest first, and steal the
+  /// oldest jobs from each other's when they run out. The thread which creates the job
+  /// system is counted as thread 0: it runs jobs while it waits for them, and alone runs the
+  /// jobs queued with RunOnMainThread, which is where anything touching GL belongs.
+  struct JobSystem
+  {
+    typedef boost::function<void ()> Job;
+
+    /// Called with a half-open range [begin, end) of loop indices.
+    typedef boost::function<void (int begin, int end)> RangeFunction;
+
+    /// As RangeFunction, also given the index of the thread running the range (see
+    /// ThreadIndex), so that a loop body can write to per-thread storage without locking.
+    typedef boost::function<void (int thread, int begin, int end)> ThreadRangeFunction;
+
+    /// Start the worker threads.
+    ///
+    /// @param[in] numThreads Number of threads to run jobs on, including the calling thread.
+    ///                       Zero means one per hardware thread.
+    static JobSystemPtr Create(int numThreads = 0);
+
+    ~JobSystem();
+
+    /// Queue a job to run on any thread.
+    ///
+    /// @param[in] counter If given, incremented now and decremented once the job has run.
+    void Run(const Job& job, JobCounter* counter = NULL);
+
+    /// Queue a job to run on any thread once every job counted by dependency has finished.
+    void RunAfter(JobCounter& dependency, const Job& job, JobCounter* counter = NULL);
+
+    /// Queue a job to run on the main thread, from RunMainThreadJobs or while it waits.
+    void RunOnMainThread(const Job& job, JobCounter* counter = NULL);
+
+    /// Run every job queued for the main thread so far. Must be called on the main thread.
+    void RunMainThreadJobs();
+
+    /// Run queued jobs until every job counted by counter has finished. A thread the job
+    /// system doesn't own runs none, and just waits for the other threads to finish them.
+    void Wait(JobCounter& counter);
+
+    /// Run body over [0, count) in chunks of at most grainSize indices, spread across every
+    /// thread. Returns once every chunk has finished. May be nested inside a job.
+    void ParallelFor(int count, int grainSize, const RangeFunction& body);
+
+    /// As ParallelFor, telling the body which thread each chunk runs on. ParallelFor may be
+    /// called from a thread the job system doesn't own, but this may not.
+    void ParallelForWithThread(int count, int grainSize, const ThreadRangeFunction& body);
+
+    /// Number of threads jobs are spread across, including the main thread.
+    int NumThreads() const { return (int)queues.size(); }
+
+    /// Index of the calling thread: 0 for the main thread, 1 to NumThreads() - 1 for the
+    /// workers, or -1 for a thread the job system doesn't own.
+    int ThreadIndex() const;
+
+  private:
+    // A deque of jobs owned by one thread...
+    struct WorkQueue
+    {
+      boost::mutex          mutex;
+      std::deque<JobEntry>  jobs;
+    };
+
+    JobSystem();
+
+    void Push(const JobEntry& entry);
+    bool Pop(int thread, JobEntry& entry);
+    bool PopMainThread(JobEntry& entry);
+    void RunLoop(int count, int grainSize, const ThreadRangeFunction& body);
+    void Execute(JobEntry& entry);
+    void Finish(JobCounter* counter);
+    void WorkerMain(int thread);
+
+    std::vector<WorkQueue*>     queues;   // one per thread, the main thread's first
+    std::vector<boost::thread*> workers;
+
+    boost::thread_specific_ptr<int> threadIndex;
+
+    WorkQueue                   mainThreadQueue;
+
+    // Idle workers sleep until a job is queued...
+    boost::atomic<int>          queuedJobs;       // in the threads' deques
+    boost::atomic<int>          sleepingWorkers;
+    boost::mutex                sleepMutex;
+    boost::condition_variable   workReady;
+    bool                        quit;
+  };
+}
+
+#endif // __THEIA_MISC_JOB_SYSTEM__
@@ -0,0 +1,21 @@
+/// Writes images as PNG files, with no dependencies.
+
+#if ! defined(__THEIA_MISC_PNG_WRITER__)
+#define __THEIA_MISC_PNG_WRITER__
+
+#include <stdint.h>
+#include <vector>
+
+namespace theia
+{
+  namespace PngWriter
+  {
+    /// Write 8 bit RGBA pixels, top row first, to a PNG file. The image data is stored rather
+    /// than compressed, which keeps the writer small and fast at the cost of file size: this
+    /// is meant for frames captured by tests and benchmarks, not for shipping. Returns false
+    /// if the file can't be written.
+    bool Write(const char* path, int width, int height, const std::vector<uint8_t>& rgba);
+  }
+}
+
+#endif // __THEIA_MISC_PNG_WRITER__
@@ -0,0 +1,98 @@
+/// Instrumentation for finding out where CPU time goes.
+///
+/// Wrap code to be timed in a scope starting with PROFILE_SCOPE("Name"). Each thread records
+/// its scopes into its own buffer without locking; once a frame the main thread collects them
+/// into a running summary and, while a capture is running, a trace which can be saved in the
+/// Chrome trace-event format and loaded into chrome://tracing or Perfetto. Defining
+/// THEIA_NO_PROFILE compiles the scopes out altogether.
+
+#if ! defined(__THEIA_MISC_PROFILER__)
+#define __THEIA_MISC_PROFILER__
+
+#include <stdint.h>
+#include <vector>
+
+namespace theia
+{
+  /// Time spent in one named scope over the frames summarised.
+  struct ProfileSummaryEntry
+  {
+    const char* name;
+    int         calls;
+    double      totalMS;  // including any scopes nested inside
+    double      maxMS;    // of a single call
+  };
+
+  /// Collects the scopes recorded by every thread. Only EndFrame and the capture and summary
+  /// functions need be called from one thread at a time; the rest may be called from any.
+  struct Profiler
+  {
+    /// Nanoseconds on a monotonic clock, cheap enough to read around the smallest scopes. The
+    /// first call measures the clock against the steady clock, taking a couple of milliseconds.
+    static int64_t Now();
+
+    /// Scopes are only recorded while enabled, which they are to begin with.
+    static void SetEnabled(bool enabled);
+    static bool IsEnabled();
+
+    /// Name the calling thread in traces.
+    static void SetThreadName(const char* name);
+
+    /// Record a scope on the calling thread. The name must outlive the profiler, so is
+    /// normally a string literal.
+    static void Record(const char* name, int64_t begin, int64_t end);
+
+    /// Add a timeline which isn't a CPU thread, such as the GPU's, returning its index for
+    /// RecordOnTrack.
+    static int AddTrack(const char* name);
+
+    /// Record a scope on a track from AddTrack, with times already converted to Now's
+    /// clock. Only one thread at a time may record on any one track.
+    static void RecordOnTrack(int track, const char* name, int64_t begin, int64_t end);
+
+    /// Mark the end of a frame and collect the scopes every thread has recorded since the
+    /// last one. A thread which records more than a buffer's worth of scopes in a frame loses
+    /// the oldest.
+    static void EndFrame();
+
+    /// Start keeping every scope collected, until StopCapture.
+    static void StartCapture();
+    static bool IsCapturing();
+
+    /// Stop capturing and write the capture as Chrome trace-event JSON, returning false if the
+    /// file can't be written.
+    static bool StopCapture(const char* path);
+
+    /// Fill entries with the time spent in each scope since the last call, most expensive
+    /// first, and return the number of frames they cover.
+    static int TakeSummary(std::vector<ProfileSummaryEntry>& entries);
+  };
+
+  /// Records the time from its construction to its destruction.
+  struct ProfileScope
+  {
+    explicit ProfileScope(const char* name)
+      : name(name), begin(Profiler::IsEnabled() ? Profiler::Now() : -1)
+    {
+    }
+
+    ~ProfileScope()
+    {
+      if (begin >= 0) { Profiler::Record(name, begin, Profiler::Now()); }
+    }
+
+  private:
+    const char* name;
+    int64_t     begin;
+  };
+}
+
+#if defined(THEIA_NO_PROFILE)
+  #define PROFILE_SCOPE(name)
+#else
+  #define PROFILE_SCOPE_JOIN2(a, b) a##b
+  #define PROFILE_SCOPE_JOIN(a, b) PROFILE_SCOPE_JOIN2(a, b)
+  #define PROFILE_SCOPE(name) theia::ProfileScope PROFILE_SCOPE_JOIN(profileScope, __LINE__)(name)
+#endif
+
+#endif // __THEIA_MISC_PROFILER__
@@ -14,6 +14,13 @@ namespace theia
 
   namespace ResourceLoader
   {
+    /// Load a resource from a file rather than the executable, which is the only way to
+    /// provide resources where the platform has no resource sections. A file registered
+    /// against an id takes precedence over any resource compiled in with it.
+    void Register(uint32_t id, const char* path);
+
+    /// Find a resource, leaving its data NULL if there isn't one. The data stays valid for
+    /// as long as the program runs.
     void Load(uint32_t id, uint32_t type, Resource& resource);
   }
 }
@@ -0,0 +1,45 @@
+/// Mapping between the faces of a cube and the surface of a sphere.
+
+#if ! defined(__THEIA_TERRAIN_CUBE_SPHERE__)
+#define __THEIA_TERRAIN_CUBE_SPHERE__
+
+#include <glm/glm.hpp>
+
+namespace theia
+{
+  namespace terrain
+  {
+    namespace CubeSphere
+    {
+      static const int NumFaces = 6;
+
+      /// The tangent basis of one cube face. The x and y axes span the face and the
+      /// normal (x cross y) points out of the cube.
+      struct FaceBasis
+      {
+        glm::vec3 x;
+        glm::vec3 y;
+        glm::vec3 normal;
+      };
+
+      /// Get the basis of a cube face.
+      /// The same table is declared in common.glsl as CubeFaceX/CubeFaceY, so keep the two in step.
+      const FaceBasis& GetFace(int face);
+
+      /// Map a face coordinate in [0,1] onto the surface of a cube of unit edge length centred on the origin.
+      glm::vec3 FaceToCube(int face, const glm::vec2& uv);
+
+      /// Map a face coordinate in [0,1] onto the surface of a sphere centred on the origin.
+      glm::vec3 FaceToSphere(int face, const glm::vec2& uv, float radius);
+
+      /// Compute a conservative object-space bounding box for a square region of a face once
+      /// it has been mapped onto a sphere.
+      ///
+      /// @param[in]  origin  Face coordinate of the region's (0,0) corner.
+      /// @param[in]  size    Extent of the region in face coordinates.
+      void ComputeBounds(int face, const glm::vec2& origin, float size, float radius, glm::vec3& boundsMin, glm::vec3& boundsMax);
+    }
+  }
+}
+
+#endif // __THEIA_TERRAIN_CUBE_SPHERE__
@@ -0,0 +1,91 @@
+/// Generation of cube-sphere grid vertices by a compute shader.
+
+#if ! defined(__THEIA_TERRAIN_GPU_GRID_BUILDER__)
+#define __THEIA_TERRAIN_GPU_GRID_BUILDER__
+
+#include <stddef.h>
+#include <glm/glm.hpp>
+#include <boost/shared_ptr.hpp>
+#include <theia/graphics/shader.h>
+#include <theia/graphics/vertex_buffer.h>
+
+namespace theia
+{
+  namespace terrain
+  {
+    struct GpuGridBuilder;
+    typedef boost::shared_ptr<GpuGridBuilder> GpuGridBuilderPtr;
+
+    /// Where each generated value goes within a vertex. All offsets and the stride are in
+    /// bytes and must be multiples of 4, since the shader writes the buffer in 32-bit words.
+    struct GridLayout
+    {
+      GridLayout(size_t stride = 3 * sizeof(float))
+        : stride(stride), positionOffset(0), directionOffset(-1), normalOffset(-1), heightOffset(-1)
+      {
+      }
+
+      size_t  stride;
+      int     positionOffset;   // vec3 on the sphere of the given radius, or -1 to leave out
+      int     directionOffset;  // unit direction from the centre as an octahedral VertexFormat::SNorm16x2, or -1 to leave out
+      int     normalOffset;     // vec3 unit normal, or -1 to leave out
+      int     heightOffset;   // float terrain height from GetHeightAt, or -1 to leave out
+    };
+
+    /// Writes the same grids as GridBuilder straight into a VertexBuffer on the GPU, which
+    /// the buffer is bound to as a shader storage block. Nothing is computed or copied on the
+    /// CPU, so a grid can be rebuilt at a new resolution for the cost of a dispatch.
+    ///
+    /// The compute shader is compiled by the application from its own resources; it must
+    /// declare a std430 "uint[]" storage block at binding 0 and the uniforms set below
+    /// (see grid.cs.glsl in theia_test). GridBuilder remains the reference implementation
+    /// and the fallback where compute shaders aren't available.
+    struct GpuGridBuilder
+    {
+      /// Dispatches work in tiles of LocalSize x LocalSize vertices, which must match the
+      /// shader's local_size_x and local_size_y.
+      static const int LocalSize = 16;
+
+      /// Whether the context has compute shaders (GL 4.3).
+      static bool IsSupported();
+
+      /// Returns NULL if the shader is missing any of the parameters the builder sets.
+      static GpuGridBuilderPtr Create(const ShaderPtr& shader);
+
+      /// Build a grid over a square region of one face.
+      ///
+      /// @param[in] buffer          Buffer to write into.
+      /// @param[in] firstVertex     Index of the vertex to write the grid's (0,0) corner to.
+      /// @param[in] origin          Face coordinate of the grid's (0,0) corner.
+      /// @param[in] size            Extent of the grid in face coordinates.
+      /// @param[in] verticesPerEdge Number of vertices along each edge of the grid.
+      /// @return false if the layout can't be written.
+      bool BuildPatch(VertexBuffer& buffer, size_t firstVertex, int face, const glm::vec2& origin, float size,
+                      int verticesPerEdge, float radius, const GridLayout& layout);
+
+      /// Build a whole-face grid for each of the six faces, one after another, in one dispatch.
+      bool BuildFaces(VertexBuffer& buffer, size_t firstVertex, int verticesPerEdge, float radius, const GridLayout& layout);
+
+    private:
+      GpuGridBuilder();
+
+      bool Dispatch(VertexBuffer& buffer, size_t firstVertex, int firstFace, int numFaces, const glm::vec2& origin, float size,
+                    int verticesPerEdge, float radius, const GridLayout& layout);
+
+      ShaderPtr shader;
+      Shader::Parameter* firstFaceParam;
+      Shader::Parameter* originParam;
+      Shader::Parameter* sizeParam;
+      Shader::Parameter* verticesPerEdgeParam;
+      Shader::Parameter* radiusParam;
+      Shader::Parameter* firstValueParam;
+      Shader::Parameter* strideParam;
+      Shader::Parameter* positionOffsetParam;
+      Shader::Parameter* directionOffsetParam;
+      Shader::Parameter* normalOffsetParam;
+      Shader::Parameter* heightOffsetParam;
+    };
+  }
+}
+
+#endif // __THEIA_TERRAIN_GPU_GRID_BUILDER__
@@ -0,0 +1,42 @@
+/// Vectorised generation of cube-sphere grid vertices.
+
+#if ! defined(__THEIA_TERRAIN_GRID_BUILDER__)
+#define __THEIA_TERRAIN_GRID_BUILDER__
+
+#include <stddef.h>
+#include <glm/glm.hpp>
+#include <theia/misc/job_system.h>
+
+namespace theia
+{
+  namespace terrain
+  {
+    namespace GridBuilder
+    {
+      /// Map rows of a regular grid over a square region of a cube face onto the sphere.
+      ///
+      /// Each row is built in chunks with SSE (or AVX when compiled with /arch:AVX): the
+      /// chunk is computed as separate x, y and z arrays and then interleaved straight into
+      /// the destination, which can be a mapped GL buffer.
+      ///
+      /// @param[in]  origin          Face coordinate of the grid's (0,0) corner.
+      /// @param[in]  size            Extent of the grid in face coordinates.
+      /// @param[in]  verticesPerEdge Number of vertices along each edge of the grid.
+      /// @param[in]  firstRow        First row to build.
+      /// @param[in]  numRows         Number of rows to build.
+      /// @param[out] positions       Position of the grid's first vertex, *not* of firstRow.
+      /// @param[in]  stride          Distance in bytes between consecutive vertices.
+      void BuildRows(int face, const glm::vec2& origin, float size, int verticesPerEdge, float radius,
+                     int firstRow, int numRows, void* positions, size_t stride);
+
+      /// Build a whole-face grid for each of the six faces, one after another, with bands of
+      /// rows spread across a job system.
+      ///
+      /// @param[in]  jobs      Job system to run on, or NULL to build everything on the calling thread.
+      /// @param[out] positions Position of face 0's first vertex.
+      void BuildFaces(JobSystem* jobs, int verticesPerEdge, float radius, void* positions, size_t stride);
+    }
+  }
+}
+
+#endif // __THEIA_TERRAIN_GRID_BUILDER__
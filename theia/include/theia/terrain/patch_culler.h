@@ -0,0 +1,60 @@
+/// CPU visibility tests for cube-sphere faces and quadtree patches.
+
+#if ! defined(__THEIA_TERRAIN_PATCH_CULLER__)
+#define __THEIA_TERRAIN_PATCH_CULLER__
+
+#include <glm/glm.hpp>
+#include <theia/math/frustum.h>
+
+namespace theia
+{
+  namespace terrain
+  {
+    struct CullStats
+    {
+      CullStats();
+
+      int tested;         // number of faces or patches tested
+      int frustumCulled;  // ...rejected because they lie outside the view frustum
+      int horizonCulled;  // ...rejected because they lie behind the horizon
+      int drawn;          // number of faces or patches that went on to be drawn
+    };
+
+    /// Rejects faces and patches which cannot contribute to the image. Two tests are made:
+    ///  - the patch's bounding box against the planes of the view frustum;
+    ///  - the patch's bounding cone against the horizon of an occluding sphere centred on the
+    ///    origin, i.e. the part of the planet the eye cannot see round.
+    struct PatchCuller
+    {
+      enum Result
+      {
+        Culled,       // the patch, and anything inside it, is not visible
+        Visible,      // the patch may be visible
+        FullyVisible  // the patch lies wholly inside the frustum, so its children needn't test the planes
+      };
+
+      /// @param[in] projection     (perspective * view * world) of the sphere, so that the frustum
+      ///                           planes end up in the sphere's object space.
+      /// @param[in] eyePosition    The eye in the sphere's object space.
+      /// @param[in] occluderRadius Radius of a sphere lying wholly beneath the rendered surface.
+      /// @param[in] surfaceRadius  Largest distance of the rendered surface from the origin.
+      PatchCuller(const glm::mat4& projection, const glm::vec3& eyePosition, float occluderRadius, float surfaceRadius);
+
+      /// Test a square region of a cube face.
+      ///
+      /// @param[in] testFrustum  False if the region's parent was FullyVisible.
+      Result Test(int face, const glm::vec2& origin, float size, const glm::vec3& boundsMin, const glm::vec3& boundsMax, bool testFrustum);
+
+      /// Return the radius of a sphere which lies beneath every triangle of a grid with the
+      /// given number of quads along the edge of a cube face.
+      static float ComputeOccluderRadius(float radius, int quadsPerFace);
+
+      Frustum   frustum;
+      glm::vec3 eyeDirection;
+      float     horizonAngle; // angle from eyeDirection beyond which the surface is out of sight (or < 0 to disable)
+      CullStats stats;
+    };
+  }
+}
+
+#endif // __THEIA_TERRAIN_PATCH_CULLER__
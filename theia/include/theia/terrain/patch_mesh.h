@@ -0,0 +1,43 @@
+/// A single grid mesh shared by every quadtree patch of a planet.
+
+#if ! defined(__THEIA_TERRAIN_PATCH_MESH__)
+#define __THEIA_TERRAIN_PATCH_MESH__
+
+#include <boost/shared_ptr.hpp>
+#include <theia/graphics/index_buffer.h>
+#include <theia/graphics/gl/gl_loader.h>
+
+namespace theia
+{
+  namespace terrain
+  {
+    struct PatchMesh;
+    typedef boost::shared_ptr<PatchMesh> PatchMeshPtr;
+
+    /// The indices of a (resolution+1)^2 grid drawn as a triangle list.
+    ///
+    /// There is no vertex buffer: the vertex shader derives the grid coordinate from
+    /// (gl_VertexID % verticesPerPatch) and the patch from (gl_VertexID / verticesPerPatch),
+    /// so patch n is drawn with a base vertex of (n * verticesPerPatch). That lets any number
+    /// of patches go out in one multi-draw call, with or without baseInstance support.
+    struct PatchMesh
+    {
+      /// Build the mesh and a vertex array object holding its index buffer.
+      ///
+      /// @param[in] resolution Number of quads along each edge. Must be even so that vertices
+      ///                       can morph onto a grid of half the resolution.
+      static PatchMeshPtr Create(int resolution);
+
+      PatchMesh();
+      ~PatchMesh();
+
+      int             resolution;
+      GLsizei         numIndices;
+      GLint           verticesPerPatch;
+      GLuint          vao;
+      IndexBufferPtr  indices;
+    };
+  }
+}
+
+#endif // __THEIA_TERRAIN_PATCH_MESH__
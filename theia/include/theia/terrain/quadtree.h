@@ -0,0 +1,69 @@
+/// Chunked quadtree level-of-detail selection over the six faces of a cube-sphere.
+
+#if ! defined(__THEIA_TERRAIN_QUADTREE__)
+#define __THEIA_TERRAIN_QUADTREE__
+
+#include <stddef.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace theia
+{
+  namespace terrain
+  {
+    struct PatchCuller;
+
+    /// One selected node of the quadtree, rendered with the shared patch mesh.
+    struct Patch
+    {
+      int       face;       // cube face the patch lies on
+      int       level;      // depth in the quadtree (0 == whole face)
+      glm::vec2 origin;     // face coordinate of the patch's (0,0) corner
+      float     size;       // extent of the patch in face coordinates (== 1 / 2^level)
+      glm::vec2 morphRange; // start and end distances over which vertices morph onto the parent's grid
+      glm::vec3 boundsMin;  // object-space bounding box of the patch surface
+      glm::vec3 boundsMax;
+    };
+
+    struct QuadtreeSettings
+    {
+      QuadtreeSettings();
+
+      float radius;               // radius of the sphere
+      int   patchResolution;      // number of quads along each edge of the patch mesh (must be even)
+      int   maxLevel;             // deepest level the tree may be split to
+      float maxScreenSpaceError;  // largest allowed projected size of a patch quad, in pixels
+      float morphRatio;           // fraction of each level's range over which vertices morph, in (0,1]
+    };
+
+    struct Quadtree
+    {
+      Quadtree(const QuadtreeSettings& settings);
+
+      /// Compute the scale which converts a world-space size at unit distance into pixels.
+      ///
+      /// @param[in] viewportHeight Height of the viewport in pixels.
+      /// @param[in] fovY           Vertical field of view in degrees (as passed to glm::perspective).
+      static float ComputeLODScale(float viewportHeight, float fovY);
+
+      /// Choose the patches which give the required screen-space error for an eye position.
+      /// Patches are split when the eye is close enough for their quads to exceed the error
+      /// bound and merged back again once it moves away.
+      ///
+      /// @param[in]  eyePosition The eye position in the object space of the sphere.
+      /// @param[in]  lodScale    As returned by ComputeLODScale.
+      /// @param[out] patches     Receives the selected patches (the vector is cleared first).
+      /// @param[in]  culler      If given, nodes it rejects are skipped along with all their children.
+      void Select(const glm::vec3& eyePosition, float lodScale, std::vector<Patch>& patches, PatchCuller* culler = NULL) const;
+
+      /// As Select, for a single cube face, appending to patches rather than clearing them.
+      /// Faces are independent, so they may be selected on different threads as long as each
+      /// has its own patches and culler.
+      void SelectFace(int face, const glm::vec3& eyePosition, float lodScale, std::vector<Patch>& patches, PatchCuller* culler = NULL) const;
+
+      QuadtreeSettings settings;
+    };
+  }
+}
+
+#endif // __THEIA_TERRAIN_QUADTREE__
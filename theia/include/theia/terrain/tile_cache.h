@@ -0,0 +1,163 @@
+/// Baked terrain tiles for quadtree patches, streamed into a texture array.
+
+#if ! defined(__THEIA_TERRAIN_TILE_CACHE__)
+#define __THEIA_TERRAIN_TILE_CACHE__
+
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <glm/glm.hpp>
+#include <theia/graphics/texture_array.h>
+#include <theia/math/noise.h>
+
+namespace theia
+{
+  namespace terrain
+  {
+    struct Patch;
+    struct TileCache;
+    typedef boost::shared_ptr<TileCache> TileCachePtr;
+    struct TileStore;
+    typedef boost::shared_ptr<TileStore> TileStorePtr;
+
+    /// Identifies the tile of one quadtree node. x and y count nodes across the face at that level.
+    struct TileKey
+    {
+      int face;
+      int level;
+      int x;
+      int y;
+
+      static TileKey FromPatch(const Patch& patch);
+
+      /// The key of the node's parent. Must not be called on a root node.
+      TileKey Parent() const;
+
+      bool operator<(const TileKey& other) const;
+    };
+
+    struct TileCacheSettings
+    {
+      TileCacheSettings();
+
+      int                     tileSize;               // texels along each edge of a tile
+      int                     capacity;               // number of tiles held (layers of the texture array)
+      int                     numWorkers;             // threads baking tiles (0 == one fewer than the hardware threads, at least 1)
+      size_t                  maxUploadBytesPerFrame; // texture data uploaded per frame at most
+      float                   maxUploadMilliseconds;  // time spent uploading per frame at most
+      Noise::FractalSettings  noise;                  // the terrain height function baked into the tiles
+    };
+
+    struct TileCacheStats
+    {
+      TileCacheStats();
+
+      int hits;       // tiles found already baked
+      int fallbacks;  // tiles drawn with an ancestor's tile while their own is baked
+      int requests;   // tiles queued for baking
+      int uploads;    // baked tiles copied into the texture array
+      int evictions;  // tiles thrown out to make room
+      int overflows;  // baked tiles dropped because every layer was in use
+    };
+
+    /// Where a patch finds its terrain: a layer of the texture array, and the part of that
+    /// layer's tile which covers the patch.
+    struct TileRef
+    {
+      int       layer;  // -1 if no tile covers the patch yet
+      glm::vec2 offset; // tile coordinate of the patch's (0,0) corner
+      float     scale;  // extent of the patch in tile coordinates
+    };
+
+    /// Holds a GL_RG16F texture array tile per patch: red is the terrain height and green is 1
+    /// on land and 0 at sea. Texel (i,j) of a tile is the surface at face coordinate
+    /// origin + (size * (i,j) / (tileSize-1)), so neighbouring tiles agree along their edges.
+    ///
+    /// Missing tiles are baked on worker threads, most important first, and copied into the
+    /// texture at the start of a frame within a byte and time budget. Until then a patch is
+    /// drawn with the part of its nearest resident ancestor's tile which covers it.
+    ///
+    /// The least recently drawn tile is evicted first when a layer is needed, so a tile is only
+    /// baked again once its node has gone out of view for long enough to be forgotten.
+    struct TileCache
+    {
+      /// @param[in] store If given, tiles are read from it instead of being baked when it has
+      ///                  them, and newly baked tiles are added to it.
+      static TileCachePtr Create(const TileCacheSettings& settings, const TileStorePtr& store = TileStorePtr());
+
+      TileCache();
+      ~TileCache();
+
+      /// Start a new frame: upload tiles baked since the last frame, within the budget.
+      void BeginFrame();
+
+      /// Find the tile to draw a patch with. If the patch's own tile isn't resident it is
+      /// requested, and an ancestor's is returned in its place.
+      ///
+      /// @param[in] priority Importance of the patch's tile, e.g. its projected size. Higher
+      ///                     priority tiles are baked first.
+      TileRef Acquire(const Patch& patch, float priority);
+
+      /// Hand the frame's requests to the workers. Requests from earlier frames which haven't
+      /// started baking are dropped, so tiles which went out of view aren't baked needlessly.
+      void EndFrame();
+
+      TileCacheSettings settings;
+      TextureArrayPtr   texture;
+      TileStorePtr      store;
+      TileCacheStats    stats;      // counted since the last call to BeginFrame
+
+      struct Entry
+      {
+        int                           layer;
+        unsigned int                  lastUsed;
+        std::list<TileKey>::iterator  lru;
+      };
+
+      struct Request
+      {
+        TileKey key;
+        float   priority;
+
+        bool operator<(const Request& other) const { return priority < other.priority; }
+      };
+
+      struct BakedTile
+      {
+        TileKey                 key;
+        std::vector<glm::vec2>  texels;
+      };
+      typedef boost::shared_ptr<BakedTile> BakedTilePtr;
+
+      // Owned by the render thread...
+      unsigned int                frame;
+      std::map<TileKey, Entry>    entries;
+      std::list<TileKey>          lru;          // most recently used first
+      std::vector<int>            freeLayers;
+      std::vector<Request>        frameRequests;
+
+      // Shared with the workers...
+      boost::mutex                mutex;
+      boost::condition_variable   requestReady;
+      std::vector<Request>        queue;        // heap, highest priority first
+      std::set<TileKey>           outstanding;  // queued, baking or baked but not uploaded
+      std::deque<BakedTilePtr>    baked;
+      bool                        quit;
+      std::vector<boost::thread*> workers;
+
+      bool Touch(const TileKey& key, int& layer);
+      int AllocateLayer();
+      void Upload(const BakedTile& tile);
+      void WorkerMain();
+      void Bake(BakedTile& tile) const;
+    };
+  }
+}
+
+#endif // __THEIA_TERRAIN_TILE_CACHE__
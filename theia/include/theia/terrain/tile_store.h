@@ -0,0 +1,90 @@
+/// A memory-mapped file of baked terrain tiles which persists between runs.
+
+#if ! defined(__THEIA_TERRAIN_TILE_STORE__)
+#define __THEIA_TERRAIN_TILE_STORE__
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <glm/glm.hpp>
+#include <theia/math/noise.h>
+#include <theia/terrain/tile_cache.h>
+
+namespace theia
+{
+  namespace terrain
+  {
+    struct TileStore;
+    typedef boost::shared_ptr<TileStore> TileStorePtr;
+
+    /// Tiles are kept in one file per combination of tile size and noise parameters, named
+    /// terrain_<hash>.tiles, so changing GetHeightAt's octaves, lacunarity or gain starts a
+    /// fresh store rather than reading stale tiles. The file is a header, an index of
+    /// (face, level, x, y) keys and then fixed-size slots of tile texels, all mapped into
+    /// memory. It is created at its full size so it never needs remapping, and once every
+    /// slot is used new tiles are simply not stored.
+    ///
+    /// Read and Write may be called from any thread.
+    struct TileStore
+    {
+      /// Bumped whenever the file layout or the meaning of the texels changes.
+      static const uint32_t Version = 1;
+
+      /// Open the store for a tile size and noise function in a directory, creating it if it
+      /// doesn't exist or was written by a different version.
+      /// Returns NULL if the file can't be created or mapped.
+      ///
+      /// @param[in] capacity Number of tiles the file can hold if it has to be created.
+      static TileStorePtr Open(const std::string& directory, int tileSize, const Noise::FractalSettings& noise, int capacity);
+
+      /// Hash of everything which affects the contents of a tile.
+      static uint32_t ComputeHash(int tileSize, const Noise::FractalSettings& noise);
+
+      TileStore();
+      ~TileStore();
+
+      /// Copy a stored tile's texels out. Returns false if the tile isn't in the store.
+      bool Read(const TileKey& key, std::vector<glm::vec2>& texels) const;
+
+      /// Add a tile to the store, waiting for its texels to reach the disk. Returns false if
+      /// the store is full or the texels couldn't be flushed.
+      bool Write(const TileKey& key, const std::vector<glm::vec2>& texels);
+
+      struct FileHeader
+      {
+        char      magic[4];
+        uint32_t  version;
+        uint32_t  tileSize;
+        uint32_t  hash;
+        uint32_t  capacity;
+      };
+
+      struct IndexEntry
+      {
+        int32_t face;
+        int32_t level;    // < 0 for an unused slot
+        int32_t x;
+        int32_t y;
+      };
+
+      std::string                           path;
+      boost::interprocess::file_mapping     file;
+      boost::interprocess::mapped_region    region;
+      FileHeader*                           header;
+      IndexEntry*                           index;
+      char*                                 slots;
+      size_t                                slotSizeInBytes;
+
+      mutable boost::mutex                  mutex;
+      std::map<TileKey, int>                slotOf;
+      int                                   nextSlot;
+    };
+  }
+}
+
+#endif // __THEIA_TERRAIN_TILE_STORE__
@@ -0,0 +1,129 @@
+#include <theia/graphics/depth_prepass.h>
+
+using namespace theia;
+
+//--------------------------------------------------------------------------------
+
+namespace
+{
+  enum Pass
+  {
+    Pass_Depth,
+    Pass_Shading
+  };
+}
+
+//--------------------------------------------------------------------------------
+
+DepthPrepassPtr DepthPrepass::Create()
+{
+  return DepthPrepassPtr(new DepthPrepass());
+}
+
+DepthPrepass::DepthPrepass()
+  : slot(0), activePass(-1)
+{
+  glGenQueries(Latency * 2, &queries[0][0]);
+  for (int i = 0; i < Latency; ++i)
+  {
+    used[i][Pass_Depth] = false;
+    used[i][Pass_Shading] = false;
+  }
+}
+
+DepthPrepass::~DepthPrepass()
+{
+  glDeleteQueries(Latency * 2, &queries[0][0]);
+}
+
+void DepthPrepass::BeginDepthPass()
+{
+  // The slot was last used Latency frames ago, so its results should be ready by now...
+  CollectFrame(slot);
+
+  glDepthFunc(GL_LESS);
+  glDepthMask(GL_TRUE);
+  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+  glBeginQuery(GL_SAMPLES_PASSED, queries[slot][Pass_Depth]);
+  used[slot][Pass_Depth] = true;
+  activePass = Pass_Depth;
+}
+
+void DepthPrepass::BeginShadingPass()
+{
+  const bool afterDepthPass = (Pass_Depth == activePass);
+  if (afterDepthPass)
+  {
+    EndQuery();
+    glDepthFunc(GL_EQUAL);
+    glDepthMask(GL_FALSE);
+  }
+  else
+  {
+    CollectFrame(slot);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+  }
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+  glBeginQuery(GL_SAMPLES_PASSED, queries[slot][Pass_Shading]);
+  used[slot][Pass_Shading] = true;
+  activePass = Pass_Shading;
+}
+
+void DepthPrepass::End()
+{
+  EndQuery();
+
+  glDepthFunc(GL_LESS);
+  glDepthMask(GL_TRUE);
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+  slot = (slot + 1) % Latency;
+}
+
+//--------------------------------------------------------------------------------
+
+void DepthPrepass::EndQuery()
+{
+  if (activePass >= 0)
+  {
+    glEndQuery(GL_SAMPLES_PASSED);
+    activePass = -1;
+  }
+}
+
+void DepthPrepass::CollectFrame(int frame)
+{
+  if (!used[frame][Pass_Shading])
+  {
+    return;
+  }
+
+  const bool depthPassUsed = used[frame][Pass_Depth];
+  used[frame][Pass_Depth] = false;
+  used[frame][Pass_Shading] = false;
+
+  // The shading pass's query was issued last, so if it has finished both have...
+  GLint available = 0;
+  glGetQueryObjectiv(queries[frame][Pass_Shading], GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available)
+  {
+    ++stats.droppedFrames;
+    return;
+  }
+
+  GLuint64 shaded = 0;
+  glGetQueryObjectui64v(queries[frame][Pass_Shading], GL_QUERY_RESULT, &shaded);
+  stats.shadedSamples += shaded;
+
+  // Without a depth pass, everything which passed was shaded, and nothing was saved...
+  GLuint64 depth = shaded;
+  if (depthPassUsed)
+  {
+    glGetQueryObjectui64v(queries[frame][Pass_Depth], GL_QUERY_RESULT, &depth);
+  }
+  stats.depthSamples += depth;
+  ++stats.frames;
+}
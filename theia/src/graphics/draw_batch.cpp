@@ -0,0 +1,83 @@
+#include <theia/graphics/draw_batch.h>
+#include <theia/misc/profiler.h>
+
+using namespace theia;
+
+//--------------------------------------------------------------------------------
+
+DrawBatch::DrawBatch()
+  : useIndirect(IsIndirectSupported()),
+    indirectCapacity(0),
+    indirectDirty(true)
+{
+}
+
+bool DrawBatch::IsIndirectSupported()
+{
+  return (NULL != glMultiDrawElementsIndirect);
+}
+
+void DrawBatch::Clear()
+{
+  commands.clear();
+  indirectDirty = true;
+}
+
+void DrawBatch::Add(GLuint count, GLuint firstIndex, GLint baseVertex, GLuint baseInstance)
+{
+  DrawElementsIndirectCommand command;
+  command.count = count;
+  command.instanceCount = 1;
+  command.firstIndex = firstIndex;
+  command.baseVertex = baseVertex;
+  command.baseInstance = baseInstance;
+  commands.push_back(command);
+  indirectDirty = true;
+}
+
+void DrawBatch::Submit(GLenum mode, GLenum indexType)
+{
+  PROFILE_SCOPE("DrawBatch::Submit");
+  if (commands.empty())
+  {
+    return;
+  }
+
+  if (useIndirect)
+  {
+    // Grow the command buffer geometrically so that it settles after a few frames...
+    if (commands.size() > indirectCapacity)
+    {
+      indirectCapacity = (indirectCapacity > 0) ? indirectCapacity : 64;
+      while (indirectCapacity < commands.size()) { indirectCapacity *= 2; }
+      indirect = IndirectBuffer::Create(indirectCapacity * sizeof(DrawElementsIndirectCommand));
+      indirectDirty = true;
+    }
+
+    // A batch which is built once and submitted every frame only uploads on the first Submit...
+    if (indirectDirty)
+    {
+      indirect->SetData(commands.size() * sizeof(DrawElementsIndirectCommand), 0, commands.data());
+      indirectDirty = false;
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect->buffer);
+    glMultiDrawElementsIndirect(mode, indexType, (const void*)0, (GLsizei)commands.size(), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  }
+  else
+  {
+    const size_t indexSize = (GL_UNSIGNED_INT == indexType) ? sizeof(GLuint) : sizeof(GLushort);
+
+    counts.resize(commands.size());
+    offsets.resize(commands.size());
+    baseVertices.resize(commands.size());
+    for (size_t i = 0; i < commands.size(); ++i)
+    {
+      counts[i] = (GLsizei)commands[i].count;
+      offsets[i] = (const void*)(commands[i].firstIndex * indexSize);
+      baseVertices[i] = commands[i].baseVertex;
+    }
+    glMultiDrawElementsBaseVertex(mode, counts.data(), indexType, offsets.data(), (GLsizei)commands.size(), baseVertices.data());
+  }
+}
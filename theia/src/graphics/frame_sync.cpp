@@ -0,0 +1,133 @@
+#include <theia/graphics/frame_sync.h>
+#include <theia/misc/debug.h>
+#include <theia/misc/frame_clock.h>
+#include <theia/misc/profiler.h>
+
+using namespace theia;
+
+//--------------------------------------------------------------------------------
+
+namespace
+{
+  // How long each wait blocks before trying again, in nanoseconds...
+  const GLuint64 WaitTimeout = 1000000;
+
+  int ClampFramesInFlight(int count)
+  {
+    if (count < 1) { return 1; }
+    if (count > FrameSync::MaxFramesInFlight) { return FrameSync::MaxFramesInFlight; }
+    return count;
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+bool FrameSync::IsSupported()
+{
+  return (NULL != glFenceSync) && (NULL != glClientWaitSync) && (NULL != glDeleteSync);
+}
+
+FrameSyncPtr FrameSync::Create(int framesInFlight)
+{
+  if (!IsSupported())
+  {
+    LOG("fence syncs are not supported: frames in flight are left to the driver\n");
+  }
+  return FrameSyncPtr(new FrameSync(ClampFramesInFlight(framesInFlight)));
+}
+
+FrameSync::FrameSync(int framesInFlight)
+  : framesInFlight(framesInFlight), slot(-1), frame(0)
+{
+  for (int i = 0; i < MaxFramesInFlight; ++i)
+  {
+    fences[i] = NULL;
+  }
+}
+
+FrameSync::~FrameSync()
+{
+  for (int i = 0; i < MaxFramesInFlight; ++i)
+  {
+    if (NULL != fences[i]) { glDeleteSync(fences[i]); }
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+int FrameSync::BeginFrame()
+{
+  slot = (slot + 1) % framesInFlight;
+  ++frame;
+
+  // The slot's fence was set framesInFlight frames ago...
+  const double start = FrameClock::Now();
+  const bool stalled = (NULL != fences[slot]) && (GL_TIMEOUT_EXPIRED == glClientWaitSync(fences[slot], 0, 0));
+  WaitForSlot(slot);
+  ++stats.frames;
+  if (stalled)
+  {
+    ++stats.stalls;
+    stats.waitMS += (FrameClock::Now() - start) * 1000.0;
+  }
+  return slot;
+}
+
+void FrameSync::EndFrame()
+{
+  ASSERT(slot >= 0);
+  if (IsSupported())
+  {
+    ASSERT(NULL == fences[slot]);
+    fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+}
+
+void FrameSync::SetFramesInFlight(int count)
+{
+  count = ClampFramesInFlight(count);
+  if (count == framesInFlight)
+  {
+    return;
+  }
+
+  // Slots are about to be renumbered, so nothing may still be using any of them...
+  for (int i = 0; i < framesInFlight; ++i)
+  {
+    WaitForSlot(i);
+  }
+  framesInFlight = count;
+  slot = -1;
+}
+
+//--------------------------------------------------------------------------------
+
+void FrameSync::WaitForSlot(int index)
+{
+  if (NULL == fences[index])
+  {
+    return;
+  }
+  PROFILE_SCOPE("FrameSync::Wait");
+
+  // The first wait flushes, in case the fence is still sitting in an unsubmitted command
+  // buffer, which would otherwise never signal...
+  GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+  for (;;)
+  {
+    const GLenum result = glClientWaitSync(fences[index], flags, WaitTimeout);
+    if (GL_WAIT_FAILED == result)
+    {
+      LOG("glClientWaitSync failed\n");
+      break;
+    }
+    if (GL_TIMEOUT_EXPIRED != result)
+    {
+      break;
+    }
+    flags = 0;
+  }
+
+  glDeleteSync(fences[index]);
+  fences[index] = NULL;
+}
@@ -86,6 +86,11 @@ static PROC WinGetProcAddress(const char *name)
 	#else
 		#if defined(__sgi) || defined(__sun)
 			#define IntGetProcAddress(name) SunGetProcAddress(name)
+		#elif defined(THEIA_EGL) /* EGL, for contexts with no window or display */
+		    #define EGL_NO_X11
+		    #include <EGL/egl.h>
+
+			#define IntGetProcAddress(name) eglGetProcAddress(name)
 		#else /* GLX */
 		    #include <GL/glx.h>
 
@@ -1880,9 +1885,9 @@ int ogl_LoadFunctions()
   int numFailed = 0;
   ClearExtensionVars();
   
-  _ptrc_glGetIntegerv = (void (__stdcall *)(GLenum,GLint*))IntGetProcAddress("glGetIntegerv");
+  _ptrc_glGetIntegerv = (void (CODEGEN_FUNCPTR *)(GLenum,GLint*))IntGetProcAddress("glGetIntegerv");
   if(!_ptrc_glGetIntegerv) return ogl_LOAD_FAILED;
-  _ptrc_glGetStringi = (const GLubyte* (__stdcall *)(GLenum,GLuint))IntGetProcAddress("glGetStringi");
+  _ptrc_glGetStringi = (const GLubyte* (CODEGEN_FUNCPTR *)(GLenum,GLuint))IntGetProcAddress("glGetStringi");
   if(!_ptrc_glGetStringi) return ogl_LOAD_FAILED;
   
   ProcExtsFromExtList();
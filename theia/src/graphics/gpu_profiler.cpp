@@ -0,0 +1,182 @@
+#include <string.h>
+#include <algorithm>
+#include <theia/graphics/gpu_profiler.h>
+#include <theia/misc/debug.h>
+
+using namespace theia;
+
+//--------------------------------------------------------------------------------
+
+namespace
+{
+  // GPU and CPU clocks drift apart slowly, so are only compared every so often...
+  const int CalibrationInterval = 300;
+
+  struct MoreExpensive
+  {
+    bool operator()(const ProfileSummaryEntry& a, const ProfileSummaryEntry& b) const { return a.totalMS > b.totalMS; }
+  };
+}
+
+//--------------------------------------------------------------------------------
+
+bool GpuProfiler::IsSupported()
+{
+  return (NULL != glQueryCounter) && (NULL != glGetQueryObjectui64v) && (NULL != glGetInteger64v);
+}
+
+GpuProfilerPtr GpuProfiler::Create()
+{
+  if (!IsSupported())
+  {
+    LOG("timestamp queries are not supported: GPU scopes won't be timed\n");
+  }
+  return GpuProfilerPtr(new GpuProfiler());
+}
+
+GpuProfiler::GpuProfiler()
+  : droppedFrames(0), slot(0), track(-1), clockOffset(0), framesSinceCalibration(0), summaryFrames(0)
+{
+  for (int i = 0; i < Latency; ++i)
+  {
+    numScopes[i] = 0;
+    lastQuery[i] = -1;
+  }
+
+  if (IsSupported())
+  {
+    glGenQueries(Latency * MaxScopes * 2, &queries[0][0]);
+    track = Profiler::AddTrack("GPU");
+    Calibrate();
+  }
+}
+
+GpuProfiler::~GpuProfiler()
+{
+  if (IsSupported())
+  {
+    glDeleteQueries(Latency * MaxScopes * 2, &queries[0][0]);
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+void GpuProfiler::BeginFrame()
+{
+  if (!IsSupported())
+  {
+    return;
+  }
+
+  slot = (slot + 1) % Latency;
+  Collect(slot);
+
+  if (++framesSinceCalibration >= CalibrationInterval)
+  {
+    Calibrate();
+  }
+}
+
+int GpuProfiler::BeginScope(const char* name)
+{
+  if (!IsSupported() || (numScopes[slot] == MaxScopes))
+  {
+    return -1;
+  }
+
+  const int scope = numScopes[slot]++;
+  names[slot][scope] = name;
+  ended[slot][scope] = false;
+  glQueryCounter(queries[slot][scope * 2], GL_TIMESTAMP);
+  lastQuery[slot] = scope * 2;
+  return scope;
+}
+
+void GpuProfiler::EndScope(int scope)
+{
+  if (scope < 0)
+  {
+    return;
+  }
+
+  ASSERT(!ended[slot][scope]);
+  glQueryCounter(queries[slot][(scope * 2) + 1], GL_TIMESTAMP);
+  lastQuery[slot] = (scope * 2) + 1;
+  ended[slot][scope] = true;
+}
+
+//--------------------------------------------------------------------------------
+
+int GpuProfiler::TakeSummary(std::vector<ProfileSummaryEntry>& entries)
+{
+  entries = summary;
+  std::sort(entries.begin(), entries.end(), MoreExpensive());
+
+  const int frames = summaryFrames;
+  summary.clear();
+  summaryFrames = 0;
+  return frames;
+}
+
+//--------------------------------------------------------------------------------
+
+void GpuProfiler::Collect(int frame)
+{
+  const int count = numScopes[frame];
+  const int last = lastQuery[frame];
+  numScopes[frame] = 0;
+  lastQuery[frame] = -1;
+  if ((0 == count) || (last < 0))
+  {
+    return;
+  }
+
+  // Queries complete in the order they were issued, so if the last one issued has finished
+  // they all have. That isn't the last scope's end when scopes nest: an outer scope ends
+  // after the scopes inside it...
+  GLint available = 0;
+  glGetQueryObjectiv(queries[frame][last], GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available)
+  {
+    ++droppedFrames;
+    return;
+  }
+
+  for (int scope = 0; scope < count; ++scope)
+  {
+    if (!ended[frame][scope]) { continue; }
+
+    GLuint64 begin = 0;
+    GLuint64 end = 0;
+    glGetQueryObjectui64v(queries[frame][scope * 2], GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(queries[frame][(scope * 2) + 1], GL_QUERY_RESULT, &end);
+    const char* const name = names[frame][scope];
+    Profiler::RecordOnTrack(track, name, (int64_t)begin + clockOffset, (int64_t)end + clockOffset);
+
+    const double ms = (double)(end - begin) / 1.0e6;
+    size_t i = 0;
+    while ((i < summary.size()) && (0 != strcmp(summary[i].name, name))) { ++i; }
+    if (i == summary.size())
+    {
+      ProfileSummaryEntry entry;
+      entry.name = name;
+      entry.calls = 0;
+      entry.totalMS = 0;
+      entry.maxMS = 0;
+      summary.push_back(entry);
+    }
+    ++summary[i].calls;
+    summary[i].totalMS += ms;
+    if (ms > summary[i].maxMS) { summary[i].maxMS = ms; }
+  }
+  ++summaryFrames;
+}
+
+void GpuProfiler::Calibrate()
+{
+  // The GL's idea of the time now, next to the CPU profiler's...
+  GLint64 gpuNow = 0;
+  glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+  clockOffset = Profiler::Now() - (int64_t)gpuNow;
+  framesSinceCalibration = 0;
+}
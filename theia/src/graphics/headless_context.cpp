@@ -0,0 +1,259 @@
+#include <string.h>
+#include <theia/graphics/headless_context.h>
+#include <theia/misc/debug.h>
+#include <theia/misc/png_writer.h>
+#if defined(THEIA_EGL)
+  #define EGL_NO_X11
+  #include <EGL/egl.h>
+  #include <EGL/eglext.h>
+#endif
+
+using namespace theia;
+
+//--------------------------------------------------------------------------------
+
+#if defined(THEIA_EGL)
+
+namespace
+{
+  bool HasExtension(const char* extensions, const char* name)
+  {
+    if (NULL == extensions)
+    {
+      return false;
+    }
+    const size_t length = strlen(name);
+    for (const char* found = strstr(extensions, name); NULL != found; found = strstr(found + length, name))
+    {
+      if (((found == extensions) || (' ' == found[-1])) && (('\0' == found[length]) || (' ' == found[length])))
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Mesa's surfaceless platform needs no display server at all; failing that, the default
+  // display, which may need one...
+  EGLDisplay GetDisplay()
+  {
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (HasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+    {
+      PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+      if (NULL != getPlatformDisplay)
+      {
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if (EGL_NO_DISPLAY != display)
+        {
+          return display;
+        }
+      }
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+}
+
+#endif
+
+//--------------------------------------------------------------------------------
+
+bool HeadlessContext::IsSupported()
+{
+#if defined(THEIA_EGL)
+  return true;
+#else
+  return false;
+#endif
+}
+
+HeadlessContextPtr HeadlessContext::Create(int width, int height)
+{
+  if (!IsSupported())
+  {
+    LOG("headless contexts need a build with EGL (THEIA_EGL)\n");
+    return HeadlessContextPtr();
+  }
+
+  HeadlessContextPtr headless(new HeadlessContext(width, height));
+  if (!headless->CreateContext() || !headless->CreateFramebuffer())
+  {
+    return HeadlessContextPtr();
+  }
+  return headless;
+}
+
+HeadlessContext::HeadlessContext(int width, int height)
+  : width(width), height(height), framebuffer(0), colour(0), depth(0), display(NULL), surface(NULL), context(NULL)
+{
+}
+
+HeadlessContext::~HeadlessContext()
+{
+#if defined(THEIA_EGL)
+  if (0 != framebuffer)
+  {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colour);
+    glDeleteRenderbuffers(1, &depth);
+  }
+  if (NULL != display)
+  {
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (NULL != context) { eglDestroyContext(display, context); }
+    if (NULL != surface) { eglDestroySurface(display, surface); }
+    eglTerminate(display);
+  }
+#endif
+}
+
+//--------------------------------------------------------------------------------
+
+bool HeadlessContext::CreateContext()
+{
+#if defined(THEIA_EGL)
+  display = GetDisplay();
+  EGLint major, minor;
+  if ((EGL_NO_DISPLAY == display) || !eglInitialize(display, &major, &minor))
+  {
+    LOG("unable to initialise EGL\n");
+    display = NULL;
+    return false;
+  }
+  LOG("EGL v%d.%d (%s)\n", major, minor, eglQueryString(display, EGL_VENDOR));
+
+  if (!eglBindAPI(EGL_OPENGL_API))
+  {
+    LOG("EGL doesn't support desktop GL\n");
+    return false;
+  }
+
+  // Without surfaceless contexts a pbuffer is made to be current with, though it is never
+  // drawn to...
+  const bool surfaceless = HasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+  const EGLint configAttributes[] =
+  {
+    EGL_SURFACE_TYPE,     surfaceless ? 0 : EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE,  EGL_OPENGL_BIT,
+    EGL_NONE
+  };
+  EGLConfig config;
+  EGLint numConfigs = 0;
+  if (!eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) || (numConfigs < 1))
+  {
+    LOG("no EGL config for desktop GL\n");
+    return false;
+  }
+
+  // Ask for what the windowed path gets, falling back to whatever the driver offers...
+  const EGLint contextAttributes[] =
+  {
+    EGL_CONTEXT_MAJOR_VERSION,        4,
+    EGL_CONTEXT_MINOR_VERSION,        3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK,  EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+    EGL_NONE
+  };
+  context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+  if (EGL_NO_CONTEXT == context)
+  {
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+  }
+  if (EGL_NO_CONTEXT == context)
+  {
+    LOG("unable to create an EGL context (0x%x)\n", eglGetError());
+    context = NULL;
+    return false;
+  }
+
+  if (!surfaceless)
+  {
+    const EGLint pbufferAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+    surface = eglCreatePbufferSurface(display, config, pbufferAttributes);
+    if (EGL_NO_SURFACE == surface)
+    {
+      LOG("unable to create an EGL pbuffer (0x%x)\n", eglGetError());
+      surface = NULL;
+      return false;
+    }
+  }
+
+  const EGLSurface current = (NULL != surface) ? (EGLSurface)surface : EGL_NO_SURFACE;
+  if (!eglMakeCurrent(display, current, current, context))
+  {
+    LOG("unable to make the EGL context current (0x%x)\n", eglGetError());
+    return false;
+  }
+
+  if (ogl_LOAD_FAILED == ogl_LoadFunctions())
+  {
+    LOG("unable to load the GL functions\n");
+    return false;
+  }
+  LOG("headless %s context, %s\n", surfaceless ? "surfaceless" : "pbuffer", glGetString(GL_RENDERER));
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool HeadlessContext::CreateFramebuffer()
+{
+  glGenRenderbuffers(1, &colour);
+  glBindRenderbuffer(GL_RENDERBUFFER, colour);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+  glGenRenderbuffers(1, &depth);
+  glBindRenderbuffer(GL_RENDERBUFFER, depth);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colour);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+
+  const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (GL_FRAMEBUFFER_COMPLETE != status)
+  {
+    LOG("headless framebuffer incomplete (0x%x)\n", status);
+    return false;
+  }
+
+  glViewport(0, 0, width, height);
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+void HeadlessContext::Present()
+{
+  // There's no swap to hand the frame to the driver, so flush it explicitly...
+  glFlush();
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void HeadlessContext::ReadPixels(std::vector<uint8_t>& rgba) const
+{
+  const size_t rowBytes = width * 4;
+  std::vector<uint8_t> rows(rowBytes * height);
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &rows[0]);
+
+  // GL's rows start at the bottom...
+  rgba.resize(rows.size());
+  for (int y = 0; y < height; ++y)
+  {
+    memcpy(&rgba[y * rowBytes], &rows[(height - 1 - y) * rowBytes], rowBytes);
+  }
+}
+
+bool HeadlessContext::SaveFrame(const char* path) const
+{
+  std::vector<uint8_t> rgba;
+  ReadPixels(rgba);
+  return PngWriter::Write(path, width, height, rgba);
+}
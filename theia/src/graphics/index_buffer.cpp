@@ -1,4 +1,5 @@
 #include <theia/graphics/index_buffer.h>
+#include <theia/misc/profiler.h>
 
 using namespace theia;
 
@@ -25,6 +26,7 @@ IndexBuffer::~IndexBuffer()
 
 void IndexBuffer::SetData(size_t sizeInBytes, size_t offsetInBytes, const void* const data)
 {
+  PROFILE_SCOPE("IndexBuffer::SetData");
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
   glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offsetInBytes, sizeInBytes, data);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
@@ -0,0 +1,33 @@
+#include <theia/graphics/indirect_buffer.h>
+#include <theia/misc/profiler.h>
+
+using namespace theia;
+
+IndirectBufferPtr IndirectBuffer::Create(size_t sizeInBytes)
+{
+  IndirectBufferPtr ib(new IndirectBuffer());
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, ib->buffer);
+  glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeInBytes, NULL, GL_STREAM_DRAW);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+  return ib;
+}
+
+IndirectBuffer::IndirectBuffer()
+{
+  glGenBuffers(1, &buffer);
+}
+
+IndirectBuffer::~IndirectBuffer()
+{
+  glDeleteBuffers(1, &buffer);
+}
+
+void IndirectBuffer::SetData(size_t sizeInBytes, size_t offsetInBytes, const void* const data)
+{
+  PROFILE_SCOPE("IndirectBuffer::SetData");
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+  glBufferSubData(GL_DRAW_INDIRECT_BUFFER, offsetInBytes, sizeInBytes, data);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
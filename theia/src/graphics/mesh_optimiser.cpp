@@ -0,0 +1,206 @@
+#include <theia/graphics/mesh_optimiser.h>
+
+using namespace theia;
+
+//--------------------------------------------------------------------------------
+
+MeshOptimiser::CacheStats MeshOptimiser::AnalyseCache(const uint32_t* indices, size_t numIndices, size_t numVertices, int cacheSize)
+{
+  CacheStats stats;
+  stats.numTriangles = numIndices / 3;
+  stats.numVertices = 0;
+  stats.transforms = 0;
+
+  // A vertex is still in a FIFO cache if fewer than cacheSize misses have happened since it
+  // went in...
+  const size_t NotCached = (size_t)-1;
+  std::vector<size_t> insertedAt(numVertices, NotCached);
+  std::vector<bool> referenced(numVertices, false);
+
+  for (size_t i = 0; i < numIndices; ++i)
+  {
+    const uint32_t v = indices[i];
+    if (!referenced[v])
+    {
+      referenced[v] = true;
+      ++stats.numVertices;
+    }
+
+    if ((NotCached == insertedAt[v]) || ((stats.transforms - insertedAt[v]) >= (size_t)cacheSize))
+    {
+      insertedAt[v] = stats.transforms;
+      ++stats.transforms;
+    }
+  }
+
+  stats.acmr = (stats.numTriangles > 0) ? (float)stats.transforms / (float)stats.numTriangles : 0.0f;
+  stats.atvr = (stats.numVertices > 0) ? (float)stats.transforms / (float)stats.numVertices : 0.0f;
+  return stats;
+}
+
+//--------------------------------------------------------------------------------
+
+void MeshOptimiser::StripToList(const uint32_t* strip, size_t numIndices, std::vector<uint32_t>& list)
+{
+  list.clear();
+  if (numIndices < 3) { return; }
+  list.reserve((numIndices - 2) * 3);
+
+  for (size_t i = 0; i + 2 < numIndices; ++i)
+  {
+    uint32_t a = strip[i];
+    uint32_t b = strip[i + 1];
+    const uint32_t c = strip[i + 2];
+    if ((a == b) || (b == c) || (a == c)) { continue; }
+
+    // Every other triangle of a strip is wound the opposite way...
+    if (i & 1)
+    {
+      const uint32_t t = a; a = b; b = t;
+    }
+    list.push_back(a);
+    list.push_back(b);
+    list.push_back(c);
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+namespace
+{
+  struct Tipsify
+  {
+    const uint32_t* indices;
+    size_t          numTriangles;
+    size_t          numVertices;
+    int             cacheSize;
+
+    std::vector<uint32_t> adjacencyStart;  // first entry of each vertex's triangles in adjacency
+    std::vector<uint32_t> adjacency;       // triangles using each vertex, grouped by vertex
+    std::vector<int>      liveTriangles;   // triangles not yet emitted, per vertex
+    std::vector<size_t>   cacheTime;       // time stamp each vertex last entered the cache
+    std::vector<bool>     emitted;
+    std::vector<uint32_t> deadEnd;         // recently used vertices, to restart from
+    size_t                time;
+    size_t                cursor;          // next vertex to try when the dead-end stack is empty
+
+    void BuildAdjacency()
+    {
+      liveTriangles.assign(numVertices, 0);
+      for (size_t i = 0; i < numTriangles * 3; ++i)
+      {
+        ++liveTriangles[indices[i]];
+      }
+
+      adjacencyStart.resize(numVertices + 1);
+      adjacencyStart[0] = 0;
+      for (size_t v = 0; v < numVertices; ++v)
+      {
+        adjacencyStart[v + 1] = adjacencyStart[v] + liveTriangles[v];
+      }
+
+      std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+      adjacency.resize(numTriangles * 3);
+      for (size_t t = 0; t < numTriangles; ++t)
+      {
+        for (int k = 0; k < 3; ++k)
+        {
+          adjacency[fill[indices[(t * 3) + k]]++] = (uint32_t)t;
+        }
+      }
+    }
+
+    // Choose the candidate which will still be in the cache after its remaining triangles are
+    // emitted and which went into the cache earliest, else fall back to a dead end...
+    int NextVertex(const std::vector<uint32_t>& candidates)
+    {
+      int best = -1;
+      int bestPriority = -1;
+      for (size_t i = 0; i < candidates.size(); ++i)
+      {
+        const uint32_t v = candidates[i];
+        if (liveTriangles[v] > 0)
+        {
+          int priority = 0;
+          if ((time - cacheTime[v]) + (2 * liveTriangles[v]) <= (size_t)cacheSize)
+          {
+            priority = (int)(time - cacheTime[v]);
+          }
+          if (priority > bestPriority)
+          {
+            bestPriority = priority;
+            best = (int)v;
+          }
+        }
+      }
+
+      return (best >= 0) ? best : SkipDeadEnd();
+    }
+
+    int SkipDeadEnd()
+    {
+      while (!deadEnd.empty())
+      {
+        const uint32_t v = deadEnd.back();
+        deadEnd.pop_back();
+        if (liveTriangles[v] > 0) { return (int)v; }
+      }
+      while (cursor < numVertices)
+      {
+        const size_t v = cursor++;
+        if (liveTriangles[v] > 0) { return (int)v; }
+      }
+      return -1;
+    }
+
+    void Run(uint32_t* output)
+    {
+      BuildAdjacency();
+      cacheTime.assign(numVertices, 0);
+      emitted.assign(numTriangles, false);
+      time = cacheSize + 1;
+      cursor = 0;
+
+      std::vector<uint32_t> candidates;
+      size_t out = 0;
+      int fan = SkipDeadEnd();
+      while (fan >= 0)
+      {
+        // Emit every remaining triangle around the fanning vertex...
+        candidates.clear();
+        for (uint32_t a = adjacencyStart[fan]; a < adjacencyStart[fan + 1]; ++a)
+        {
+          const uint32_t t = adjacency[a];
+          if (emitted[t]) { continue; }
+          emitted[t] = true;
+
+          for (int k = 0; k < 3; ++k)
+          {
+            const uint32_t v = indices[(t * 3) + k];
+            output[out++] = v;
+            deadEnd.push_back(v);
+            candidates.push_back(v);
+            --liveTriangles[v];
+            if ((time - cacheTime[v]) > (size_t)cacheSize)
+            {
+              cacheTime[v] = time;
+              ++time;
+            }
+          }
+        }
+
+        fan = NextVertex(candidates);
+      }
+    }
+  };
+}
+
+void MeshOptimiser::OptimiseTriangleList(const uint32_t* indices, size_t numIndices, size_t numVertices, int cacheSize, uint32_t* output)
+{
+  Tipsify tipsify;
+  tipsify.indices = indices;
+  tipsify.numTriangles = numIndices / 3;
+  tipsify.numVertices = numVertices;
+  tipsify.cacheSize = cacheSize;
+  tipsify.Run(output);
+}
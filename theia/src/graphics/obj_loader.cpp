@@ -0,0 +1,164 @@
+#include <stdlib.h>
+#include <map>
+#include <sstream>
+#include <string>
+#include <theia/misc/debug.h>
+#include <theia/graphics/obj_loader.h>
+
+using namespace theia;
+
+//----------------------------------------------
+
+namespace
+{
+  // Indices of a face corner into the position, texcoord and normal lists (-1 if absent)...
+  struct Corner
+  {
+    int v;
+    int t;
+    int n;
+
+    bool operator<(const Corner& other) const
+    {
+      if (v != other.v) { return v < other.v; }
+      if (t != other.t) { return t < other.t; }
+      return n < other.n;
+    }
+  };
+}
+
+//----------------------------------------------
+
+// Convert a 1-based (or negative, counting back from the end) OBJ index to a 0-based one...
+static int ResolveIndex(int index, size_t count)
+{
+  if (index > 0) { return index - 1; }
+  if (index < 0) { return (int)count + index; }
+  return -1;
+}
+
+//----------------------------------------------
+
+// Read a "v/t/n", "v//n", "v/t" or "v" corner...
+static bool ReadCorner(const std::string& token, Corner& corner)
+{
+  const char* p = token.c_str();
+  char* end;
+
+  corner.v = (int)strtol(p, &end, 10);
+  corner.t = 0;
+  corner.n = 0;
+  if (end == p) { return false; }
+
+  if ('/' == *end)
+  {
+    p = end + 1;
+    if ('/' != *p)
+    {
+      corner.t = (int)strtol(p, &end, 10);
+    }
+    else
+    {
+      end = (char*)p;
+    }
+    if ('/' == *end)
+    {
+      p = end + 1;
+      corner.n = (int)strtol(p, &end, 10);
+    }
+  }
+
+  return true;
+}
+
+//----------------------------------------------
+
+bool theia::ReadOBJ(const char* text, ObjMesh& mesh)
+{
+  std::vector<glm::vec3> positionList;
+  std::vector<glm::vec2> texcoordList;
+  std::vector<glm::vec3> normalList;
+  std::map<Corner, uint32_t> vertexMap;
+
+  mesh.positions.clear();
+  mesh.normals.clear();
+  mesh.texcoords.clear();
+  mesh.indices.clear();
+
+  std::istringstream stream(text);
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(stream, line))
+  {
+    ++lineNumber;
+    std::istringstream s(line);
+    std::string keyword;
+    if (!(s >> keyword)) { continue; }
+
+    if ("v" == keyword)
+    {
+      glm::vec3 v(0);
+      s >> v.x >> v.y >> v.z;
+      positionList.push_back(v);
+    }
+    else if ("vt" == keyword)
+    {
+      glm::vec2 t(0);
+      s >> t.x >> t.y;
+      texcoordList.push_back(t);
+    }
+    else if ("vn" == keyword)
+    {
+      glm::vec3 n(0);
+      s >> n.x >> n.y >> n.z;
+      normalList.push_back(glm::normalize(n));
+    }
+    else if ("f" == keyword)
+    {
+      std::vector<uint32_t> polygon;
+      std::string token;
+      while (s >> token)
+      {
+        Corner corner;
+        if (!ReadCorner(token, corner))
+        {
+          LOG("OBJ line %d: bad face corner '%s'\n", lineNumber, token.c_str());
+          return false;
+        }
+        corner.v = ResolveIndex(corner.v, positionList.size());
+        corner.t = ResolveIndex(corner.t, texcoordList.size());
+        corner.n = ResolveIndex(corner.n, normalList.size());
+        if ((corner.v < 0) || (corner.v >= (int)positionList.size()) ||
+            (corner.t >= (int)texcoordList.size()) ||
+            (corner.n >= (int)normalList.size()))
+        {
+          LOG("OBJ line %d: face refers to a missing element\n", lineNumber);
+          return false;
+        }
+
+        std::map<Corner, uint32_t>::const_iterator it = vertexMap.find(corner);
+        if (vertexMap.end() == it)
+        {
+          const uint32_t index = (uint32_t)mesh.positions.size();
+          mesh.positions.push_back(positionList[corner.v]);
+          mesh.texcoords.push_back((corner.t >= 0) ? texcoordList[corner.t] : glm::vec2(0));
+          mesh.normals.push_back((corner.n >= 0) ? normalList[corner.n] : glm::vec3(0));
+          it = vertexMap.insert(std::make_pair(corner, index)).first;
+        }
+        polygon.push_back(it->second);
+      }
+
+      for (size_t i = 2; i < polygon.size(); ++i)
+      {
+        mesh.indices.push_back(polygon[0]);
+        mesh.indices.push_back(polygon[i - 1]);
+        mesh.indices.push_back(polygon[i]);
+      }
+    }
+  }
+
+  if (texcoordList.empty()) { mesh.texcoords.clear(); }
+  if (normalList.empty()) { mesh.normals.clear(); }
+
+  return true;
+}
@@ -0,0 +1,251 @@
+#include <string.h>
+#include <theia/misc/debug.h>
+#include <theia/misc/profiler.h>
+#include <theia/graphics/draw_batch.h>
+#include <theia/graphics/material.h>
+#include <theia/graphics/render_queue.h>
+
+using namespace theia;
+
+//--------------------------------------------------------------------------------
+
+uint64_t SortKey::Make(uint32_t layer, uint32_t program, uint32_t material, uint32_t vao, float depth)
+{
+  const uint32_t maxDepth = (1u << DepthBits) - 1;
+  const float clamped = (depth < 0.0f) ? 0.0f : ((depth > 1.0f) ? 1.0f : depth);
+
+  uint64_t key = layer & ((1u << LayerBits) - 1);
+  key = (key << ProgramBits) | (program & ((1u << ProgramBits) - 1));
+  key = (key << MaterialBits) | (material & ((1u << MaterialBits) - 1));
+  key = (key << VaoBits) | (vao & ((1u << VaoBits) - 1));
+  key = (key << DepthBits) | (uint32_t)(clamped * (float)maxDepth);
+  return key;
+}
+
+//--------------------------------------------------------------------------------
+
+RenderQueuePtr RenderQueue::Create()
+{
+  return RenderQueuePtr(new RenderQueue());
+}
+
+RenderQueue::RenderQueue()
+{
+}
+
+DrawPacket& RenderQueue::Add(uint64_t key, Shader* program, GLuint vao, GLenum mode, GLenum indexType, GLuint first, GLsizei count)
+{
+  packets.resize(packets.size() + 1);
+  DrawPacket& packet = packets.back();
+  memset(&packet, 0, sizeof(packet));
+  packet.key = key;
+  packet.program = program;
+  packet.vao = vao;
+  packet.mode = mode;
+  packet.indexType = indexType;
+  packet.first = first;
+  packet.count = count;
+  packet.instanceCount = 1;
+  packet.firstConstant = (uint32_t)constants.size();
+  return packet;
+}
+
+void RenderQueue::AddConstant(Shader::Parameter* const param, const void* const data, size_t sizeInBytes)
+{
+  ASSERT(!packets.empty());
+  if (NULL == param)
+  {
+    return;
+  }
+
+  // Keep every value 8-byte aligned so that doubles and matrices can be read in place...
+  const size_t offset = (constantData.size() + 7) & ~(size_t)7;
+  constantData.resize(offset + sizeInBytes);
+  memcpy(&constantData[offset], data, sizeInBytes);
+
+  Constant constant;
+  constant.param = param;
+  constant.offset = (uint32_t)offset;
+  constant.size = (uint32_t)sizeInBytes;
+  constants.push_back(constant);
+  ++packets.back().numConstants;
+}
+
+//--------------------------------------------------------------------------------
+
+void RenderQueue::Sort()
+{
+  PROFILE_SCOPE("RenderQueue::Sort");
+  const size_t count = packets.size();
+  order.resize(count);
+  scratch.resize(count);
+  if (0 == count)
+  {
+    return;
+  }
+  for (size_t i = 0; i < count; ++i)
+  {
+    order[i].key = packets[i].key;
+    order[i].index = (uint32_t)i;
+  }
+
+  // Least significant digit first radix sort, a byte at a time. Bytes which are the same in
+  // every key (typically the layer and often the program) are skipped...
+  for (int shift = 0; shift < 64; shift += 8)
+  {
+    size_t histogram[256] = { 0 };
+    for (size_t i = 0; i < count; ++i)
+    {
+      ++histogram[(order[i].key >> shift) & 0xff];
+    }
+    if (histogram[(order[0].key >> shift) & 0xff] == count)
+    {
+      continue;
+    }
+
+    size_t total = 0;
+    for (int digit = 0; digit < 256; ++digit)
+    {
+      const size_t n = histogram[digit];
+      histogram[digit] = total;
+      total += n;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+      scratch[histogram[(order[i].key >> shift) & 0xff]++] = order[i];
+    }
+    order.swap(scratch);
+  }
+}
+
+void RenderQueue::Submit()
+{
+  PROFILE_SCOPE("RenderQueue::Submit");
+  stats = RenderQueueStats();
+  if (packets.empty())
+  {
+    return;
+  }
+
+  Sort();
+
+  // Nothing is known about the GL state on entry, so the first draw sets everything...
+  Shader* program = NULL;
+  const MaterialState* material = NULL;
+  GLuint vao = (GLuint)-1;
+  GLuint textures[MaxDrawTextures];
+  for (int unit = 0; unit < MaxDrawTextures; ++unit) { textures[unit] = (GLuint)-1; }
+  GLint patchVertices = -1;
+
+  for (size_t i = 0; i < order.size(); ++i)
+  {
+    Replay(packets[order[i].index], program, material, vao, textures, patchVertices);
+  }
+
+  Clear();
+}
+
+void RenderQueue::Clear()
+{
+  packets.clear();
+  constants.clear();
+  constantData.clear();
+}
+
+void RenderQueue::Merge(RenderQueue& other)
+{
+  if (other.packets.empty())
+  {
+    return;
+  }
+
+  // The other queue's constants go after ours, keeping their 8-byte alignment...
+  const uint32_t firstConstant = (uint32_t)constants.size();
+  const size_t dataOffset = (constantData.size() + 7) & ~(size_t)7;
+
+  const size_t firstPacket = packets.size();
+  packets.insert(packets.end(), other.packets.begin(), other.packets.end());
+  for (size_t i = firstPacket; i < packets.size(); ++i)
+  {
+    packets[i].firstConstant += firstConstant;
+  }
+
+  constants.insert(constants.end(), other.constants.begin(), other.constants.end());
+  for (size_t i = firstConstant; i < constants.size(); ++i)
+  {
+    constants[i].offset += (uint32_t)dataOffset;
+  }
+
+  constantData.resize(dataOffset);
+  constantData.insert(constantData.end(), other.constantData.begin(), other.constantData.end());
+
+  other.Clear();
+}
+
+//--------------------------------------------------------------------------------
+
+void RenderQueue::Replay(const DrawPacket& packet, Shader*& program, const MaterialState*& material, GLuint& vao, GLuint textures[MaxDrawTextures], GLint& patchVertices)
+{
+  if (packet.program != program)
+  {
+    glUseProgram(packet.program->program);
+    program = packet.program;
+    material = NULL;
+    ++stats.programChanges;
+  }
+
+  if ((NULL != packet.material) && (packet.material != material))
+  {
+    Material::Apply(*packet.material);
+    material = packet.material;
+    ++stats.materialChanges;
+  }
+
+  for (uint32_t c = packet.firstConstant; c < (packet.firstConstant + packet.numConstants); ++c)
+  {
+    const Constant& constant = constants[c];
+    program->SetParameter(constant.param, &constantData[constant.offset], constant.size);
+  }
+  program->Flush();
+
+  if (packet.vao != vao)
+  {
+    glBindVertexArray(packet.vao);
+    vao = packet.vao;
+    ++stats.vaoChanges;
+  }
+
+  for (int unit = 0; unit < MaxDrawTextures; ++unit)
+  {
+    if ((0 != packet.textureTargets[unit]) && (packet.textures[unit] != textures[unit]))
+    {
+      glActiveTexture(GL_TEXTURE0 + unit);
+      glBindTexture(packet.textureTargets[unit], packet.textures[unit]);
+      textures[unit] = packet.textures[unit];
+      ++stats.textureChanges;
+    }
+  }
+
+  if ((GL_PATCHES == packet.mode) && (packet.patchVertices != patchVertices))
+  {
+    glPatchParameteri(GL_PATCH_VERTICES, packet.patchVertices);
+    patchVertices = packet.patchVertices;
+    ++stats.patchVerticesChanges;
+  }
+
+  if (NULL != packet.batch)
+  {
+    packet.batch->Submit(packet.mode, packet.indexType);
+  }
+  else if (0 == packet.indexType)
+  {
+    glDrawArraysInstanced(packet.mode, packet.first, packet.count, packet.instanceCount);
+  }
+  else
+  {
+    const size_t indexSize = (GL_UNSIGNED_INT == packet.indexType) ? sizeof(GLuint) : sizeof(GLushort);
+    glDrawElementsInstancedBaseVertex(packet.mode, packet.count, packet.indexType, (const void*)(packet.first * indexSize),
+      packet.instanceCount, packet.baseVertex);
+  }
+  ++stats.draws;
+}
@@ -1,17 +1,21 @@
 
+#include <string.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <string>
 #include <theia/graphics/gl/gl_loader.h>
 #include <theia/graphics/shader.h>
 #include <theia/misc/debug.h>
+#include <theia/misc/profiler.h>
 #include <theia/resource_loader.h>
 
 using namespace theia;
 
 //--------------------------------------------------------------------------------
 
+static bool LoadSource(uint32_t resource, std::string& src);
 static GLuint CompileShader(GLenum type, const char* commonSrc, const char* const src);
 static bool LinkShader(GLuint shader, GLuint parts[], size_t numParts);
+static bool BuildProgram(GLuint program, GLuint parts[], size_t numParts, std::vector<Shader::Parameter>& params);
 static void EnumerateUniforms(GLuint program, std::vector<Shader::Parameter>& params);
 
 //--------------------------------------------------------------------------------
@@ -28,63 +32,91 @@ Shader::~Shader()
 
 bool Shader::Compile(const char* commonSrc, const char* vertexSrc, const char* fragmentSrc)
 {
-  bool compiled = false;
-
+  PROFILE_SCOPE("Shader::Compile");
   GLuint parts[2] =
   {
     CompileShader(GL_VERTEX_SHADER, commonSrc, vertexSrc),
     CompileShader(GL_FRAGMENT_SHADER, commonSrc, fragmentSrc)
   };
 
-  if (LinkShader(program, parts, 2))
+  return BuildProgram(program, parts, 2, params);
+}
+
+bool Shader::Compile(const char* commonSrc, const char* vertexSrc, const char* controlSrc, const char* evaluationSrc, const char* fragmentSrc)
+{
+  PROFILE_SCOPE("Shader::Compile");
+  GLuint parts[4] =
   {
-    compiled = true;
-    GLint numParams;
-    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &numParams);
-    if (numParams > 0)
-    {
-      params.resize(numParams);
-      EnumerateUniforms(program, params);
-    }
-  }
+    CompileShader(GL_VERTEX_SHADER, commonSrc, vertexSrc),
+    CompileShader(GL_TESS_CONTROL_SHADER, commonSrc, controlSrc),
+    CompileShader(GL_TESS_EVALUATION_SHADER, commonSrc, evaluationSrc),
+    CompileShader(GL_FRAGMENT_SHADER, commonSrc, fragmentSrc)
+  };
 
-  // Don't need the temporary shader parts...
-  glDeleteShader(parts[0]);
-  glDeleteShader(parts[1]);
+  return BuildProgram(program, parts, 4, params);
+}
 
-  return compiled;
+bool Shader::CompileCompute(const char* commonSrc, const char* computeSrc)
+{
+  PROFILE_SCOPE("Shader::Compile");
+  GLuint part = CompileShader(GL_COMPUTE_SHADER, commonSrc, computeSrc);
+
+  return BuildProgram(program, &part, 1, params);
 }
 
 bool Shader::Compile(uint32_t commonResource, uint32_t vertexShaderResource, uint32_t fragmentShaderResource)
 {
-  Resource shaderCommon;
-  Resource vertexShader;
-  Resource fragmentShader;
-  ResourceLoader::Load(commonResource, 256, shaderCommon);
-  ResourceLoader::Load(vertexShaderResource, 256, vertexShader);
-  ResourceLoader::Load(fragmentShaderResource, 256, fragmentShader);
+  std::string common, vs, fs;
+  if (LoadSource(commonResource, common) && LoadSource(vertexShaderResource, vs) && LoadSource(fragmentShaderResource, fs))
+  {
+    return Compile(common.c_str(), vs.c_str(), fs.c_str());
+  }
+  return false;
+}
 
-  if (shaderCommon.data && vertexShader.data && fragmentShader.data)
+bool Shader::Compile(uint32_t commonResource, uint32_t vertexShaderResource, uint32_t controlShaderResource,
+                     uint32_t evaluationShaderResource, uint32_t fragmentShaderResource)
+{
+  std::string common, vs, tcs, tes, fs;
+  if (   LoadSource(commonResource, common) && LoadSource(vertexShaderResource, vs) && LoadSource(controlShaderResource, tcs)
+      && LoadSource(evaluationShaderResource, tes) && LoadSource(fragmentShaderResource, fs))
   {
-    std::string common((char*)shaderCommon.data, (char*)shaderCommon.data + shaderCommon.sizeInBytes);
-    std::string vs((char*)vertexShader.data, (char*)vertexShader.data + vertexShader.sizeInBytes);
-    std::string fs((char*)fragmentShader.data, (char*)fragmentShader.data + fragmentShader.sizeInBytes);
+    return Compile(common.c_str(), vs.c_str(), tcs.c_str(), tes.c_str(), fs.c_str());
+  }
+  return false;
+}
 
-    return Compile(common.c_str(), vs.c_str(), fs.c_str());
+bool Shader::CompileCompute(uint32_t commonResource, uint32_t computeShaderResource)
+{
+  std::string common, cs;
+  if (LoadSource(commonResource, common) && LoadSource(computeShaderResource, cs))
+  {
+    return CompileCompute(common.c_str(), cs.c_str());
   }
   return false;
 }
 
 void Shader::Activate()
 {
+  PROFILE_SCOPE("Shader::Activate");
   glUseProgram(program);
+  Flush();
+}
 
+void Shader::Flush()
+{
+  PROFILE_SCOPE("Shader::Flush");
   for (size_t i = 0; i < params.size(); ++i)
   {
     if (params[i].dirty)
     {
       switch (params[i].type)
       {
+      case GL_INT:
+      case GL_SAMPLER_2D:
+      case GL_SAMPLER_2D_ARRAY:
+      case GL_SAMPLER_BUFFER:
+                          glUniform1iv(params[i].location, 1, (GLint*)params[i].data); break;
       case GL_FLOAT:      glUniform1fv(params[i].location, 1, (float*)params[i].data); break;
       case GL_FLOAT_VEC2: glUniform2fv(params[i].location, 1, (float*)params[i].data); break;
       case GL_FLOAT_VEC3: glUniform3fv(params[i].location, 1, (float*)params[i].data); break;
@@ -121,6 +153,8 @@ Shader::Parameter* const Shader::GetParameter(const char* const name)
 
 //--------------------------------------------------------------------------------
 
+// Called for every value of every draw, so left unprofiled: a scope would cost as much as
+// the copy. The uploads are timed by Flush...
 static void CacheParameter(Shader::Parameter* const param, const void* const value, size_t size)
 {
   if (param && (0 != memcmp(param->data, value, size)))
@@ -132,6 +166,15 @@ static void CacheParameter(Shader::Parameter* const param, const void* const val
 
 //--------------------------------------------------------------------------------
 
+void Shader::SetParameter(Parameter* const param, const void* const data, size_t sizeInBytes)
+{
+  ASSERT(sizeInBytes <= sizeof(param->data));
+  CacheParameter(param, data, sizeInBytes);
+}
+void Shader::SetParameter(Parameter* const param, int value)
+{
+  CacheParameter(param, &value, sizeof(value));
+}
 void Shader::SetParameter(Parameter* const param, float value)
 {
   CacheParameter(param, &value, sizeof(value));
@@ -199,16 +242,68 @@ void Shader::SetParameter(Parameter* const param, const glm::dmat4& value)
 
 //--------------------------------------------------------------------------------
 
-static GLuint CompileShader(GLenum type, const char* common, const char* const src)
+static bool LoadSource(uint32_t resource, std::string& src)
+{
+  Resource text;
+  ResourceLoader::Load(resource, 256, text);
+  if (NULL == text.data)
+  {
+    return false;
+  }
+  src.assign((char*)text.data, (char*)text.data + text.sizeInBytes);
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+// Find a preprocessor directive, e.g. "#version", which begins a line (after any spaces or
+// tabs), so that the same word in a comment or string is skipped...
+static size_t FindDirective(const std::string& text, const char* directive)
 {
-  const char* compilationUnits[2];
-  compilationUnits[0] = common;
+  size_t found = text.find(directive);
+  while (std::string::npos != found)
+  {
+    size_t lineStart = found;
+    while ((lineStart > 0) && ((' ' == text[lineStart - 1]) || ('\t' == text[lineStart - 1]))) { --lineStart; }
+    if ((0 == lineStart) || ('\n' == text[lineStart - 1]))
+    {
+      return found;
+    }
+    found = text.find(directive, found + 1);
+  }
+  return std::string::npos;
+}
 
-  // They didn't provide a #version line - just suck in the whole text...
-  compilationUnits[1] = src;
+static GLuint CompileShader(GLenum type, const char* common, const char* const src)
+{
+  const char* compilationUnits[3];
+  GLsizei numUnits = 0;
+
+  // A #version line at the very start of the stage overrides the common one, which is
+  // commented out so that it doesn't follow the first...
+  std::string version;
+  std::string overridden;
+  if (0 == strncmp(src, "#version", 8))
+  {
+    const char* endOfLine = strchr(src, '\n');
+    version.assign(src, (NULL != endOfLine) ? endOfLine + 1 : src + strlen(src));
+    overridden = common;
+    const size_t commonVersion = FindDirective(overridden, "#version");
+    if (std::string::npos != commonVersion) { overridden.replace(commonVersion, 1, "//"); }
+
+    compilationUnits[numUnits++] = version.c_str();
+    compilationUnits[numUnits++] = overridden.c_str();
+    compilationUnits[numUnits++] = src + version.size();
+  }
+  else
+  {
+    // They didn't provide a #version line - just suck in the whole text...
+    compilationUnits[numUnits++] = common;
+    compilationUnits[numUnits++] = src;
+  }
 
   GLuint shader = glCreateShader(type);
-  glShaderSource(shader, 2, compilationUnits, NULL);
+  glShaderSource(shader, numUnits, compilationUnits, NULL);
   glCompileShader(shader);
   GLint didCompile;
   glGetShaderiv(shader, GL_COMPILE_STATUS, &didCompile);
@@ -224,6 +319,9 @@ static GLuint CompileShader(GLenum type, const char* common, const char* const s
       case GL_VERTEX_SHADER: typeName = "vertex"; break;
       case GL_FRAGMENT_SHADER: typeName = "fragment"; break;
       case GL_GEOMETRY_SHADER: typeName = "geometry"; break;
+      case GL_TESS_CONTROL_SHADER: typeName = "tessellation control"; break;
+      case GL_TESS_EVALUATION_SHADER: typeName = "tessellation evaluation"; break;
+      case GL_COMPUTE_SHADER: typeName = "compute"; break;
     }
     LOG("%s\n", log.data());
     exit(EXIT_FAILURE);
@@ -258,6 +356,31 @@ static bool LinkShader(GLuint shader, GLuint parts[], size_t numParts)
 
 //--------------------------------------------------------------------------------
 
+// Link the compiled stages into the program and find its parameters...
+static bool BuildProgram(GLuint program, GLuint parts[], size_t numParts, std::vector<Shader::Parameter>& params)
+{
+  bool compiled = false;
+
+  if (LinkShader(program, parts, numParts))
+  {
+    compiled = true;
+    GLint numParams;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &numParams);
+    if (numParams > 0)
+    {
+      params.resize(numParams);
+      EnumerateUniforms(program, params);
+    }
+  }
+
+  // Don't need the temporary shader parts...
+  for (size_t i = 0; i < numParts; ++i) { glDeleteShader(parts[i]); }
+
+  return compiled;
+}
+
+//--------------------------------------------------------------------------------
+
 static void EnumerateUniforms(GLuint program, std::vector<Shader::Parameter>& params)
 {
   const size_t numParams = params.capacity();
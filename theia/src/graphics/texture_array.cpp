@@ -0,0 +1,48 @@
+#include <theia/graphics/texture_array.h>
+#include <theia/misc/profiler.h>
+
+using namespace theia;
+
+TextureArrayPtr TextureArray::Create(GLsizei width, GLsizei height, GLsizei layers, GLenum internalFormat)
+{
+  TextureArrayPtr ta(new TextureArray());
+  ta->width = width;
+  ta->height = height;
+  ta->layers = layers;
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, ta->texture);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalFormat, width, height, layers, 0, GL_RED, GL_FLOAT, NULL);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  return ta;
+}
+
+TextureArray::TextureArray()
+  : width(0), height(0), layers(0)
+{
+  glGenTextures(1, &texture);
+}
+
+TextureArray::~TextureArray()
+{
+  glDeleteTextures(1, &texture);
+}
+
+void TextureArray::SetLayer(GLint layer, GLenum format, GLenum type, const void* const data)
+{
+  PROFILE_SCOPE("TextureArray::SetLayer");
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+  glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, format, type, data);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArray::Bind(GLuint unit) const
+{
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+}
@@ -0,0 +1,47 @@
+#include <theia/graphics/texture_buffer.h>
+#include <theia/misc/profiler.h>
+
+using namespace theia;
+
+TextureBufferPtr TextureBuffer::Create(size_t sizeInBytes, GLenum internalFormat)
+{
+  TextureBufferPtr tb(new TextureBuffer());
+  tb->sizeInBytes = sizeInBytes;
+
+  glBindBuffer(GL_TEXTURE_BUFFER, tb->buffer);
+  glBufferData(GL_TEXTURE_BUFFER, sizeInBytes, NULL, GL_STREAM_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+  glBindTexture(GL_TEXTURE_BUFFER, tb->texture);
+  glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, tb->buffer);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+  return tb;
+}
+
+TextureBuffer::TextureBuffer()
+  : sizeInBytes(0)
+{
+  glGenBuffers(1, &buffer);
+  glGenTextures(1, &texture);
+}
+
+TextureBuffer::~TextureBuffer()
+{
+  glDeleteTextures(1, &texture);
+  glDeleteBuffers(1, &buffer);
+}
+
+void TextureBuffer::SetData(size_t sizeInBytes, size_t offsetInBytes, const void* const data)
+{
+  PROFILE_SCOPE("TextureBuffer::SetData");
+  glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+  glBufferSubData(GL_TEXTURE_BUFFER, offsetInBytes, sizeInBytes, data);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void TextureBuffer::Bind(GLuint unit) const
+{
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_BUFFER, texture);
+}
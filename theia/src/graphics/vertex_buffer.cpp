@@ -1,4 +1,5 @@
 #include <theia/graphics/vertex_buffer.h>
+#include <theia/misc/profiler.h>
 
 using namespace theia;
 
@@ -25,7 +26,29 @@ VertexBuffer::~VertexBuffer()
 
 void VertexBuffer::SetData(size_t sizeInBytes, size_t offsetInBytes, const void* const data)
 {
+  PROFILE_SCOPE("VertexBuffer::SetData");
   glBindBuffer(GL_ARRAY_BUFFER, buffer);
   glBufferSubData(GL_ARRAY_BUFFER, offsetInBytes, sizeInBytes, data);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
+
+void* VertexBuffer::Map(size_t sizeInBytes, size_t offsetInBytes)
+{
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  void* data = glMapBufferRange(GL_ARRAY_BUFFER, offsetInBytes, sizeInBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  return data;
+}
+
+bool VertexBuffer::Unmap()
+{
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  const GLboolean ok = glUnmapBuffer(GL_ARRAY_BUFFER);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  return GL_TRUE == ok;
+}
+
+void VertexBuffer::BindStorage(GLuint binding)
+{
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+}
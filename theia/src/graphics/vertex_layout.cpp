@@ -0,0 +1,326 @@
+#include <math.h>
+#include <string.h>
+#include <theia/misc/debug.h>
+#include <theia/graphics/obj_loader.h>
+#include <theia/graphics/vertex_layout.h>
+
+using namespace theia;
+using namespace theia::VertexEncoding;
+
+//--------------------------------------------------------------------------------
+
+namespace
+{
+  // How each format is handed to glVertexAttrib(I)Pointer...
+  struct FormatInfo
+  {
+    GLint     components;
+    GLenum    type;
+    GLboolean normalized;
+    bool      integer;
+    GLsizei   size;
+  };
+
+  const FormatInfo Formats[VertexFormat::NumFormats] =
+  {
+    { 1, GL_FLOAT,          GL_FALSE, false, 4  },  // Float1
+    { 2, GL_FLOAT,          GL_FALSE, false, 8  },  // Float2
+    { 3, GL_FLOAT,          GL_FALSE, false, 12 },  // Float3
+    { 4, GL_FLOAT,          GL_FALSE, false, 16 },  // Float4
+    { 2, GL_HALF_FLOAT,     GL_FALSE, false, 4  },  // Half2
+    { 4, GL_HALF_FLOAT,     GL_FALSE, false, 8  },  // Half4
+    { 2, GL_UNSIGNED_SHORT, GL_TRUE,  false, 4  },  // UNorm16x2
+    { 4, GL_UNSIGNED_SHORT, GL_TRUE,  false, 8  },  // UNorm16x4
+    { 2, GL_SHORT,          GL_TRUE,  false, 4  },  // SNorm16x2
+    { 2, GL_BYTE,           GL_TRUE,  false, 2  },  // SNorm8x2
+    { 4, GL_UNSIGNED_BYTE,  GL_TRUE,  false, 4  },  // UNorm8x4
+    { 1, GL_UNSIGNED_BYTE,  GL_FALSE, true,  1  },  // UInt8
+  };
+}
+
+GLsizei VertexFormat::Size(Enum format)
+{
+  return Formats[format].size;
+}
+
+//--------------------------------------------------------------------------------
+
+VertexLayout::VertexLayout(GLsizei stride)
+  : stride(stride)
+{
+}
+
+VertexLayout& VertexLayout::Add(GLuint location, VertexFormat::Enum format, GLsizei offset)
+{
+  VertexElement element;
+  element.location = location;
+  element.format = format;
+  element.offset = offset;
+  elements.push_back(element);
+  return *this;
+}
+
+GLsizei VertexLayout::Stride() const
+{
+  if (stride > 0)
+  {
+    return stride;
+  }
+
+  GLsizei end = 0;
+  for (size_t i = 0; i < elements.size(); ++i)
+  {
+    const GLsizei elementEnd = elements[i].offset + VertexFormat::Size(elements[i].format);
+    if (elementEnd > end) { end = elementEnd; }
+  }
+  return end;
+}
+
+void VertexLayout::Configure(GLuint divisor) const
+{
+  const GLsizei vertexStride = Stride();
+  for (size_t i = 0; i < elements.size(); ++i)
+  {
+    const VertexElement& element = elements[i];
+    const FormatInfo& info = Formats[element.format];
+
+    glEnableVertexAttribArray(element.location);
+    if (info.integer)
+    {
+      glVertexAttribIPointer(element.location, info.components, info.type, vertexStride, (const void*)(size_t)element.offset);
+    }
+    else
+    {
+      glVertexAttribPointer(element.location, info.components, info.type, info.normalized, vertexStride, (const void*)(size_t)element.offset);
+    }
+    if (divisor > 0)
+    {
+      glVertexAttribDivisor(element.location, divisor);
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+uint16_t VertexEncoding::FloatToHalf(float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  const uint32_t sign = (bits >> 16) & 0x8000;
+  const uint32_t exponent = (bits >> 23) & 0xff;
+  uint32_t mantissa = bits & 0x7fffff;
+
+  // NaN stays a (quiet) NaN, infinity stays infinity...
+  if (0xff == exponent)
+  {
+    return (uint16_t)(sign | 0x7c00 | ((0 != mantissa) ? 0x200 : 0));
+  }
+
+  const int halfExponent = (int)exponent - 127 + 15;
+  if (halfExponent >= 0x1f)
+  {
+    return (uint16_t)(sign | 0x7c00);
+  }
+
+  if (halfExponent <= 0)
+  {
+    // Too small for a normal half: shift the mantissa (with its implicit 1) down into a
+    // denormal, or flush to zero if nothing would be left...
+    if (halfExponent < -10)
+    {
+      return (uint16_t)sign;
+    }
+    mantissa |= 0x800000;
+    const int shift = 14 - halfExponent;
+    uint32_t half = mantissa >> shift;
+    const uint32_t remainder = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway = 1u << (shift - 1);
+    if ((remainder > halfway) || ((remainder == halfway) && (half & 1))) { ++half; }
+    return (uint16_t)(sign | half);
+  }
+
+  // Round the 23 bit mantissa to 10 bits, to nearest even. A carry out of the mantissa
+  // correctly bumps the exponent, up to infinity...
+  uint32_t half = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+  const uint32_t remainder = mantissa & 0x1fff;
+  if ((remainder > 0x1000) || ((remainder == 0x1000) && (half & 1))) { ++half; }
+  return (uint16_t)(sign | half);
+}
+
+float VertexEncoding::HalfToFloat(uint16_t value)
+{
+  const uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+  const uint32_t exponent = (value >> 10) & 0x1f;
+  const uint32_t mantissa = value & 0x3ff;
+
+  uint32_t bits;
+  if (0 == exponent)
+  {
+    // Zero or a denormal, which is a normal float...
+    const float magnitude = ldexpf((float)mantissa, -24);
+    return (0 != sign) ? -magnitude : magnitude;
+  }
+  else if (0x1f == exponent)
+  {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  }
+  else
+  {
+    bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+  }
+
+  float result;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+//--------------------------------------------------------------------------------
+
+static float SignNotZero(float x)
+{
+  return (x >= 0.0f) ? 1.0f : -1.0f;
+}
+
+glm::vec2 VertexEncoding::OctahedralEncode(const glm::vec3& n)
+{
+  // Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the upper...
+  const float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+  glm::vec2 e(n.x / l1, n.y / l1);
+  if (n.z < 0.0f)
+  {
+    e = glm::vec2((1.0f - fabsf(e.y)) * SignNotZero(e.x), (1.0f - fabsf(e.x)) * SignNotZero(e.y));
+  }
+  return e;
+}
+
+glm::vec3 VertexEncoding::OctahedralDecode(const glm::vec2& e)
+{
+  glm::vec3 n(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
+  if (n.z < 0.0f)
+  {
+    const float x = n.x;
+    n.x = (1.0f - fabsf(n.y)) * SignNotZero(x);
+    n.y = (1.0f - fabsf(x)) * SignNotZero(n.y);
+  }
+  return glm::normalize(n);
+}
+
+// Round a value in [-1,1] to a signed normalized integer of the given maximum...
+static int SNorm(float x, int maximum)
+{
+  const float clamped = (x < -1.0f) ? -1.0f : ((x > 1.0f) ? 1.0f : x);
+  return (int)floorf((clamped * (float)maximum) + 0.5f);
+}
+
+void VertexEncoding::EncodeNormal(const glm::vec3& n, int16_t out[2])
+{
+  const glm::vec2 e(OctahedralEncode(n));
+  out[0] = (int16_t)SNorm(e.x, 32767);
+  out[1] = (int16_t)SNorm(e.y, 32767);
+}
+
+void VertexEncoding::EncodeNormal(const glm::vec3& n, int8_t out[2])
+{
+  const glm::vec2 e(OctahedralEncode(n));
+  out[0] = (int8_t)SNorm(e.x, 127);
+  out[1] = (int8_t)SNorm(e.y, 127);
+}
+
+glm::vec3 VertexEncoding::DecodeNormal(const int16_t in[2])
+{
+  // As GL normalizes signed values: -32768 and -32767 both become -1...
+  const glm::vec2 e(glm::max((float)in[0] / 32767.0f, -1.0f), glm::max((float)in[1] / 32767.0f, -1.0f));
+  return OctahedralDecode(e);
+}
+
+uint32_t VertexEncoding::EncodeColour(const glm::vec4& colour)
+{
+  uint32_t packed = 0;
+  for (int i = 0; i < 4; ++i)
+  {
+    const float c = (colour[i] < 0.0f) ? 0.0f : ((colour[i] > 1.0f) ? 1.0f : colour[i]);
+    packed |= (uint32_t)floorf((c * 255.0f) + 0.5f) << (i * 8);
+  }
+  return packed;
+}
+
+//--------------------------------------------------------------------------------
+
+PositionQuantiser::PositionQuantiser()
+  : origin(0), extent(1)
+{
+}
+
+PositionQuantiser::PositionQuantiser(const glm::vec3& origin, const glm::vec3& extent)
+  : origin(origin), extent(extent)
+{
+}
+
+PositionQuantiser PositionQuantiser::FromBounds(const glm::vec3* positions, size_t count)
+{
+  if (0 == count)
+  {
+    return PositionQuantiser();
+  }
+
+  glm::vec3 lower(positions[0]);
+  glm::vec3 upper(positions[0]);
+  for (size_t i = 1; i < count; ++i)
+  {
+    lower = glm::min(lower, positions[i]);
+    upper = glm::max(upper, positions[i]);
+  }
+
+  // A flat box would divide by zero...
+  return PositionQuantiser(lower, glm::max(upper - lower, glm::vec3(1.0e-6f)));
+}
+
+void PositionQuantiser::Encode(const glm::vec3& position, uint16_t out[3]) const
+{
+  const glm::vec3 t((position - origin) / extent);
+  for (int i = 0; i < 3; ++i)
+  {
+    const float c = (t[i] < 0.0f) ? 0.0f : ((t[i] > 1.0f) ? 1.0f : t[i]);
+    out[i] = (uint16_t)floorf((c * 65535.0f) + 0.5f);
+  }
+}
+
+glm::vec3 PositionQuantiser::Decode(const uint16_t in[3]) const
+{
+  return origin + (glm::vec3((float)in[0], (float)in[1], (float)in[2]) * (extent / 65535.0f));
+}
+
+//--------------------------------------------------------------------------------
+
+VertexLayout CompactVertex::Layout()
+{
+  VertexLayout layout(sizeof(CompactVertex));
+  layout.Add(0, VertexFormat::UNorm16x4, offsetof(CompactVertex, position))
+        .Add(1, VertexFormat::SNorm16x2, offsetof(CompactVertex, normal))
+        .Add(2, VertexFormat::Half2, offsetof(CompactVertex, texcoord));
+  return layout;
+}
+
+void theia::CompactMesh(const ObjMesh& mesh, std::vector<CompactVertex>& vertices, PositionQuantiser& quantiser)
+{
+  const size_t count = mesh.positions.size();
+  quantiser = PositionQuantiser::FromBounds(mesh.positions.data(), count);
+
+  vertices.resize(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    CompactVertex& v = vertices[i];
+    memset(&v, 0, sizeof(v));
+    quantiser.Encode(mesh.positions[i], v.position);
+    if (i < mesh.normals.size())
+    {
+      EncodeNormal(mesh.normals[i], v.normal);
+    }
+    if (i < mesh.texcoords.size())
+    {
+      v.texcoord[0] = FloatToHalf(mesh.texcoords[i].x);
+      v.texcoord[1] = FloatToHalf(mesh.texcoords[i].y);
+    }
+  }
+}
@@ -1,5 +1,6 @@
 /// Implements the keyboard input handler.
 
+#include <string.h>
 #include <memory>
 #include <SDL.h>
 #include <theia/input/keyboard.h>
@@ -0,0 +1,72 @@
+#include <theia/math/frustum.h>
+
+using namespace theia;
+
+//--------------------------------------------------------------------------------
+
+static glm::vec4 Row(const glm::mat4& m, int i)
+{
+  return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+}
+
+static glm::vec4 NormalizePlane(const glm::vec4& plane)
+{
+  const float length = glm::length(glm::vec3(plane.x, plane.y, plane.z));
+  return plane / length;
+}
+
+//--------------------------------------------------------------------------------
+
+Frustum::Frustum()
+{
+  for (int i = 0; i < NumPlanes; ++i) { planes[i] = glm::vec4(0); }
+}
+
+Frustum::Frustum(const glm::mat4& projection)
+{
+  // Gribb & Hartmann: a clip-space point is inside when -w <= x,y,z <= w...
+  const glm::vec4 x(Row(projection, 0));
+  const glm::vec4 y(Row(projection, 1));
+  const glm::vec4 z(Row(projection, 2));
+  const glm::vec4 w(Row(projection, 3));
+
+  planes[Plane_Left]   = NormalizePlane(w + x);
+  planes[Plane_Right]  = NormalizePlane(w - x);
+  planes[Plane_Bottom] = NormalizePlane(w + y);
+  planes[Plane_Top]    = NormalizePlane(w - y);
+  planes[Plane_Near]   = NormalizePlane(w + z);
+  planes[Plane_Far]    = NormalizePlane(w - z);
+}
+
+Frustum::Result Frustum::TestBox(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const
+{
+  Result result = Inside;
+  for (int i = 0; i < NumPlanes; ++i)
+  {
+    const glm::vec3 N(planes[i].x, planes[i].y, planes[i].z);
+
+    // The corners furthest along and against the plane normal...
+    const glm::vec3 positive((N.x >= 0) ? boundsMax.x : boundsMin.x,
+                             (N.y >= 0) ? boundsMax.y : boundsMin.y,
+                             (N.z >= 0) ? boundsMax.z : boundsMin.z);
+    const glm::vec3 negative((N.x >= 0) ? boundsMin.x : boundsMax.x,
+                             (N.y >= 0) ? boundsMin.y : boundsMax.y,
+                             (N.z >= 0) ? boundsMin.z : boundsMax.z);
+
+    if ((glm::dot(N, positive) + planes[i].w) < 0) { return Outside; }
+    if ((glm::dot(N, negative) + planes[i].w) < 0) { result = Intersecting; }
+  }
+  return result;
+}
+
+Frustum::Result Frustum::TestSphere(const glm::vec3& centre, float radius) const
+{
+  Result result = Inside;
+  for (int i = 0; i < NumPlanes; ++i)
+  {
+    const float distance = glm::dot(glm::vec3(planes[i].x, planes[i].y, planes[i].z), centre) + planes[i].w;
+    if (distance < -radius) { return Outside; }
+    if (distance < radius)  { result = Intersecting; }
+  }
+  return result;
+}
@@ -0,0 +1,417 @@
+#include <math.h>
+#include <theia/math/noise.h>
+
+// theia.vcxproj compiles for /arch:SSE2, so a 32-bit MSVC build takes the SSE2 path too; the
+// scalar one is only for other targets...
+#if defined(__AVX__)
+  #include <immintrin.h>
+  #define NOISE_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+  #include <emmintrin.h>
+  #define NOISE_SSE2
+#endif
+
+using namespace theia;
+
+//--------------------------------------------------------------------------------
+
+Noise::FractalSettings::FractalSettings()
+  : octaves(7), lacunarity(3.5f), gain(0.5123f)
+{
+}
+
+//--------------------------------------------------------------------------------
+// The 3D noise is written once against a "float-like" type so that the scalar and vector
+// versions can't drift apart. Each type needs arithmetic with itself and with float, plus
+// Floor, Min, Max, Abs and Step (GLSL's step(edge, x)).
+
+static inline float Floor(float x) { return floorf(x); }
+static inline float Min(float a, float b) { return (a < b) ? a : b; }
+static inline float Max(float a, float b) { return (a > b) ? a : b; }
+static inline float Abs(float x) { return fabsf(x); }
+static inline float Step(float edge, float x) { return (x < edge) ? 0.0f : 1.0f; }
+
+#if defined(NOISE_AVX)
+
+namespace
+{
+  struct FloatN
+  {
+    enum { Width = 8 };
+    __m256 v;
+    FloatN() {}
+    FloatN(__m256 v) : v(v) {}
+    FloatN(float f) : v(_mm256_set1_ps(f)) {}
+    static FloatN Load(const float* p) { return _mm256_loadu_ps(p); }
+    void Store(float* p) const { _mm256_storeu_ps(p, v); }
+  };
+
+  inline FloatN operator+(const FloatN& a, const FloatN& b) { return _mm256_add_ps(a.v, b.v); }
+  inline FloatN operator-(const FloatN& a, const FloatN& b) { return _mm256_sub_ps(a.v, b.v); }
+  inline FloatN operator*(const FloatN& a, const FloatN& b) { return _mm256_mul_ps(a.v, b.v); }
+  inline FloatN operator-(const FloatN& a) { return _mm256_sub_ps(_mm256_setzero_ps(), a.v); }
+  inline FloatN Floor(const FloatN& x) { return _mm256_floor_ps(x.v); }
+  inline FloatN Min(const FloatN& a, const FloatN& b) { return _mm256_min_ps(a.v, b.v); }
+  inline FloatN Max(const FloatN& a, const FloatN& b) { return _mm256_max_ps(a.v, b.v); }
+  inline FloatN Abs(const FloatN& x) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x.v); }
+  inline FloatN Step(const FloatN& edge, const FloatN& x) { return _mm256_and_ps(_mm256_cmp_ps(x.v, edge.v, _CMP_GE_OQ), _mm256_set1_ps(1.0f)); }
+}
+
+#elif defined(NOISE_SSE2)
+
+namespace
+{
+  struct FloatN
+  {
+    enum { Width = 4 };
+    __m128 v;
+    FloatN() {}
+    FloatN(__m128 v) : v(v) {}
+    FloatN(float f) : v(_mm_set1_ps(f)) {}
+    static FloatN Load(const float* p) { return _mm_loadu_ps(p); }
+    void Store(float* p) const { _mm_storeu_ps(p, v); }
+  };
+
+  inline FloatN operator+(const FloatN& a, const FloatN& b) { return _mm_add_ps(a.v, b.v); }
+  inline FloatN operator-(const FloatN& a, const FloatN& b) { return _mm_sub_ps(a.v, b.v); }
+  inline FloatN operator*(const FloatN& a, const FloatN& b) { return _mm_mul_ps(a.v, b.v); }
+  inline FloatN operator-(const FloatN& a) { return _mm_sub_ps(_mm_setzero_ps(), a.v); }
+  inline FloatN Min(const FloatN& a, const FloatN& b) { return _mm_min_ps(a.v, b.v); }
+  inline FloatN Max(const FloatN& a, const FloatN& b) { return _mm_max_ps(a.v, b.v); }
+  inline FloatN Abs(const FloatN& x) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), x.v); }
+  inline FloatN Step(const FloatN& edge, const FloatN& x) { return _mm_and_ps(_mm_cmpge_ps(x.v, edge.v), _mm_set1_ps(1.0f)); }
+
+  // SSE2 has no floor, so truncate and step down for negative non-integers. The inputs here
+  // are always well inside the range of an int...
+  inline FloatN Floor(const FloatN& x)
+  {
+    const __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(x.v));
+    return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, x.v), _mm_set1_ps(1.0f)));
+  }
+}
+
+#endif
+
+//--------------------------------------------------------------------------------
+
+template <typename T> static inline T Mod289(const T& x)
+{
+  return x - (Floor(x * (1.0f / 289.0f)) * 289.0f);
+}
+
+template <typename T> static inline T Permute(const T& x)
+{
+  return Mod289(((x * 34.0f) + 1.0f) * x);
+}
+
+template <typename T> static inline T TaylorInvSqrt(const T& r)
+{
+  return T(1.79284291400159f) - (r * 0.85373472095314f);
+}
+
+template <typename T> static T Simplex3(const T& vx, const T& vy, const T& vz)
+{
+  const float Cx = 1.0f / 6.0f;
+  const float Cy = 1.0f / 3.0f;
+
+  // First corner...
+  const T s = (vx + vy + vz) * Cy;
+  T ix = Floor(vx + s);
+  T iy = Floor(vy + s);
+  T iz = Floor(vz + s);
+  const T t = (ix + iy + iz) * Cx;
+  const T x0x = vx - ix + t;
+  const T x0y = vy - iy + t;
+  const T x0z = vz - iz + t;
+
+  // Other corners...
+  const T gx = Step(x0y, x0x);
+  const T gy = Step(x0z, x0y);
+  const T gz = Step(x0x, x0z);
+  const T lx = T(1.0f) - gx;
+  const T ly = T(1.0f) - gy;
+  const T lz = T(1.0f) - gz;
+  const T i1x = Min(gx, lz), i1y = Min(gy, lx), i1z = Min(gz, ly);
+  const T i2x = Max(gx, lz), i2y = Max(gy, lx), i2z = Max(gz, ly);
+
+  // Offsets of the four corners, and their steps through the lattice...
+  const T xs[4] = { x0x, x0x - i1x + Cx, x0x - i2x + Cy, x0x - 0.5f };
+  const T ys[4] = { x0y, x0y - i1y + Cx, x0y - i2y + Cy, x0y - 0.5f };
+  const T zs[4] = { x0z, x0z - i1z + Cx, x0z - i2z + Cy, x0z - 0.5f };
+  const T cx[4] = { T(0.0f), i1x, i2x, T(1.0f) };
+  const T cy[4] = { T(0.0f), i1y, i2y, T(1.0f) };
+  const T cz[4] = { T(0.0f), i1z, i2z, T(1.0f) };
+
+  // Permutations...
+  ix = Mod289(ix);
+  iy = Mod289(iy);
+  iz = Mod289(iz);
+
+  // Gradients: 7x7 points over a square, mapped onto an octahedron...
+  const float n_ = 0.142857142857f; // 1.0/7.0
+  const float nsx = n_ * 2.0f;
+  const float nsy = (n_ * 0.5f) - 1.0f;
+  const float nsz = n_;
+
+  T sum(0.0f);
+  for (int k = 0; k < 4; ++k)
+  {
+    const T p = Permute(Permute(Permute(iz + cz[k]) + iy + cy[k]) + ix + cx[k]);
+
+    const T j = p - (Floor(p * nsz * nsz) * 49.0f);
+    const T x_ = Floor(j * nsz);
+    const T y_ = Floor(j - (x_ * 7.0f));
+
+    const T x = (x_ * nsx) + nsy;
+    const T y = (y_ * nsx) + nsy;
+    const T h = T(1.0f) - Abs(x) - Abs(y);
+
+    const T sh = -Step(h, T(0.0f));
+    const T px = x + (((Floor(x) * 2.0f) + 1.0f) * sh);
+    const T py = y + (((Floor(y) * 2.0f) + 1.0f) * sh);
+    const T pz = h;
+
+    // Normalise the gradient...
+    const T norm = TaylorInvSqrt((px * px) + (py * py) + (pz * pz));
+
+    // Mix the final noise value...
+    T m = Max(T(0.6f) - ((xs[k] * xs[k]) + (ys[k] * ys[k]) + (zs[k] * zs[k])), T(0.0f));
+    m = m * m;
+    sum = sum + ((m * m) * (((px * xs[k]) + (py * ys[k]) + (pz * zs[k])) * norm));
+  }
+
+  return sum * 42.0f;
+}
+
+//--------------------------------------------------------------------------------
+
+float Noise::Simplex(const glm::vec2& v)
+{
+  const float Cx = 0.211324865405187f;  // (3.0-sqrt(3.0))/6.0
+  const float Cy = 0.366025403784439f;  // 0.5*(sqrt(3.0)-1.0)
+  const float Cz = -0.577350269189626f; // -1.0 + 2.0 * C.x
+  const float Cw = 0.024390243902439f;  // 1.0 / 41.0
+
+  // First corner...
+  const float s = (v.x + v.y) * Cy;
+  float ix = floorf(v.x + s);
+  float iy = floorf(v.y + s);
+  const float t = (ix + iy) * Cx;
+  const float x0x = v.x - ix + t;
+  const float x0y = v.y - iy + t;
+
+  // Other corners...
+  const float i1x = (x0x > x0y) ? 1.0f : 0.0f;
+  const float i1y = 1.0f - i1x;
+  const float x1x = x0x + Cx - i1x;
+  const float x1y = x0y + Cx - i1y;
+  const float x2x = x0x + Cz;
+  const float x2y = x0y + Cz;
+
+  // Permutations...
+  ix = Mod289(ix);
+  iy = Mod289(iy);
+  const float p[3] =
+  {
+    Permute(Permute(iy) + ix),
+    Permute(Permute(iy + i1y) + ix + i1x),
+    Permute(Permute(iy + 1.0f) + ix + 1.0f)
+  };
+
+  const float xs[3] = { x0x, x1x, x2x };
+  const float ys[3] = { x0y, x1y, x2y };
+
+  float sum = 0;
+  for (int k = 0; k < 3; ++k)
+  {
+    float m = Max(0.5f - ((xs[k] * xs[k]) + (ys[k] * ys[k])), 0.0f);
+    m = m * m;
+    m = m * m;
+
+    // Gradients: 41 points uniformly over a line, mapped onto a diamond...
+    const float pw = p[k] * Cw;
+    const float x = (2.0f * (pw - floorf(pw))) - 1.0f;
+    const float h = fabsf(x) - 0.5f;
+    const float ox = floorf(x + 0.5f);
+    const float a0 = x - ox;
+
+    // Normalise gradients implicitly by scaling m...
+    m *= 1.79284291400159f - (0.85373472095314f * ((a0 * a0) + (h * h)));
+    sum += m * ((a0 * xs[k]) + (h * ys[k]));
+  }
+
+  return 130.0f * sum;
+}
+
+float Noise::Simplex(const glm::vec3& P)
+{
+  return Simplex3(P.x, P.y, P.z);
+}
+
+//--------------------------------------------------------------------------------
+
+float Noise::fBm(const glm::vec2& P, const FractalSettings& settings)
+{
+  float frequency = 1;
+  float amplitude = 0.5f;
+  float sum = 0;
+  for (int i = 0; i < settings.octaves; ++i)
+  {
+    sum += Simplex(P * frequency) * amplitude;
+    frequency *= settings.lacunarity;
+    amplitude *= settings.gain;
+  }
+  return sum;
+}
+
+float Noise::fBm(const glm::vec3& P, const FractalSettings& settings)
+{
+  float frequency = 1;
+  float amplitude = 0.5f;
+  float sum = 0;
+  for (int i = 0; i < settings.octaves; ++i)
+  {
+    sum += Simplex(P * frequency) * amplitude;
+    frequency *= settings.lacunarity;
+    amplitude *= settings.gain;
+  }
+  return sum;
+}
+
+float Noise::Turbulence(const glm::vec2& P, const FractalSettings& settings)
+{
+  float frequency = 1;
+  float amplitude = 0.5f;
+  float sum = 0;
+  for (int i = 0; i < settings.octaves; ++i)
+  {
+    sum += fabsf(Simplex(P * frequency)) * amplitude;
+    frequency *= settings.lacunarity;
+    amplitude *= settings.gain;
+  }
+  return sum;
+}
+
+float Noise::GetHeightAt(const glm::vec3& P)
+{
+  static const FractalSettings settings;
+  return fBm(P, settings);
+}
+
+//--------------------------------------------------------------------------------
+
+const char* Noise::BatchInstructionSet()
+{
+#if defined(NOISE_AVX)
+  return "AVX";
+#elif defined(NOISE_SSE2)
+  return "SSE2";
+#else
+  return "scalar";
+#endif
+}
+
+void Noise::Simplex(const float* x, const float* y, const float* z, float* result)
+{
+#if defined(NOISE_AVX) || defined(NOISE_SSE2)
+  for (int i = 0; i < BatchSize; i += FloatN::Width)
+  {
+    Simplex3(FloatN::Load(x + i), FloatN::Load(y + i), FloatN::Load(z + i)).Store(result + i);
+  }
+#else
+  for (int i = 0; i < BatchSize; ++i)
+  {
+    result[i] = Simplex3(x[i], y[i], z[i]);
+  }
+#endif
+}
+
+void Noise::fBm(const float* x, const float* y, const float* z, const FractalSettings& settings, float* result)
+{
+#if defined(NOISE_AVX) || defined(NOISE_SSE2)
+  for (int i = 0; i < BatchSize; i += FloatN::Width)
+  {
+    const FloatN px(FloatN::Load(x + i));
+    const FloatN py(FloatN::Load(y + i));
+    const FloatN pz(FloatN::Load(z + i));
+
+    float frequency = 1;
+    float amplitude = 0.5f;
+    FloatN sum(0.0f);
+    for (int octave = 0; octave < settings.octaves; ++octave)
+    {
+      sum = sum + (Simplex3(px * frequency, py * frequency, pz * frequency) * amplitude);
+      frequency *= settings.lacunarity;
+      amplitude *= settings.gain;
+    }
+    sum.Store(result + i);
+  }
+#else
+  for (int i = 0; i < BatchSize; ++i)
+  {
+    result[i] = fBm(glm::vec3(x[i], y[i], z[i]), settings);
+  }
+#endif
+}
+
+//--------------------------------------------------------------------------------
+
+namespace
+{
+  // Gathers points into batches for one range of a parallel loop...
+  struct FractalBatches
+  {
+    const glm::vec3*              points;
+    size_t                        count;
+    const Noise::FractalSettings* settings;
+    float*                        result;
+
+    void operator()(int beginBatch, int endBatch) const
+    {
+      float x[Noise::BatchSize];
+      float y[Noise::BatchSize];
+      float z[Noise::BatchSize];
+      float values[Noise::BatchSize];
+
+      for (int batch = beginBatch; batch < endBatch; ++batch)
+      {
+        // A short final batch repeats its last point to fill the lanes...
+        const size_t first = (size_t)batch * Noise::BatchSize;
+        const size_t numPoints = ((count - first) < (size_t)Noise::BatchSize) ? (count - first) : (size_t)Noise::BatchSize;
+        for (int i = 0; i < Noise::BatchSize; ++i)
+        {
+          const glm::vec3& P = points[first + (((size_t)i < numPoints) ? i : (numPoints - 1))];
+          x[i] = P.x;
+          y[i] = P.y;
+          z[i] = P.z;
+        }
+
+        Noise::fBm(x, y, z, *settings, values);
+        for (size_t i = 0; i < numPoints; ++i)
+        {
+          result[first + i] = values[i];
+        }
+      }
+    }
+  };
+}
+
+void Noise::fBm(JobSystem* jobs, const glm::vec3* points, size_t count, const FractalSettings& settings, float* result)
+{
+  FractalBatches batches;
+  batches.points = points;
+  batches.count = count;
+  batches.settings = &settings;
+  batches.result = result;
+
+  const int numBatches = (int)((count + BatchSize - 1) / BatchSize);
+  const int batchesPerTask = 64;
+  if (NULL != jobs)
+  {
+    jobs->ParallelFor(numBatches, batchesPerTask, batches);
+  }
+  else
+  {
+    batches(0, numBatches);
+  }
+}
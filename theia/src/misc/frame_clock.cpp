@@ -0,0 +1,136 @@
+#include <float.h>
+#include <math.h>
+#include <boost/chrono.hpp>
+#include <boost/thread/thread.hpp>
+#include <theia/misc/debug.h>
+#include <theia/misc/frame_clock.h>
+
+using namespace theia;
+
+//--------------------------------------------------------------------------------
+
+FixedTimestep::FixedTimestep(double stepSeconds, int maxSteps)
+  : stepSeconds(stepSeconds), maxSteps(maxSteps), accumulator(0), previousTime(-1), droppedSteps(0)
+{
+  ASSERT(stepSeconds > 0.0);
+  ASSERT(maxSteps > 0);
+}
+
+int FixedTimestep::Advance(double now)
+{
+  if (previousTime < 0.0)
+  {
+    previousTime = now;
+    return 0;
+  }
+
+  accumulator += now - previousTime;
+  previousTime = now;
+
+  int steps = (int)(accumulator / stepSeconds);
+  if (steps > maxSteps)
+  {
+    droppedSteps += steps - maxSteps;
+    accumulator -= (steps - maxSteps) * stepSeconds;
+    steps = maxSteps;
+  }
+  accumulator -= steps * stepSeconds;
+  return steps;
+}
+
+//--------------------------------------------------------------------------------
+
+FrameTimeStats::FrameTimeStats()
+  : frames(0), totalMS(0), minMS(DBL_MAX), maxMS(0), sumSquaresMS(0)
+{
+}
+
+double FrameTimeStats::JitterMS() const
+{
+  if (frames < 2)
+  {
+    return 0.0;
+  }
+  const double mean = MeanMS();
+  const double variance = (sumSquaresMS / frames) - (mean * mean);
+  return (variance > 0.0) ? sqrt(variance) : 0.0;
+}
+
+//--------------------------------------------------------------------------------
+
+FrameClock::FrameClock()
+  : maxFrameRate(0), spinSeconds(0.002), frameStart(-1), nextFrame(0)
+{
+}
+
+double FrameClock::Now()
+{
+  const boost::chrono::steady_clock::duration sinceEpoch = boost::chrono::steady_clock::now().time_since_epoch();
+  return boost::chrono::duration<double>(sinceEpoch).count();
+}
+
+double FrameClock::Tick()
+{
+  const double now = Now();
+  if (frameStart < 0.0)
+  {
+    frameStart = now;
+    nextFrame = now;
+    return 0.0;
+  }
+
+  const double seconds = now - frameStart;
+  frameStart = now;
+
+  const double ms = seconds * 1000.0;
+  ++stats.frames;
+  stats.totalMS += ms;
+  stats.sumSquaresMS += ms * ms;
+  if (ms < stats.minMS) { stats.minMS = ms; }
+  if (ms > stats.maxMS) { stats.maxMS = ms; }
+  return seconds;
+}
+
+void FrameClock::SetMaxFrameRate(double framesPerSecond)
+{
+  maxFrameRate = (framesPerSecond > 0.0) ? framesPerSecond : 0.0;
+  nextFrame = Now();
+}
+
+void FrameClock::Pace()
+{
+  if (maxFrameRate <= 0.0)
+  {
+    return;
+  }
+
+  const double period = 1.0 / maxFrameRate;
+  nextFrame += period;
+
+  const double now = Now();
+  if (now >= nextFrame)
+  {
+    // Already late: if by a whole frame, start again from now rather than rushing the next
+    // few frames to catch up...
+    if ((now - nextFrame) >= period) { nextFrame = now; }
+    return;
+  }
+
+  // Sleep for most of the wait, then spin for the rest...
+  const double sleepSeconds = (nextFrame - now) - spinSeconds;
+  if (sleepSeconds > 0.0)
+  {
+    boost::this_thread::sleep_for(boost::chrono::duration<double>(sleepSeconds));
+  }
+  while (Now() < nextFrame)
+  {
+    boost::this_thread::yield();
+  }
+}
+
+FrameTimeStats FrameClock::TakeStats()
+{
+  const FrameTimeStats taken(stats);
+  stats = FrameTimeStats();
+  return taken;
+}
@@ -0,0 +1,365 @@
+#include <theia/misc/debug.h>
+#include <theia/misc/job_system.h>
+#include <theia/misc/profiler.h>
+
+using namespace theia;
+
+//--------------------------------------------------------------------------------
+
+namespace
+{
+  // Runs a loop body which doesn't care which thread it is on...
+  struct IgnoreThread
+  {
+    const JobSystem::RangeFunction* body;
+
+    void operator()(int, int begin, int end) const { (*body)(begin, end); }
+  };
+
+  // The state of one ParallelFor, shared by every thread taking chunks of it...
+  struct ParallelLoop
+  {
+    JobSystem*                              jobs;
+    const JobSystem::ThreadRangeFunction*   body;
+    int                                     count;
+    int                                     grainSize;
+    boost::atomic<int>                      nextIndex;
+
+    void RunChunks()
+    {
+      const int thread = jobs->ThreadIndex();
+      for (;;)
+      {
+        const int begin = nextIndex.fetch_add(grainSize);
+        if (begin >= count) { break; }
+        const int end = (begin + grainSize < count) ? begin + grainSize : count;
+        (*body)(thread, begin, end);
+      }
+    }
+  };
+
+  struct RunLoopChunks
+  {
+    ParallelLoop* loop;
+
+    void operator()() const { loop->RunChunks(); }
+  };
+}
+
+//--------------------------------------------------------------------------------
+
+JobCounter::JobCounter()
+  : pending(0)
+{
+}
+
+//--------------------------------------------------------------------------------
+
+JobSystemPtr JobSystem::Create(int numThreads)
+{
+  if (numThreads <= 0)
+  {
+    numThreads = (int)boost::thread::hardware_concurrency();
+    if (numThreads <= 0) { numThreads = 1; }
+  }
+
+  JobSystemPtr jobs(new JobSystem());
+  for (int i = 0; i < numThreads; ++i)
+  {
+    jobs->queues.push_back(new WorkQueue());
+  }
+
+  jobs->threadIndex.reset(new int(0));
+  for (int i = 1; i < numThreads; ++i)
+  {
+    jobs->workers.push_back(new boost::thread(&JobSystem::WorkerMain, jobs.get(), i));
+  }
+
+  return jobs;
+}
+
+JobSystem::JobSystem()
+  : queuedJobs(0), sleepingWorkers(0), quit(false)
+{
+}
+
+JobSystem::~JobSystem()
+{
+  {
+    boost::mutex::scoped_lock lock(sleepMutex);
+    quit = true;
+  }
+  workReady.notify_all();
+
+  for (size_t i = 0; i < workers.size(); ++i)
+  {
+    workers[i]->join();
+    delete workers[i];
+  }
+  for (size_t i = 0; i < queues.size(); ++i)
+  {
+    delete queues[i];
+  }
+}
+
+int JobSystem::ThreadIndex() const
+{
+  const int* const index = threadIndex.get();
+  return (NULL != index) ? *index : -1;
+}
+
+//--------------------------------------------------------------------------------
+
+void JobSystem::Run(const Job& job, JobCounter* counter)
+{
+  JobEntry entry;
+  entry.job = job;
+  entry.counter = counter;
+  if (NULL != counter) { ++counter->pending; }
+  Push(entry);
+}
+
+void JobSystem::RunAfter(JobCounter& dependency, const Job& job, JobCounter* counter)
+{
+  JobEntry entry;
+  entry.job = job;
+  entry.counter = counter;
+  if (NULL != counter) { ++counter->pending; }
+
+  {
+    // Finish zeroes the count under the same lock, so the job is either queued here or
+    // picked up with the other continuations...
+    boost::mutex::scoped_lock lock(dependency.mutex);
+    if (0 != dependency.pending)
+    {
+      dependency.continuations.push_back(entry);
+      return;
+    }
+  }
+  Push(entry);
+}
+
+void JobSystem::RunOnMainThread(const Job& job, JobCounter* counter)
+{
+  JobEntry entry;
+  entry.job = job;
+  entry.counter = counter;
+  if (NULL != counter) { ++counter->pending; }
+
+  boost::mutex::scoped_lock lock(mainThreadQueue.mutex);
+  mainThreadQueue.jobs.push_back(entry);
+}
+
+void JobSystem::RunMainThreadJobs()
+{
+  ASSERT(0 == ThreadIndex());
+  JobEntry entry;
+  while (PopMainThread(entry))
+  {
+    Execute(entry);
+  }
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+  // Rather than block, help with whatever else is queued. A thread the job system doesn't own
+  // only waits, since it has no thread index to give jobs which need one...
+  const int thread = ThreadIndex();
+  while (!counter.IsDone())
+  {
+    JobEntry entry;
+    if ((thread >= 0) && (((0 == thread) && PopMainThread(entry)) || Pop(thread, entry)))
+    {
+      Execute(entry);
+    }
+    else
+    {
+      boost::this_thread::yield();
+    }
+  }
+
+  // The thread which finished the last job may still hold the counter's lock, and the caller
+  // is free to destroy the counter as soon as this returns...
+  boost::mutex::scoped_lock lock(counter.mutex);
+}
+
+//--------------------------------------------------------------------------------
+
+void JobSystem::ParallelFor(int count, int grainSize, const RangeFunction& body)
+{
+  IgnoreThread adapter;
+  adapter.body = &body;
+  RunLoop(count, grainSize, adapter);
+}
+
+void JobSystem::ParallelForWithThread(int count, int grainSize, const ThreadRangeFunction& body)
+{
+  // The calling thread runs chunks itself, so must have an index to give the body...
+  ASSERT(ThreadIndex() >= 0);
+  RunLoop(count, grainSize, body);
+}
+
+void JobSystem::RunLoop(int count, int grainSize, const ThreadRangeFunction& body)
+{
+  if (count <= 0) { return; }
+  if (grainSize < 1) { grainSize = 1; }
+
+  // Not worth queueing anything for a single chunk...
+  const int numChunks = (count + grainSize - 1) / grainSize;
+  if ((1 == numChunks) || workers.empty())
+  {
+    body(ThreadIndex(), 0, count);
+    return;
+  }
+
+  ParallelLoop loop;
+  loop.jobs = this;
+  loop.body = &body;
+  loop.count = count;
+  loop.grainSize = grainSize;
+  loop.nextIndex = 0;
+
+  // A job per other thread takes chunks until none are left. Idle threads steal them; busy
+  // ones find nothing to do by the time they get to them...
+  RunLoopChunks helper;
+  helper.loop = &loop;
+  const int numHelpers = ((numChunks < NumThreads()) ? numChunks : NumThreads()) - 1;
+  JobCounter counter;
+  for (int i = 0; i < numHelpers; ++i)
+  {
+    Run(helper, &counter);
+  }
+
+  loop.RunChunks();
+  Wait(counter);
+}
+
+//--------------------------------------------------------------------------------
+
+void JobSystem::Push(const JobEntry& entry)
+{
+  // Jobs go on the back of the queuing thread's own deque, or the main thread's if the job
+  // system doesn't own it...
+  const int thread = ThreadIndex();
+  WorkQueue& queue = *queues[(thread >= 0) ? thread : 0];
+
+  ++queuedJobs;
+  {
+    boost::mutex::scoped_lock lock(queue.mutex);
+    queue.jobs.push_back(entry);
+  }
+
+  if (sleepingWorkers > 0)
+  {
+    boost::mutex::scoped_lock lock(sleepMutex);
+    workReady.notify_one();
+  }
+}
+
+bool JobSystem::Pop(int thread, JobEntry& entry)
+{
+  ASSERT(thread >= 0);
+
+  // The newest job of our own, whose data is most likely to still be in the cache...
+  {
+    WorkQueue& queue = *queues[thread];
+    boost::mutex::scoped_lock lock(queue.mutex);
+    if (!queue.jobs.empty())
+    {
+      entry = queue.jobs.back();
+      queue.jobs.pop_back();
+      --queuedJobs;
+      return true;
+    }
+  }
+
+  // ...otherwise the oldest job of someone else, which is likely to be the biggest...
+  const int numQueues = (int)queues.size();
+  for (int i = 1; (i <= numQueues) && (queuedJobs > 0); ++i)
+  {
+    const int victim = (thread + i) % numQueues;
+    if (victim == thread) { continue; }
+
+    WorkQueue& queue = *queues[victim];
+    boost::mutex::scoped_lock lock(queue.mutex);
+    if (!queue.jobs.empty())
+    {
+      entry = queue.jobs.front();
+      queue.jobs.pop_front();
+      --queuedJobs;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool JobSystem::PopMainThread(JobEntry& entry)
+{
+  boost::mutex::scoped_lock lock(mainThreadQueue.mutex);
+  if (mainThreadQueue.jobs.empty())
+  {
+    return false;
+  }
+  entry = mainThreadQueue.jobs.front();
+  mainThreadQueue.jobs.pop_front();
+  return true;
+}
+
+void JobSystem::Execute(JobEntry& entry)
+{
+  entry.job();
+  Finish(entry.counter);
+}
+
+void JobSystem::Finish(JobCounter* counter)
+{
+  if (NULL == counter)
+  {
+    return;
+  }
+
+  std::vector<JobEntry> ready;
+  {
+    boost::mutex::scoped_lock lock(counter->mutex);
+    if (0 == --counter->pending)
+    {
+      ready.swap(counter->continuations);
+    }
+  }
+
+  for (size_t i = 0; i < ready.size(); ++i)
+  {
+    Push(ready[i]);
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+void JobSystem::WorkerMain(int thread)
+{
+  threadIndex.reset(new int(thread));
+
+  char name[32];
+  sprintf(name, "worker %d", thread);
+  Profiler::SetThreadName(name);
+
+  for (;;)
+  {
+    JobEntry entry;
+    if (Pop(thread, entry))
+    {
+      Execute(entry);
+      continue;
+    }
+
+    boost::mutex::scoped_lock lock(sleepMutex);
+    ++sleepingWorkers;
+    while (!quit && (0 >= queuedJobs))
+    {
+      workReady.wait(lock);
+    }
+    --sleepingWorkers;
+    if (quit) { return; }
+  }
+}
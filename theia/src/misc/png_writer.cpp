@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <theia/misc/debug.h>
+#include <theia/misc/png_writer.h>
+
+using namespace theia;
+
+//--------------------------------------------------------------------------------
+
+namespace
+{
+  // Largest block deflate can store uncompressed...
+  const size_t MaxStoredBlock = 65535;
+
+  struct Crc32
+  {
+    Crc32()
+    {
+      for (uint32_t n = 0; n < 256; ++n)
+      {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k)
+        {
+          c = (c & 1) ? (0xedb88320u ^ (c >> 1)) : (c >> 1);
+        }
+        table[n] = c;
+      }
+    }
+
+    uint32_t Update(uint32_t crc, const uint8_t* data, size_t size) const
+    {
+      uint32_t c = crc ^ 0xffffffffu;
+      for (size_t i = 0; i < size; ++i)
+      {
+        c = table[(c ^ data[i]) & 0xff] ^ (c >> 8);
+      }
+      return c ^ 0xffffffffu;
+    }
+
+    uint32_t table[256];
+  };
+
+  uint32_t Adler32(const std::vector<uint8_t>& data)
+  {
+    // The sums can go this many bytes before they need reducing without overflowing...
+    const size_t MaxRun = 5552;
+
+    uint32_t a = 1, b = 0;
+    for (size_t start = 0; start < data.size(); start += MaxRun)
+    {
+      const size_t end = (data.size() - start < MaxRun) ? data.size() : start + MaxRun;
+      for (size_t i = start; i < end; ++i)
+      {
+        a += data[i];
+        b += a;
+      }
+      a %= 65521;
+      b %= 65521;
+    }
+    return (b << 16) | a;
+  }
+
+  void AppendBigEndian(std::vector<uint8_t>& out, uint32_t value)
+  {
+    out.push_back((uint8_t)(value >> 24));
+    out.push_back((uint8_t)(value >> 16));
+    out.push_back((uint8_t)(value >> 8));
+    out.push_back((uint8_t)value);
+  }
+
+  void AppendChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data)
+  {
+    static const Crc32 crc32;
+
+    AppendBigEndian(out, (uint32_t)data.size());
+    const size_t typeStart = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    AppendBigEndian(out, crc32.Update(0, &out[typeStart], out.size() - typeStart));
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+bool PngWriter::Write(const char* path, int width, int height, const std::vector<uint8_t>& rgba)
+{
+  ASSERT(rgba.size() == (size_t)width * height * 4);
+
+  // Each row starts with its filter type, here always none...
+  const size_t rowBytes = width * 4;
+  std::vector<uint8_t> raw;
+  raw.reserve((rowBytes + 1) * height);
+  for (int y = 0; y < height; ++y)
+  {
+    raw.push_back(0);
+    raw.insert(raw.end(), rgba.begin() + y * rowBytes, rgba.begin() + (y + 1) * rowBytes);
+  }
+
+  // A zlib stream of stored deflate blocks...
+  std::vector<uint8_t> zlib;
+  zlib.reserve(raw.size() + (raw.size() / MaxStoredBlock + 1) * 5 + 6);
+  zlib.push_back(0x78);
+  zlib.push_back(0x01);
+  size_t offset = 0;
+  do
+  {
+    const size_t size = (raw.size() - offset < MaxStoredBlock) ? raw.size() - offset : MaxStoredBlock;
+    const bool last = (offset + size) == raw.size();
+    zlib.push_back(last ? 1 : 0);
+    zlib.push_back((uint8_t)size);
+    zlib.push_back((uint8_t)(size >> 8));
+    zlib.push_back((uint8_t)~size);
+    zlib.push_back((uint8_t)(~size >> 8));
+    zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+    offset += size;
+  } while (offset < raw.size());
+  AppendBigEndian(zlib, Adler32(raw));
+
+  std::vector<uint8_t> header;
+  AppendBigEndian(header, width);
+  AppendBigEndian(header, height);
+  header.push_back(8);  // bits per channel
+  header.push_back(6);  // RGBA
+  header.push_back(0);  // deflate
+  header.push_back(0);  // adaptive filtering
+  header.push_back(0);  // not interlaced
+
+  static const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+  std::vector<uint8_t> png(signature, signature + sizeof(signature));
+  AppendChunk(png, "IHDR", header);
+  AppendChunk(png, "IDAT", zlib);
+  AppendChunk(png, "IEND", std::vector<uint8_t>());
+
+  FILE* file = fopen(path, "wb");
+  if (NULL == file)
+  {
+    LOG("unable to write '%s'\n", path);
+    return false;
+  }
+  const bool written = (png.size() == fwrite(&png[0], 1, png.size(), file));
+  fclose(file);
+  return written;
+}
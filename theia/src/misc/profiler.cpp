@@ -0,0 +1,389 @@
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <boost/atomic.hpp>
+#include <boost/chrono.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/once.hpp>
+#include <theia/misc/debug.h>
+#include <theia/misc/profiler.h>
+#if defined(_MSC_VER)
+  #include <intrin.h>
+  #define THEIA_THREAD_LOCAL __declspec(thread)
+  #define THEIA_HAS_TSC
+#else
+  #define THEIA_THREAD_LOCAL __thread
+  #if defined(__i386__) || defined(__x86_64__)
+    #include <x86intrin.h>
+    #define THEIA_HAS_TSC
+  #endif
+#endif
+
+using namespace theia;
+
+//--------------------------------------------------------------------------------
+
+namespace
+{
+  // Scopes recorded by each thread in a frame before the oldest are overwritten...
+  const uint32_t BufferCapacity = 16384;
+
+  // Scopes kept by a capture before it stops keeping any more...
+  const size_t MaxCapturedEvents = 4 * 1024 * 1024;
+
+  struct ProfileEvent
+  {
+    const char* name;
+    int64_t     begin;
+    int64_t     end;
+  };
+
+  // A ring written only by its own thread and read only by EndFrame. The writer publishes
+  // each event by bumping the count after writing it; the reader copies what has been
+  // published, then throws away anything the writer may have lapped while it was copying...
+  struct ThreadBuffer
+  {
+    ThreadBuffer(int id) : id(id), written(0), read(0) { }
+
+    int                     id;
+    std::string             name;
+    ProfileEvent            events[BufferCapacity];
+    boost::atomic<uint32_t> written;  // events ever written
+    uint32_t                read;     // events ever collected
+  };
+
+  struct CapturedEvent
+  {
+    int           thread;
+    ProfileEvent  event;
+  };
+
+  struct SummaryTotals
+  {
+    SummaryTotals() : calls(0), total(0), max(0) { }
+
+    int     calls;
+    int64_t total;
+    int64_t max;
+  };
+
+  struct CompareNames
+  {
+    bool operator()(const char* a, const char* b) const { return strcmp(a, b) < 0; }
+  };
+
+  struct MoreExpensive
+  {
+    bool operator()(const ProfileSummaryEntry& a, const ProfileSummaryEntry& b) const { return a.totalMS > b.totalMS; }
+  };
+
+  int64_t SteadyNow()
+  {
+    return boost::chrono::duration_cast<boost::chrono::nanoseconds>(boost::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  // Reading the steady clock costs a system call or QueryPerformanceCounter, far more than
+  // the scopes it times on hot paths, so where there is one the CPU's time-stamp counter is
+  // read instead. It is converted to the steady clock's nanoseconds by a scale measured the
+  // first time the clock is read; modern CPUs run the counter at a constant rate whatever
+  // their clock speed...
+  struct TickClock
+  {
+    void Calibrate()
+    {
+      baseTime = SteadyNow();
+#if defined(THEIA_HAS_TSC)
+      baseTicks = (int64_t)__rdtsc();
+      int64_t now;
+      do { now = SteadyNow(); } while ((now - baseTime) < 2000000);
+      const int64_t ticks = (int64_t)__rdtsc();
+      nanosecondsPerTick = (double)(now - baseTime) / (double)(ticks - baseTicks);
+#endif
+    }
+
+    int64_t Now() const
+    {
+#if defined(THEIA_HAS_TSC)
+      return baseTime + (int64_t)((double)((int64_t)__rdtsc() - baseTicks) * nanosecondsPerTick);
+#else
+      return SteadyNow();
+#endif
+    }
+
+    int64_t baseTicks;
+    int64_t baseTime;
+    double  nanosecondsPerTick;
+  };
+
+  // Calibrating spins for a couple of milliseconds, so it waits until something is timed
+  // rather than holding up the start of every program linking the library. Both are left
+  // to static zero-initialisation, so a scope timed by another file's static initialiser
+  // can't have its calibration overwritten later...
+  TickClock                             tickClock;
+  boost::once_flag                      tickClockCalibrated = BOOST_ONCE_INIT;
+
+  void CalibrateTickClock()
+  {
+    tickClock.Calibrate();
+  }
+
+  boost::atomic<bool>                   enabled(true);
+  boost::mutex                          buffersMutex;
+  std::vector<ThreadBuffer*>            buffers;
+
+  // Each thread's own buffer, once it has one. Buffers are never freed, since a thread may
+  // exit with events still to be collected...
+  THEIA_THREAD_LOCAL ThreadBuffer*      currentBuffer = NULL;
+
+  // Collected by EndFrame...
+  std::vector<ProfileEvent>             scratch;
+  std::map<const char*, SummaryTotals, CompareNames> summary;
+  int                                   summaryFrames = 0;
+  uint32_t                              droppedEvents = 0;
+  bool                                  capturing = false;
+  int64_t                               captureStart = 0;
+  int                                   frameThread = 0;  // which calls EndFrame
+  std::vector<CapturedEvent>            captured;
+  std::vector<int64_t>                  capturedFrames;
+
+  void Append(ThreadBuffer& buffer, const char* name, int64_t begin, int64_t end)
+  {
+    const uint32_t index = buffer.written.load(boost::memory_order_relaxed);
+    ProfileEvent& event = buffer.events[index % BufferCapacity];
+    event.name = name;
+    event.begin = begin;
+    event.end = end;
+    buffer.written.store(index + 1, boost::memory_order_release);
+  }
+
+  ThreadBuffer& GetBuffer()
+  {
+    if (NULL == currentBuffer)
+    {
+      boost::mutex::scoped_lock lock(buffersMutex);
+      currentBuffer = new ThreadBuffer((int)buffers.size());
+      buffers.push_back(currentBuffer);
+    }
+    return *currentBuffer;
+  }
+
+  void Collect(ThreadBuffer& buffer)
+  {
+    const uint32_t written = buffer.written.load(boost::memory_order_acquire);
+    uint32_t first = buffer.read;
+    if ((written - first) > BufferCapacity)
+    {
+      droppedEvents += (written - first) - BufferCapacity;
+      first = written - BufferCapacity;
+    }
+
+    scratch.clear();
+    for (uint32_t i = first; i != written; ++i)
+    {
+      scratch.push_back(buffer.events[i % BufferCapacity]);
+    }
+    buffer.read = written;
+
+    // Events the writer has since wrapped round onto may have been copied half-written...
+    const uint32_t rewritten = buffer.written.load(boost::memory_order_acquire);
+    size_t skip = 0;
+    if ((rewritten - first) > BufferCapacity)
+    {
+      skip = std::min((size_t)((rewritten - first) - BufferCapacity), scratch.size());
+      droppedEvents += (uint32_t)skip;
+    }
+
+    for (size_t i = skip; i < scratch.size(); ++i)
+    {
+      const ProfileEvent& event = scratch[i];
+      const int64_t duration = event.end - event.begin;
+      SummaryTotals& totals = summary[event.name];
+      ++totals.calls;
+      totals.total += duration;
+      if (duration > totals.max) { totals.max = duration; }
+
+      if (capturing && (captured.size() < MaxCapturedEvents))
+      {
+        CapturedEvent capturedEvent;
+        capturedEvent.thread = buffer.id;
+        capturedEvent.event = event;
+        captured.push_back(capturedEvent);
+      }
+    }
+  }
+
+  // Chrome traces count in microseconds...
+  double ToMicroseconds(int64_t time)
+  {
+    return (double)(time - captureStart) / 1000.0;
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+int64_t Profiler::Now()
+{
+  boost::call_once(&CalibrateTickClock, tickClockCalibrated);
+  return tickClock.Now();
+}
+
+void Profiler::SetEnabled(bool enable)
+{
+  enabled = enable;
+}
+
+bool Profiler::IsEnabled()
+{
+  return enabled.load(boost::memory_order_relaxed);
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+  ThreadBuffer& buffer = GetBuffer();
+  boost::mutex::scoped_lock lock(buffersMutex);
+  buffer.name = name;
+}
+
+void Profiler::Record(const char* name, int64_t begin, int64_t end)
+{
+  Append(GetBuffer(), name, begin, end);
+}
+
+int Profiler::AddTrack(const char* name)
+{
+  boost::mutex::scoped_lock lock(buffersMutex);
+  ThreadBuffer* const track = new ThreadBuffer((int)buffers.size());
+  track->name = name;
+  buffers.push_back(track);
+  return track->id;
+}
+
+void Profiler::RecordOnTrack(int track, const char* name, int64_t begin, int64_t end)
+{
+  ThreadBuffer* buffer;
+  {
+    // Threads registering themselves may move the list...
+    boost::mutex::scoped_lock lock(buffersMutex);
+    ASSERT((track >= 0) && (track < (int)buffers.size()));
+    buffer = buffers[track];
+  }
+  Append(*buffer, name, begin, end);
+}
+
+//--------------------------------------------------------------------------------
+
+void Profiler::EndFrame()
+{
+  const int64_t now = Now();
+  const int thread = GetBuffer().id;
+
+  boost::mutex::scoped_lock lock(buffersMutex);
+  for (size_t i = 0; i < buffers.size(); ++i)
+  {
+    Collect(*buffers[i]);
+  }
+  ++summaryFrames;
+
+  if (capturing)
+  {
+    capturedFrames.push_back(now);
+    frameThread = thread;
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+void Profiler::StartCapture()
+{
+  boost::mutex::scoped_lock lock(buffersMutex);
+  captured.clear();
+  capturedFrames.clear();
+  captureStart = Now();
+  capturing = true;
+}
+
+bool Profiler::IsCapturing()
+{
+  return capturing;
+}
+
+bool Profiler::StopCapture(const char* path)
+{
+  boost::mutex::scoped_lock lock(buffersMutex);
+  capturing = false;
+
+  FILE* file = fopen(path, "w");
+  if (NULL == file)
+  {
+    LOG("unable to write profile trace '%s'\n", path);
+    return false;
+  }
+
+  fprintf(file, "{\"traceEvents\":[\n");
+  const char* separator = "";
+  for (size_t i = 0; i < buffers.size(); ++i)
+  {
+    if (!buffers[i]->name.empty())
+    {
+      fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+        separator, buffers[i]->id, buffers[i]->name.c_str());
+      separator = ",\n";
+    }
+  }
+  for (size_t i = 0; i < captured.size(); ++i)
+  {
+    const CapturedEvent& item = captured[i];
+    if (item.event.begin < captureStart) { continue; }
+    fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+      separator, item.event.name, item.thread,
+      ToMicroseconds(item.event.begin), (double)(item.event.end - item.event.begin) / 1000.0);
+    separator = ",\n";
+  }
+  for (size_t i = 0; i < capturedFrames.size(); ++i)
+  {
+    fprintf(file, "%s{\"name\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}",
+      separator, frameThread, ToMicroseconds(capturedFrames[i]));
+    separator = ",\n";
+  }
+  fprintf(file, "\n]}\n");
+  const bool written = (0 == ferror(file));
+  fclose(file);
+
+  LOG("profile trace: %d scopes over %d frames written to '%s'%s\n", (int)captured.size(), (int)capturedFrames.size(), path,
+    (captured.size() >= MaxCapturedEvents) ? " (capture full)" : "");
+  captured.clear();
+  capturedFrames.clear();
+  return written;
+}
+
+//--------------------------------------------------------------------------------
+
+int Profiler::TakeSummary(std::vector<ProfileSummaryEntry>& entries)
+{
+  boost::mutex::scoped_lock lock(buffersMutex);
+
+  entries.clear();
+  std::map<const char*, SummaryTotals, CompareNames>::const_iterator it;
+  for (it = summary.begin(); it != summary.end(); ++it)
+  {
+    ProfileSummaryEntry entry;
+    entry.name = it->first;
+    entry.calls = it->second.calls;
+    entry.totalMS = (double)it->second.total / 1.0e6;
+    entry.maxMS = (double)it->second.max / 1.0e6;
+    entries.push_back(entry);
+  }
+  std::sort(entries.begin(), entries.end(), MoreExpensive());
+
+  if (droppedEvents > 0)
+  {
+    LOG("profiler: %u scopes lost to full buffers\n", droppedEvents);
+    droppedEvents = 0;
+  }
+
+  const int frames = summaryFrames;
+  summary.clear();
+  summaryFrames = 0;
+  return frames;
+}
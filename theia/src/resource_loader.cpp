@@ -1,12 +1,81 @@
-#include <SDL.h>
-#include <Windows.h>
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+#if defined(_WIN32)
+  #include <Windows.h>
+#endif
+#include <theia/misc/debug.h>
 #include <theia/resource_loader.h>
 
+//--------------------------------------------------------------------------------
+
+namespace
+{
+  struct RegisteredFile
+  {
+    std::string       path;
+    bool              loaded;
+    std::vector<char> contents;
+  };
+
+  // Only ever added to, so that loaded contents stay where they are...
+  std::map<uint32_t, RegisteredFile> registeredFiles;
+
+  bool ReadFile(const std::string& path, std::vector<char>& contents)
+  {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (NULL == file)
+    {
+      return false;
+    }
+
+    char block[4096];
+    size_t read;
+    while ((read = fread(block, 1, sizeof(block), file)) > 0)
+    {
+      contents.insert(contents.end(), block, block + read);
+    }
+    const bool ok = (0 == ferror(file));
+    fclose(file);
+    return ok;
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+void theia::ResourceLoader::Register(uint32_t id, const char* path)
+{
+  RegisteredFile& file = registeredFiles[id];
+  file.path = path;
+  file.loaded = false;
+  file.contents.clear();
+}
+
 void theia::ResourceLoader::Load(uint32_t id, uint32_t type, Resource& resource)
 {
   resource.data = NULL;
   resource.sizeInBytes = 0;
 
+  std::map<uint32_t, RegisteredFile>::iterator registered = registeredFiles.find(id);
+  if (registered != registeredFiles.end())
+  {
+    RegisteredFile& file = registered->second;
+    if (!file.loaded)
+    {
+      if (!ReadFile(file.path, file.contents))
+      {
+        LOG("unable to read resource %u from '%s'\n", id, file.path.c_str());
+        return;
+      }
+      file.loaded = true;
+    }
+    resource.sizeInBytes = file.contents.size();
+    resource.data = file.contents.empty() ? NULL : &file.contents[0];
+    return;
+  }
+
+#if defined(_WIN32)
   HMODULE module = GetModuleHandle(NULL);
   HRSRC rc = FindResource(module, MAKEINTRESOURCE(id), MAKEINTRESOURCE(type));
   HGLOBAL handle = LoadResource(module, rc);
@@ -15,4 +84,7 @@ void theia::ResourceLoader::Load(uint32_t id, uint32_t type, Resource& resource)
     resource.sizeInBytes = SizeofResource(module, rc);
     resource.data = (void*)LockResource(handle);
   }
+#else
+  (void)type;
+#endif
 }
@@ -0,0 +1,59 @@
+#include <math.h>
+#include <theia/terrain/cube_sphere.h>
+
+using namespace theia::terrain;
+
+//--------------------------------------------------------------------------------
+
+static const CubeSphere::FaceBasis faces[CubeSphere::NumFaces] =
+{
+  { glm::vec3(1,0,0),  glm::vec3(0,1,0),  glm::vec3(0,0,1) },
+  { glm::vec3(0,0,-1), glm::vec3(0,1,0),  glm::vec3(1,0,0) },
+  { glm::vec3(-1,0,0), glm::vec3(0,1,0),  glm::vec3(0,0,-1) },
+  { glm::vec3(0,0,1),  glm::vec3(0,1,0),  glm::vec3(-1,0,0) },
+  { glm::vec3(1,0,0),  glm::vec3(0,0,-1), glm::vec3(0,1,0) },
+  { glm::vec3(1,0,0),  glm::vec3(0,0,1),  glm::vec3(0,-1,0) }
+};
+
+//--------------------------------------------------------------------------------
+
+const CubeSphere::FaceBasis& CubeSphere::GetFace(int face)
+{
+  return faces[face];
+}
+
+glm::vec3 CubeSphere::FaceToCube(int face, const glm::vec2& uv)
+{
+  const FaceBasis& basis = faces[face];
+  return ((uv.x - 0.5f) * basis.x) + ((uv.y - 0.5f) * basis.y) + (0.5f * basis.normal);
+}
+
+glm::vec3 CubeSphere::FaceToSphere(int face, const glm::vec2& uv, float radius)
+{
+  return radius * glm::normalize(FaceToCube(face, uv));
+}
+
+void CubeSphere::ComputeBounds(int face, const glm::vec2& origin, float size, float radius, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+  // Sample the surface on a 3x3 grid...
+  boundsMin = glm::vec3(radius);
+  boundsMax = glm::vec3(-radius);
+  for (int y = 0; y <= 2; ++y)
+  {
+    for (int x = 0; x <= 2; ++x)
+    {
+      const glm::vec2 uv(origin + (glm::vec2((float)x, (float)y) * (0.5f * size)));
+      const glm::vec3 P(FaceToSphere(face, uv, radius));
+      boundsMin = glm::min(boundsMin, P);
+      boundsMax = glm::max(boundsMax, P);
+    }
+  }
+
+  // ...then grow the box by the height of the spherical cap between the samples, which
+  // is where the surface bulges out past them. A face coordinate subtends at most 2 radians
+  // per unit (at the centre of the face), so the samples are never more than size radians apart.
+  const float halfSpacing = 0.5f * size;
+  const glm::vec3 bulge(radius * (1.0f - cosf(halfSpacing)));
+  boundsMin -= bulge;
+  boundsMax += bulge;
+}
@@ -0,0 +1,100 @@
+#include <theia/misc/debug.h>
+#include <theia/terrain/cube_sphere.h>
+#include <theia/terrain/gpu_grid_builder.h>
+
+using namespace theia;
+using namespace theia::terrain;
+
+//--------------------------------------------------------------------------------
+
+bool GpuGridBuilder::IsSupported()
+{
+  return (NULL != glDispatchCompute);
+}
+
+GpuGridBuilderPtr GpuGridBuilder::Create(const ShaderPtr& shader)
+{
+  GpuGridBuilderPtr builder(new GpuGridBuilder());
+  builder->shader = shader;
+  builder->firstFaceParam = shader->GetParameter("FirstFace");
+  builder->originParam = shader->GetParameter("GridOrigin");
+  builder->sizeParam = shader->GetParameter("GridSize");
+  builder->verticesPerEdgeParam = shader->GetParameter("VerticesPerEdge");
+  builder->radiusParam = shader->GetParameter("Radius");
+  builder->firstValueParam = shader->GetParameter("FirstValue");
+  builder->strideParam = shader->GetParameter("VertexStride");
+  builder->positionOffsetParam = shader->GetParameter("PositionOffset");
+  builder->directionOffsetParam = shader->GetParameter("DirectionOffset");
+  builder->normalOffsetParam = shader->GetParameter("NormalOffset");
+  builder->heightOffsetParam = shader->GetParameter("HeightOffset");
+
+  if (   (NULL == builder->firstFaceParam) || (NULL == builder->originParam) || (NULL == builder->sizeParam)
+      || (NULL == builder->verticesPerEdgeParam) || (NULL == builder->radiusParam) || (NULL == builder->firstValueParam)
+      || (NULL == builder->strideParam) || (NULL == builder->positionOffsetParam) || (NULL == builder->directionOffsetParam)
+      || (NULL == builder->normalOffsetParam) || (NULL == builder->heightOffsetParam))
+  {
+    LOG("grid compute shader is missing parameters\n");
+    return GpuGridBuilderPtr();
+  }
+  return builder;
+}
+
+GpuGridBuilder::GpuGridBuilder()
+  : firstFaceParam(NULL), originParam(NULL), sizeParam(NULL), verticesPerEdgeParam(NULL), radiusParam(NULL),
+    firstValueParam(NULL), strideParam(NULL), positionOffsetParam(NULL), directionOffsetParam(NULL), normalOffsetParam(NULL),
+    heightOffsetParam(NULL)
+{
+}
+
+bool GpuGridBuilder::BuildPatch(VertexBuffer& buffer, size_t firstVertex, int face, const glm::vec2& origin, float size,
+                                int verticesPerEdge, float radius, const GridLayout& layout)
+{
+  return Dispatch(buffer, firstVertex, face, 1, origin, size, verticesPerEdge, radius, layout);
+}
+
+bool GpuGridBuilder::BuildFaces(VertexBuffer& buffer, size_t firstVertex, int verticesPerEdge, float radius, const GridLayout& layout)
+{
+  return Dispatch(buffer, firstVertex, 0, CubeSphere::NumFaces, glm::vec2(0), 1.0f, verticesPerEdge, radius, layout);
+}
+
+//--------------------------------------------------------------------------------
+
+bool GpuGridBuilder::Dispatch(VertexBuffer& buffer, size_t firstVertex, int firstFace, int numFaces, const glm::vec2& origin, float size,
+                              int verticesPerEdge, float radius, const GridLayout& layout)
+{
+  // The shader addresses the buffer as an array of 32-bit words...
+  const int wordSize = (int)sizeof(uint32_t);
+  if (   (0 != (layout.stride % sizeof(uint32_t)))
+      || ((layout.positionOffset >= 0) && (0 != (layout.positionOffset % wordSize)))
+      || ((layout.directionOffset >= 0) && (0 != (layout.directionOffset % wordSize)))
+      || ((layout.normalOffset >= 0) && (0 != (layout.normalOffset % wordSize)))
+      || ((layout.heightOffset >= 0) && (0 != (layout.heightOffset % wordSize))))
+  {
+    LOG("grid layout must be aligned to 32-bit words\n");
+    return false;
+  }
+
+  const int wordsPerVertex = (int)(layout.stride / sizeof(uint32_t));
+  shader->SetParameter(firstFaceParam, firstFace);
+  shader->SetParameter(originParam, origin);
+  shader->SetParameter(sizeParam, size);
+  shader->SetParameter(verticesPerEdgeParam, verticesPerEdge);
+  shader->SetParameter(radiusParam, radius);
+  shader->SetParameter(firstValueParam, (int)firstVertex * wordsPerVertex);
+  shader->SetParameter(strideParam, wordsPerVertex);
+  shader->SetParameter(positionOffsetParam, (layout.positionOffset < 0) ? -1 : layout.positionOffset / wordSize);
+  shader->SetParameter(directionOffsetParam, (layout.directionOffset < 0) ? -1 : layout.directionOffset / wordSize);
+  shader->SetParameter(normalOffsetParam, (layout.normalOffset < 0) ? -1 : layout.normalOffset / wordSize);
+  shader->SetParameter(heightOffsetParam, (layout.heightOffset < 0) ? -1 : layout.heightOffset / wordSize);
+  shader->Activate();
+
+  buffer.BindStorage(0);
+  const GLuint groups = (GLuint)((verticesPerEdge + LocalSize - 1) / LocalSize);
+  glDispatchCompute(groups, groups, (GLuint)numFaces);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+
+  // Vertex fetches from the buffer must see the shader's writes...
+  glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+  return true;
+}
@@ -0,0 +1,183 @@
+#include <math.h>
+#include <theia/terrain/cube_sphere.h>
+#include <theia/misc/profiler.h>
+#include <theia/terrain/grid_builder.h>
+
+// theia.vcxproj compiles for /arch:SSE2, so a 32-bit MSVC build takes the SSE path too; the
+// scalar one is only for other targets...
+#if defined(__AVX__)
+  #include <immintrin.h>
+  #define GRID_BUILDER_AVX
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+  #include <xmmintrin.h>
+  #define GRID_BUILDER_SSE
+#endif
+
+using namespace theia;
+using namespace theia::terrain;
+
+//--------------------------------------------------------------------------------
+
+// Vertices computed per pass before being interleaved into the destination. A multiple of
+// every vector width so that the last pass of a row can run over the end of it...
+static const int ChunkSize = 64;
+
+// Number of rows handed to a thread at a time...
+static const int RowsPerBand = 16;
+
+//--------------------------------------------------------------------------------
+
+// Compute ChunkSize vertices along the line base + (t * step), t = first, first+1, ...
+// and push each onto the sphere...
+static void ComputeChunk(const glm::vec3& base, const glm::vec3& step, int first, float radius, float* xs, float* ys, float* zs)
+{
+#if defined(GRID_BUILDER_AVX)
+  const __m256 bx = _mm256_set1_ps(base.x), by = _mm256_set1_ps(base.y), bz = _mm256_set1_ps(base.z);
+  const __m256 sx = _mm256_set1_ps(step.x), sy = _mm256_set1_ps(step.y), sz = _mm256_set1_ps(step.z);
+  const __m256 r = _mm256_set1_ps(radius);
+  const __m256 half = _mm256_set1_ps(0.5f);
+  const __m256 threeHalves = _mm256_set1_ps(1.5f);
+  __m256 t = _mm256_add_ps(_mm256_set1_ps((float)first), _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0));
+  const __m256 tStep = _mm256_set1_ps(8);
+
+  for (int i = 0; i < ChunkSize; i += 8)
+  {
+    const __m256 px = _mm256_add_ps(bx, _mm256_mul_ps(t, sx));
+    const __m256 py = _mm256_add_ps(by, _mm256_mul_ps(t, sy));
+    const __m256 pz = _mm256_add_ps(bz, _mm256_mul_ps(t, sz));
+    const __m256 lengthSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, px), _mm256_mul_ps(py, py)), _mm256_mul_ps(pz, pz));
+
+    // One Newton-Raphson step brings the estimate close to full float precision...
+    __m256 inv = _mm256_rsqrt_ps(lengthSq);
+    inv = _mm256_mul_ps(inv, _mm256_sub_ps(threeHalves, _mm256_mul_ps(_mm256_mul_ps(half, lengthSq), _mm256_mul_ps(inv, inv))));
+    const __m256 scale = _mm256_mul_ps(inv, r);
+
+    _mm256_storeu_ps(xs + i, _mm256_mul_ps(px, scale));
+    _mm256_storeu_ps(ys + i, _mm256_mul_ps(py, scale));
+    _mm256_storeu_ps(zs + i, _mm256_mul_ps(pz, scale));
+    t = _mm256_add_ps(t, tStep);
+  }
+#elif defined(GRID_BUILDER_SSE)
+  const __m128 bx = _mm_set1_ps(base.x), by = _mm_set1_ps(base.y), bz = _mm_set1_ps(base.z);
+  const __m128 sx = _mm_set1_ps(step.x), sy = _mm_set1_ps(step.y), sz = _mm_set1_ps(step.z);
+  const __m128 r = _mm_set1_ps(radius);
+  const __m128 half = _mm_set1_ps(0.5f);
+  const __m128 threeHalves = _mm_set1_ps(1.5f);
+  __m128 t = _mm_add_ps(_mm_set1_ps((float)first), _mm_set_ps(3, 2, 1, 0));
+  const __m128 tStep = _mm_set1_ps(4);
+
+  for (int i = 0; i < ChunkSize; i += 4)
+  {
+    const __m128 px = _mm_add_ps(bx, _mm_mul_ps(t, sx));
+    const __m128 py = _mm_add_ps(by, _mm_mul_ps(t, sy));
+    const __m128 pz = _mm_add_ps(bz, _mm_mul_ps(t, sz));
+    const __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py)), _mm_mul_ps(pz, pz));
+
+    // One Newton-Raphson step brings the estimate close to full float precision...
+    __m128 inv = _mm_rsqrt_ps(lengthSq);
+    inv = _mm_mul_ps(inv, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, lengthSq), _mm_mul_ps(inv, inv))));
+    const __m128 scale = _mm_mul_ps(inv, r);
+
+    _mm_storeu_ps(xs + i, _mm_mul_ps(px, scale));
+    _mm_storeu_ps(ys + i, _mm_mul_ps(py, scale));
+    _mm_storeu_ps(zs + i, _mm_mul_ps(pz, scale));
+    t = _mm_add_ps(t, tStep);
+  }
+#else
+  for (int i = 0; i < ChunkSize; ++i)
+  {
+    const float t = (float)(first + i);
+    const float px = base.x + (t * step.x);
+    const float py = base.y + (t * step.y);
+    const float pz = base.z + (t * step.z);
+    const float scale = radius / sqrtf((px * px) + (py * py) + (pz * pz));
+    xs[i] = px * scale;
+    ys[i] = py * scale;
+    zs[i] = pz * scale;
+  }
+#endif
+}
+
+//--------------------------------------------------------------------------------
+
+void GridBuilder::BuildRows(int face, const glm::vec2& origin, float size, int verticesPerEdge, float radius,
+                            int firstRow, int numRows, void* positions, size_t stride)
+{
+  PROFILE_SCOPE("GridBuilder::BuildRows");
+  const CubeSphere::FaceBasis& basis = CubeSphere::GetFace(face);
+  const float spacing = size / (float)(verticesPerEdge - 1);
+  const glm::vec3 step(basis.x * spacing);
+
+  float xs[ChunkSize];
+  float ys[ChunkSize];
+  float zs[ChunkSize];
+
+  for (int y = firstRow; y < (firstRow + numRows); ++y)
+  {
+    const glm::vec3 base(CubeSphere::FaceToCube(face, glm::vec2(origin.x, origin.y + ((float)y * spacing))));
+    char* row = (char*)positions + ((size_t)y * verticesPerEdge * stride);
+
+    for (int first = 0; first < verticesPerEdge; first += ChunkSize)
+    {
+      ComputeChunk(base, step, first, radius, xs, ys, zs);
+
+      const int count = ((verticesPerEdge - first) < ChunkSize) ? (verticesPerEdge - first) : ChunkSize;
+      char* out = row + ((size_t)first * stride);
+      for (int i = 0; i < count; ++i)
+      {
+        float* P = (float*)out;
+        P[0] = xs[i];
+        P[1] = ys[i];
+        P[2] = zs[i];
+        out += stride;
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+namespace
+{
+  // Builds bands of rows, numbered across all six faces in turn...
+  struct FaceRows
+  {
+    int     verticesPerEdge;
+    float   radius;
+    char*   positions;
+    size_t  stride;
+
+    void operator()(int begin, int end) const
+    {
+      const size_t faceSize = (size_t)verticesPerEdge * verticesPerEdge * stride;
+      while (begin < end)
+      {
+        const int face = begin / verticesPerEdge;
+        const int row = begin % verticesPerEdge;
+        const int numRows = ((verticesPerEdge - row) < (end - begin)) ? (verticesPerEdge - row) : (end - begin);
+        GridBuilder::BuildRows(face, glm::vec2(0), 1.0f, verticesPerEdge, radius, row, numRows, positions + (face * faceSize), stride);
+        begin += numRows;
+      }
+    }
+  };
+}
+
+void GridBuilder::BuildFaces(JobSystem* jobs, int verticesPerEdge, float radius, void* positions, size_t stride)
+{
+  PROFILE_SCOPE("GridBuilder::BuildFaces");
+  FaceRows rows;
+  rows.verticesPerEdge = verticesPerEdge;
+  rows.radius = radius;
+  rows.positions = (char*)positions;
+  rows.stride = stride;
+
+  const int numRows = CubeSphere::NumFaces * verticesPerEdge;
+  if (NULL != jobs)
+  {
+    jobs->ParallelFor(numRows, RowsPerBand, rows);
+  }
+  else
+  {
+    rows(0, numRows);
+  }
+}
@@ -0,0 +1,82 @@
+#include <math.h>
+#include <theia/terrain/cube_sphere.h>
+#include <theia/terrain/patch_culler.h>
+
+using namespace theia;
+using namespace theia::terrain;
+
+//--------------------------------------------------------------------------------
+
+static float AngleBetween(const glm::vec3& a, const glm::vec3& b)
+{
+  return acosf(glm::clamp(glm::dot(a, b), -1.0f, 1.0f));
+}
+
+//--------------------------------------------------------------------------------
+
+CullStats::CullStats()
+  : tested(0), frustumCulled(0), horizonCulled(0), drawn(0)
+{
+}
+
+//--------------------------------------------------------------------------------
+
+PatchCuller::PatchCuller(const glm::mat4& projection, const glm::vec3& eyePosition, float occluderRadius, float surfaceRadius)
+  : frustum(projection),
+    horizonAngle(-1.0f)
+{
+  // Seen from the eye, the occluder hides every point on the surface further than this angle
+  // from the eye direction: the angle to the occluder's horizon plus the angle at which a
+  // point at the surface radius can still peek over it...
+  const float eyeDistance = glm::length(eyePosition);
+  if (eyeDistance > occluderRadius)
+  {
+    eyeDirection = eyePosition / eyeDistance;
+    horizonAngle = acosf(occluderRadius / eyeDistance) + acosf(occluderRadius / surfaceRadius);
+  }
+}
+
+PatchCuller::Result PatchCuller::Test(int face, const glm::vec2& origin, float size, const glm::vec3& boundsMin, const glm::vec3& boundsMax, bool testFrustum)
+{
+  ++stats.tested;
+
+  Result result = FullyVisible;
+  if (testFrustum)
+  {
+    switch (frustum.TestBox(boundsMin, boundsMax))
+    {
+    case Frustum::Outside: ++stats.frustumCulled; return Culled;
+    case Frustum::Intersecting: result = Visible; break;
+    default: break;
+    }
+  }
+
+  if (horizonAngle >= 0)
+  {
+    // The edges of a patch are great-circle arcs, so a cone from the centre of the sphere
+    // through the patch's corners encloses all of it...
+    const glm::vec3 axis(glm::normalize(CubeSphere::FaceToCube(face, origin + glm::vec2(0.5f * size))));
+    float coneAngle = 0;
+    for (int corner = 0; corner < 4; ++corner)
+    {
+      const glm::vec2 uv(origin + (glm::vec2((float)(corner & 1), (float)(corner >> 1)) * size));
+      coneAngle = glm::max(coneAngle, AngleBetween(axis, glm::normalize(CubeSphere::FaceToCube(face, uv))));
+    }
+
+    if ((AngleBetween(axis, eyeDirection) - coneAngle) > horizonAngle)
+    {
+      ++stats.horizonCulled;
+      return Culled;
+    }
+  }
+
+  return result;
+}
+
+float PatchCuller::ComputeOccluderRadius(float radius, int quadsPerFace)
+{
+  // The largest quads subtend 2/quadsPerFace radians along an edge, and no point of either of
+  // their triangles is further than half a diagonal from a vertex on the sphere...
+  const float halfDiagonal = 1.41421356f / (float)quadsPerFace;
+  return radius * cosf(halfDiagonal);
+}
@@ -0,0 +1,65 @@
+#include <vector>
+#include <theia/graphics/mesh_optimiser.h>
+#include <theia/terrain/patch_mesh.h>
+
+using namespace theia;
+using namespace theia::terrain;
+
+//--------------------------------------------------------------------------------
+
+PatchMeshPtr PatchMesh::Create(int resolution)
+{
+  PatchMeshPtr mesh(new PatchMesh());
+  mesh->resolution = resolution;
+
+  const int verticesPerEdge = resolution + 1;
+  mesh->verticesPerPatch = verticesPerEdge * verticesPerEdge;
+
+  // Two clockwise triangles per quad. Every quad is split along the same diagonal so that
+  // collapsing the odd rows and columns onto their even neighbours leaves exactly the
+  // triangles of a grid with half the resolution...
+  std::vector<uint32_t> grid(resolution * resolution * 6);
+  {
+    int i = 0;
+    for (int y = 0; y < resolution; ++y)
+    {
+      for (int x = 0; x < resolution; ++x)
+      {
+        const uint32_t v00 = x + (y * verticesPerEdge);
+        const uint32_t v10 = v00 + 1;
+        const uint32_t v01 = v00 + verticesPerEdge;
+        const uint32_t v11 = v01 + 1;
+        grid[i++] = v00; grid[i++] = v01; grid[i++] = v10;
+        grid[i++] = v10; grid[i++] = v01; grid[i++] = v11;
+      }
+    }
+  }
+
+  // ...then reorder them for the post-transform cache, which rows of the grid don't fit in...
+  std::vector<uint32_t> optimised(grid.size());
+  MeshOptimiser::OptimiseTriangleList(grid.data(), grid.size(), mesh->verticesPerPatch, MeshOptimiser::DefaultCacheSize, optimised.data());
+
+  std::vector<unsigned short> indices(optimised.begin(), optimised.end());
+  mesh->numIndices = (GLsizei)indices.size();
+
+  mesh->indices = IndexBuffer::Create(indices.size() * sizeof(unsigned short));
+  mesh->indices->SetData(indices.size() * sizeof(unsigned short), 0, indices.data());
+
+  glBindVertexArray(mesh->vao);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indices->buffer);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  return mesh;
+}
+
+PatchMesh::PatchMesh()
+  : resolution(0), numIndices(0), verticesPerPatch(0)
+{
+  glGenVertexArrays(1, &vao);
+}
+
+PatchMesh::~PatchMesh()
+{
+  glDeleteVertexArrays(1, &vao);
+}
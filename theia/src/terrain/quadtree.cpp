@@ -0,0 +1,146 @@
+#include <math.h>
+#include <theia/terrain/cube_sphere.h>
+#include <theia/terrain/patch_culler.h>
+#include <theia/terrain/quadtree.h>
+
+using namespace theia::terrain;
+
+//--------------------------------------------------------------------------------
+
+static const float Pi = 3.14159265f;
+
+// Morph range given to root patches: they have no parent to morph onto so vertices must never move...
+static const float NoMorphStart = 1.0e30f;
+static const float NoMorphEnd = 2.0e30f;
+
+struct SelectContext
+{
+  const QuadtreeSettings* settings;
+  glm::vec3 eye;
+  float lodScale;
+  std::vector<Patch>* patches;
+  PatchCuller* culler;
+};
+
+static float SplitDistance(const SelectContext& ctx, int level);
+static float DistanceToBox(const glm::vec3& P, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+static void SelectNode(const SelectContext& ctx, int face, int level, const glm::vec2& origin, float size, bool testFrustum);
+
+//--------------------------------------------------------------------------------
+
+QuadtreeSettings::QuadtreeSettings()
+  : radius(1.0f),
+    patchResolution(32),
+    maxLevel(16),
+    maxScreenSpaceError(4.0f),
+    morphRatio(0.3f)
+{
+}
+
+//--------------------------------------------------------------------------------
+
+Quadtree::Quadtree(const QuadtreeSettings& settings)
+  : settings(settings)
+{
+}
+
+float Quadtree::ComputeLODScale(float viewportHeight, float fovY)
+{
+  const float halfAngle = 0.5f * fovY * (Pi / 180.0f);
+  return viewportHeight / (2.0f * tanf(halfAngle));
+}
+
+void Quadtree::Select(const glm::vec3& eyePosition, float lodScale, std::vector<Patch>& patches, PatchCuller* culler) const
+{
+  patches.clear();
+  for (int face = 0; face < CubeSphere::NumFaces; ++face)
+  {
+    SelectFace(face, eyePosition, lodScale, patches, culler);
+  }
+}
+
+void Quadtree::SelectFace(int face, const glm::vec3& eyePosition, float lodScale, std::vector<Patch>& patches, PatchCuller* culler) const
+{
+  SelectContext ctx;
+  ctx.settings = &settings;
+  ctx.eye = eyePosition;
+  ctx.lodScale = lodScale;
+  ctx.patches = &patches;
+  ctx.culler = culler;
+
+  SelectNode(ctx, face, 0, glm::vec2(0), 1.0f, true);
+}
+
+//--------------------------------------------------------------------------------
+
+// The distance below which a patch at the given level projects its quads larger than the
+// allowed screen-space error and must be split.
+static float SplitDistance(const SelectContext& ctx, int level)
+{
+  // The quads at the centre of a face are the largest, and a face coordinate subtends 2 radians
+  // per unit there, so this is the largest arc length of one quad...
+  const float quadSize = (2.0f * ctx.settings->radius) / ((float)(1 << level) * (float)ctx.settings->patchResolution);
+  return (quadSize * ctx.lodScale) / ctx.settings->maxScreenSpaceError;
+}
+
+//--------------------------------------------------------------------------------
+
+static float DistanceToBox(const glm::vec3& P, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+  const glm::vec3 closest(glm::clamp(P.x, boundsMin.x, boundsMax.x),
+                          glm::clamp(P.y, boundsMin.y, boundsMax.y),
+                          glm::clamp(P.z, boundsMin.z, boundsMax.z));
+  return glm::distance(P, closest);
+}
+
+//--------------------------------------------------------------------------------
+
+static void SelectNode(const SelectContext& ctx, int face, int level, const glm::vec2& origin, float size, bool testFrustum)
+{
+  glm::vec3 boundsMin;
+  glm::vec3 boundsMax;
+  CubeSphere::ComputeBounds(face, origin, size, ctx.settings->radius, boundsMin, boundsMax);
+
+  if (ctx.culler)
+  {
+    const PatchCuller::Result visibility = ctx.culler->Test(face, origin, size, boundsMin, boundsMax, testFrustum);
+    if (PatchCuller::Culled == visibility)
+    {
+      return;
+    }
+    testFrustum = (PatchCuller::FullyVisible != visibility);
+  }
+
+  const float splitDistance = SplitDistance(ctx, level);
+  if ((level < ctx.settings->maxLevel) && (DistanceToBox(ctx.eye, boundsMin, boundsMax) < splitDistance))
+  {
+    const float halfSize = 0.5f * size;
+    SelectNode(ctx, face, level + 1, origin, halfSize, testFrustum);
+    SelectNode(ctx, face, level + 1, origin + glm::vec2(halfSize, 0), halfSize, testFrustum);
+    SelectNode(ctx, face, level + 1, origin + glm::vec2(0, halfSize), halfSize, testFrustum);
+    SelectNode(ctx, face, level + 1, origin + glm::vec2(halfSize, halfSize), halfSize, testFrustum);
+    return;
+  }
+
+  Patch patch;
+  patch.face = face;
+  patch.level = level;
+  patch.origin = origin;
+  patch.size = size;
+  patch.boundsMin = boundsMin;
+  patch.boundsMax = boundsMax;
+  if (0 == level)
+  {
+    patch.morphRange = glm::vec2(NoMorphStart, NoMorphEnd);
+  }
+  else
+  {
+    // Vertices have fully collapsed onto the parent's grid by the time the eye is far
+    // enough away for the parent to have been selected instead of this patch...
+    const float morphEnd = SplitDistance(ctx, level - 1);
+    const float morphStart = morphEnd - (ctx.settings->morphRatio * (morphEnd - splitDistance));
+    patch.morphRange = glm::vec2(morphStart, morphEnd);
+  }
+  ctx.patches->push_back(patch);
+  if (ctx.culler) { ++ctx.culler->stats.drawn; }
+}
@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <boost/chrono.hpp>
+#include <theia/misc/profiler.h>
+#include <theia/terrain/cube_sphere.h>
+#include <theia/terrain/quadtree.h>
+#include <theia/terrain/tile_cache.h>
+#include <theia/terrain/tile_store.h>
+
+using namespace theia;
+using namespace theia::terrain;
+
+//--------------------------------------------------------------------------------
+
+TileKey TileKey::FromPatch(const Patch& patch)
+{
+  TileKey key;
+  key.face = patch.face;
+  key.level = patch.level;
+  key.x = (int)((patch.origin.x / patch.size) + 0.5f);
+  key.y = (int)((patch.origin.y / patch.size) + 0.5f);
+  return key;
+}
+
+TileKey TileKey::Parent() const
+{
+  TileKey parent;
+  parent.face = face;
+  parent.level = level - 1;
+  parent.x = x >> 1;
+  parent.y = y >> 1;
+  return parent;
+}
+
+bool TileKey::operator<(const TileKey& other) const
+{
+  if (face != other.face) { return face < other.face; }
+  if (level != other.level) { return level < other.level; }
+  if (y != other.y) { return y < other.y; }
+  return x < other.x;
+}
+
+//--------------------------------------------------------------------------------
+
+TileCacheSettings::TileCacheSettings()
+  : tileSize(64),
+    capacity(256),
+    numWorkers(0),
+    maxUploadBytesPerFrame(256 * 1024),
+    maxUploadMilliseconds(2.0f)
+{
+}
+
+TileCacheStats::TileCacheStats()
+  : hits(0), fallbacks(0), requests(0), uploads(0), evictions(0), overflows(0)
+{
+}
+
+//--------------------------------------------------------------------------------
+
+TileCachePtr TileCache::Create(const TileCacheSettings& settings, const TileStorePtr& store)
+{
+  TileCachePtr cache(new TileCache());
+  cache->settings = settings;
+  cache->store = store;
+  cache->texture = TextureArray::Create(settings.tileSize, settings.tileSize, settings.capacity, GL_RG16F);
+
+  for (int layer = settings.capacity - 1; layer >= 0; --layer)
+  {
+    cache->freeLayers.push_back(layer);
+  }
+
+  // Leave a hardware thread for rendering...
+  int numWorkers = settings.numWorkers;
+  if (numWorkers <= 0)
+  {
+    numWorkers = std::max(1, (int)boost::thread::hardware_concurrency() - 1);
+  }
+  for (int i = 0; i < numWorkers; ++i)
+  {
+    cache->workers.push_back(new boost::thread(&TileCache::WorkerMain, cache.get()));
+  }
+
+  return cache;
+}
+
+TileCache::TileCache()
+  : frame(1), quit(false)
+{
+}
+
+TileCache::~TileCache()
+{
+  {
+    boost::mutex::scoped_lock lock(mutex);
+    quit = true;
+  }
+  requestReady.notify_all();
+
+  for (size_t i = 0; i < workers.size(); ++i)
+  {
+    workers[i]->join();
+    delete workers[i];
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+void TileCache::BeginFrame()
+{
+  ++frame;
+  stats = TileCacheStats();
+
+  typedef boost::chrono::steady_clock Clock;
+  const Clock::time_point start = Clock::now();
+  const size_t tileBytes = settings.tileSize * settings.tileSize * sizeof(glm::vec2);
+  size_t uploadedBytes = 0;
+
+  for (;;)
+  {
+    // Always make some progress, however small the budget...
+    if (uploadedBytes > 0)
+    {
+      const float elapsed = boost::chrono::duration<float, boost::milli>(Clock::now() - start).count();
+      if (((uploadedBytes + tileBytes) > settings.maxUploadBytesPerFrame) || (elapsed >= settings.maxUploadMilliseconds))
+      {
+        break;
+      }
+    }
+
+    BakedTilePtr tile;
+    {
+      boost::mutex::scoped_lock lock(mutex);
+      if (baked.empty()) { break; }
+      tile = baked.front();
+      baked.pop_front();
+    }
+
+    Upload(*tile);
+    uploadedBytes += tileBytes;
+
+    boost::mutex::scoped_lock lock(mutex);
+    outstanding.erase(tile->key);
+  }
+}
+
+TileRef TileCache::Acquire(const Patch& patch, float priority)
+{
+  const TileKey key(TileKey::FromPatch(patch));
+
+  TileRef ref;
+  ref.offset = glm::vec2(0);
+  ref.scale = 1.0f;
+  if (Touch(key, ref.layer))
+  {
+    ++stats.hits;
+    return ref;
+  }
+
+  Request request;
+  request.key = key;
+  request.priority = priority;
+  frameRequests.push_back(request);
+
+  // Use the part of the nearest resident ancestor's tile which covers the patch...
+  TileKey ancestor(key);
+  while (ancestor.level > 0)
+  {
+    ancestor = ancestor.Parent();
+    if (Touch(ancestor, ref.layer))
+    {
+      const int levels = key.level - ancestor.level;
+      ref.scale = 1.0f / (float)(1 << levels);
+      ref.offset = glm::vec2((float)(key.x - (ancestor.x << levels)), (float)(key.y - (ancestor.y << levels))) * ref.scale;
+      ++stats.fallbacks;
+      return ref;
+    }
+  }
+
+  ref.layer = -1;
+  return ref;
+}
+
+void TileCache::EndFrame()
+{
+  {
+    boost::mutex::scoped_lock lock(mutex);
+
+    for (size_t i = 0; i < queue.size(); ++i)
+    {
+      outstanding.erase(queue[i].key);
+    }
+    queue.clear();
+
+    for (size_t i = 0; i < frameRequests.size(); ++i)
+    {
+      if (outstanding.insert(frameRequests[i].key).second)
+      {
+        queue.push_back(frameRequests[i]);
+        ++stats.requests;
+      }
+    }
+    std::make_heap(queue.begin(), queue.end());
+  }
+  frameRequests.clear();
+
+  requestReady.notify_all();
+}
+
+//--------------------------------------------------------------------------------
+
+// Mark a tile as drawn this frame and get its layer, if it's resident...
+bool TileCache::Touch(const TileKey& key, int& layer)
+{
+  std::map<TileKey, Entry>::iterator it = entries.find(key);
+  if (entries.end() == it)
+  {
+    return false;
+  }
+
+  it->second.lastUsed = frame;
+  lru.splice(lru.begin(), lru, it->second.lru);
+  layer = it->second.layer;
+  return true;
+}
+
+// Find a layer for a new tile: an unused one, or else the least recently drawn tile's as long
+// as it wasn't drawn last frame...
+int TileCache::AllocateLayer()
+{
+  if (!freeLayers.empty())
+  {
+    const int layer = freeLayers.back();
+    freeLayers.pop_back();
+    return layer;
+  }
+
+  std::map<TileKey, Entry>::iterator oldest = entries.find(lru.back());
+  if ((oldest->second.lastUsed + 1) >= frame)
+  {
+    return -1;
+  }
+
+  const int layer = oldest->second.layer;
+  entries.erase(oldest);
+  lru.pop_back();
+  ++stats.evictions;
+  return layer;
+}
+
+void TileCache::Upload(const BakedTile& tile)
+{
+  if (entries.end() != entries.find(tile.key))
+  {
+    return;
+  }
+
+  const int layer = AllocateLayer();
+  if (layer < 0)
+  {
+    // It will be requested again if it's still wanted once there's room...
+    ++stats.overflows;
+    return;
+  }
+
+  texture->SetLayer(layer, GL_RG, GL_FLOAT, tile.texels.data());
+  ++stats.uploads;
+
+  lru.push_front(tile.key);
+  Entry entry;
+  entry.layer = layer;
+  entry.lastUsed = 0;
+  entry.lru = lru.begin();
+  entries.insert(std::make_pair(tile.key, entry));
+}
+
+//--------------------------------------------------------------------------------
+
+void TileCache::WorkerMain()
+{
+  Profiler::SetThreadName("tile baker");
+  for (;;)
+  {
+    BakedTilePtr tile(new BakedTile());
+    {
+      boost::mutex::scoped_lock lock(mutex);
+      while (!quit && queue.empty())
+      {
+        requestReady.wait(lock);
+      }
+      if (quit) { return; }
+
+      std::pop_heap(queue.begin(), queue.end());
+      tile->key = queue.back().key;
+      queue.pop_back();
+    }
+
+    Bake(*tile);
+
+    boost::mutex::scoped_lock lock(mutex);
+    baked.push_back(tile);
+  }
+}
+
+void TileCache::Bake(BakedTile& tile) const
+{
+  PROFILE_SCOPE("TileCache::Bake");
+  const TileKey& key = tile.key;
+  if (store && store->Read(key, tile.texels))
+  {
+    return;
+  }
+
+  const float size = 1.0f / (float)(1 << key.level);
+  const glm::vec2 origin((float)key.x * size, (float)key.y * size);
+  const float spacing = size / (float)(settings.tileSize - 1);
+
+  std::vector<glm::vec3> points(settings.tileSize * settings.tileSize);
+  size_t i = 0;
+  for (int y = 0; y < settings.tileSize; ++y)
+  {
+    for (int x = 0; x < settings.tileSize; ++x)
+    {
+      points[i++] = CubeSphere::FaceToSphere(key.face, origin + (glm::vec2((float)x, (float)y) * spacing), 1.0f);
+    }
+  }
+
+  std::vector<float> heights(points.size());
+  Noise::fBm(NULL, points.data(), points.size(), settings.noise, heights.data());
+
+  tile.texels.resize(heights.size());
+  for (i = 0; i < heights.size(); ++i)
+  {
+    tile.texels[i] = glm::vec2(heights[i], (heights[i] <= 0.0f) ? 1.0f : 0.0f);
+  }
+
+  if (store)
+  {
+    store->Write(key, tile.texels);
+  }
+}
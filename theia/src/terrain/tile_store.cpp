@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <string.h>
+#include <boost/interprocess/exceptions.hpp>
+#include <theia/misc/debug.h>
+#include <theia/terrain/tile_store.h>
+
+using namespace theia;
+using namespace theia::terrain;
+
+//--------------------------------------------------------------------------------
+
+static const char Magic[4] = { 'T', 'H', 'T', 'S' };
+
+// Slots start on a page boundary...
+static const size_t SlotAlignment = 4096;
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static uint32_t HashBytes(uint32_t hash, const void* data, size_t sizeInBytes)
+{
+  // FNV-1a...
+  const unsigned char* bytes = (const unsigned char*)data;
+  for (size_t i = 0; i < sizeInBytes; ++i)
+  {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+// Write a new, empty store of the given size...
+static bool CreateStoreFile(const std::string& path, const TileStore::FileHeader& header, size_t fileSize)
+{
+  FILE* file = fopen(path.c_str(), "wb");
+  if (NULL == file)
+  {
+    LOG("unable to create tile store %s\n", path.c_str());
+    return false;
+  }
+
+  bool ok = (1 == fwrite(&header, sizeof(header), 1, file));
+
+  TileStore::IndexEntry unused;
+  unused.face = 0;
+  unused.level = -1;
+  unused.x = 0;
+  unused.y = 0;
+  for (uint32_t i = 0; ok && (i < header.capacity); ++i)
+  {
+    ok = (1 == fwrite(&unused, sizeof(unused), 1, file));
+  }
+
+  // Extend the file to its full size without writing the slots...
+  const char zero = 0;
+  ok = ok && (0 == fseek(file, (long)(fileSize - 1), SEEK_SET)) && (1 == fwrite(&zero, 1, 1, file));
+  fclose(file);
+
+  if (!ok)
+  {
+    LOG("unable to write tile store %s\n", path.c_str());
+  }
+  return ok;
+}
+
+//--------------------------------------------------------------------------------
+
+uint32_t TileStore::ComputeHash(int tileSize, const Noise::FractalSettings& noise)
+{
+  const uint32_t version = Version;
+  uint32_t hash = 2166136261u;
+  hash = HashBytes(hash, &version, sizeof(version));
+  hash = HashBytes(hash, &tileSize, sizeof(tileSize));
+  hash = HashBytes(hash, &noise.octaves, sizeof(noise.octaves));
+  hash = HashBytes(hash, &noise.lacunarity, sizeof(noise.lacunarity));
+  hash = HashBytes(hash, &noise.gain, sizeof(noise.gain));
+  return hash;
+}
+
+TileStorePtr TileStore::Open(const std::string& directory, int tileSize, const Noise::FractalSettings& noise, int capacity)
+{
+  FileHeader expected;
+  memcpy(expected.magic, Magic, sizeof(Magic));
+  expected.version = Version;
+  expected.tileSize = tileSize;
+  expected.hash = ComputeHash(tileSize, noise);
+  expected.capacity = capacity;
+
+  char name[32];
+  sprintf(name, "terrain_%08x.tiles", expected.hash);
+  const std::string path(directory + "/" + name);
+
+  // Reuse the file if it was written with the same layout and is as long as its header says
+  // (a run which died while creating it can leave it short, and mapping past the end of a
+  // file faults), otherwise start again...
+  const size_t slotSizeInBytes = tileSize * tileSize * sizeof(glm::vec2);
+  bool reuse = false;
+  FILE* existing = fopen(path.c_str(), "rb");
+  if (NULL != existing)
+  {
+    FileHeader header;
+    if ((1 == fread(&header, sizeof(header), 1, existing)) &&
+        (0 == memcmp(header.magic, Magic, sizeof(Magic))) &&
+        (header.version == Version) && (header.tileSize == expected.tileSize) && (header.hash == expected.hash))
+    {
+      const size_t headerSlotsOffset = AlignUp(sizeof(FileHeader) + (header.capacity * sizeof(IndexEntry)), SlotAlignment);
+      const size_t headerFileSize = headerSlotsOffset + (header.capacity * slotSizeInBytes);
+      const long actualSize = (0 == fseek(existing, 0, SEEK_END)) ? ftell(existing) : -1;
+      if ((actualSize >= 0) && ((size_t)actualSize >= headerFileSize))
+      {
+        expected.capacity = header.capacity;
+        reuse = true;
+      }
+      else
+      {
+        LOG("tile store %s is shorter than its header says, creating it again\n", path.c_str());
+      }
+    }
+    fclose(existing);
+  }
+
+  const size_t slotsOffset = AlignUp(sizeof(FileHeader) + (expected.capacity * sizeof(IndexEntry)), SlotAlignment);
+  const size_t fileSize = slotsOffset + (expected.capacity * slotSizeInBytes);
+
+  if (!reuse && !CreateStoreFile(path, expected, fileSize))
+  {
+    return TileStorePtr();
+  }
+
+  TileStorePtr store(new TileStore());
+  store->path = path;
+  store->slotSizeInBytes = slotSizeInBytes;
+  try
+  {
+    boost::interprocess::file_mapping file(path.c_str(), boost::interprocess::read_write);
+    boost::interprocess::mapped_region region(file, boost::interprocess::read_write, 0, fileSize);
+    store->file.swap(file);
+    store->region.swap(region);
+  }
+  catch (const boost::interprocess::interprocess_exception& e)
+  {
+    LOG("unable to map tile store %s: %s\n", path.c_str(), e.what());
+    return TileStorePtr();
+  }
+
+  char* base = (char*)store->region.get_address();
+  store->header = (FileHeader*)base;
+  store->index = (IndexEntry*)(base + sizeof(FileHeader));
+  store->slots = base + slotsOffset;
+
+  // Slots are filled in order, so the first unused one marks the end...
+  for (uint32_t i = 0; i < store->header->capacity; ++i)
+  {
+    const IndexEntry& entry = store->index[i];
+    if (entry.level < 0)
+    {
+      break;
+    }
+
+    TileKey key;
+    key.face = entry.face;
+    key.level = entry.level;
+    key.x = entry.x;
+    key.y = entry.y;
+    store->slotOf[key] = (int)i;
+    store->nextSlot = (int)i + 1;
+  }
+
+  LOG("tile store %s: %d of %u tiles\n", path.c_str(), store->nextSlot, store->header->capacity);
+  return store;
+}
+
+TileStore::TileStore()
+  : header(NULL), index(NULL), slots(NULL), slotSizeInBytes(0), nextSlot(0)
+{
+}
+
+TileStore::~TileStore()
+{
+  if (NULL != header)
+  {
+    region.flush();
+  }
+}
+
+bool TileStore::Read(const TileKey& key, std::vector<glm::vec2>& texels) const
+{
+  boost::mutex::scoped_lock lock(mutex);
+
+  std::map<TileKey, int>::const_iterator it = slotOf.find(key);
+  if (slotOf.end() == it)
+  {
+    return false;
+  }
+
+  texels.resize(slotSizeInBytes / sizeof(glm::vec2));
+  memcpy(texels.data(), slots + (it->second * slotSizeInBytes), slotSizeInBytes);
+  return true;
+}
+
+bool TileStore::Write(const TileKey& key, const std::vector<glm::vec2>& texels)
+{
+  boost::mutex::scoped_lock lock(mutex);
+
+  if (slotOf.end() != slotOf.find(key))
+  {
+    return true;
+  }
+  if ((uint32_t)nextSlot >= header->capacity)
+  {
+    return false;
+  }
+
+  // Fill the slot and wait for it to reach the disk before writing its index entry, so that
+  // an entry which survives a crash always has its texels. Without the wait the OS could
+  // write the index page back first...
+  const int slot = nextSlot;
+  char* slotAddress = slots + (slot * slotSizeInBytes);
+  memcpy(slotAddress, texels.data(), slotSizeInBytes);
+
+  // msync wants the range to start on a page. The mapping starts on one, at the beginning
+  // of the file...
+  const size_t slotOffset = slotAddress - (char*)region.get_address();
+  const size_t flushOffset = slotOffset - (slotOffset % boost::interprocess::mapped_region::get_page_size());
+  if (!region.flush(flushOffset, (slotOffset - flushOffset) + slotSizeInBytes, false))
+  {
+    LOG("unable to flush tile store slot %d\n", slot);
+    return false;
+  }
+  ++nextSlot;
+
+  IndexEntry& entry = index[slot];
+  entry.face = key.face;
+  entry.x = key.x;
+  entry.y = key.y;
+  entry.level = key.level;
+
+  slotOf[key] = slot;
+  return true;
+}
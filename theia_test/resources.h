@@ -7,3 +7,10 @@
 #define IDR_TEST_VS       102
 #define IDR_TEST_FS       103
 #define IDR_SHADER_COMMON 104
+#define IDR_PATCH_VS      105
+#define IDR_PATCH_FS      106
+#define IDR_GRID_CS       107
+#define IDR_TESS_VS       108
+#define IDR_TESS_TCS      109
+#define IDR_TESS_TES      110
+#define IDR_DEPTH_FS      111
@@ -3,8 +3,9 @@
 // by vertex and fragment shaders.
 //
 // This file will be first in the compilation chain, so it must have a
-// #version line (any #version in the vertex or fragment shader source
-// will be disabled).
+// #version line. A stage whose source begins with its own #version
+// (compute and tessellation stages need a later one) replaces it: the
+// stage's line is moved in front and the one below is commented out.
 #version 330
 
 // Useful constants...
@@ -42,6 +43,61 @@ vec2 EllipsoidTextureCoord(vec3 normal)
 	return vec2(u,v) + vec2(0.5);
 }
 
+//-----------------------------------------------------------------------------------
+// Decoding of the compact vertex formats in theia/graphics/vertex_layout.h. Half floats
+// and normalized integers (unorm8 colours, unorm16 coordinates) are converted by the vertex
+// fetch and need nothing more.
+
+float SignNotZero(float x)
+{
+	return (x >= 0.0) ? 1.0 : -1.0;
+}
+
+// Fold a unit vector onto the octahedron and unfold it into [-1,1]^2...
+vec2 OctahedralEncode(vec3 n)
+{
+	vec2 e = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+	if (n.z < 0.0)
+	{
+		e = vec2((1.0 - abs(e.y)) * SignNotZero(e.x), (1.0 - abs(e.x)) * SignNotZero(e.y));
+	}
+	return e;
+}
+
+// ...and back, e.g. from an snorm16x2 attribute.
+vec3 DecodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0)
+	{
+		n.xy = vec2((1.0 - abs(n.y)) * SignNotZero(n.x), (1.0 - abs(n.x)) * SignNotZero(n.y));
+	}
+	return normalize(n);
+}
+
+// A unorm16 position within a patch's bounding box...
+vec3 DecodePatchPosition(vec3 position, vec3 origin, vec3 extent)
+{
+	return origin + (position * extent);
+}
+
+//-----------------------------------------------------------------------------------
+// Tangent basis of each cube face. The normal of a face is cross(x, y).
+// These must match the table in theia::terrain::CubeSphere.
+const vec3 CubeFaceX[6] = vec3[6](
+	vec3(1,0,0), vec3(0,0,-1), vec3(-1,0,0), vec3(0,0,1), vec3(1,0,0), vec3(1,0,0));
+const vec3 CubeFaceY[6] = vec3[6](
+	vec3(0,1,0), vec3(0,1,0),  vec3(0,1,0),  vec3(0,1,0), vec3(0,0,-1), vec3(0,0,1));
+
+// Map a face coordinate in [0,1] onto the unit sphere.
+vec3 CubeFaceToSphere(int face, vec2 uv)
+{
+	vec3 X = CubeFaceX[face];
+	vec3 Y = CubeFaceY[face];
+	vec3 P = ((uv.x - 0.5) * X) + ((uv.y - 0.5) * Y) + (0.5 * cross(X, Y));
+	return normalize(P);
+}
+
 //-----------------------------------------------------------------------------------
 //
 // Description : Array and textureless GLSL 2D simplex noise function.
@@ -213,3 +269,126 @@ float snoise(vec3 v)
   return 42.0 * dot( m*m, vec4( dot(p0,x0), dot(p1,x1), 
                                 dot(p2,x2), dot(p3,x3) ) );
   }
+
+//-----------------------------------------------------------------------------------
+// Return a value fractal Brownian motion value for point P.
+// "lacunarity" controls frequency over each octave.
+// "gain" controls amplitude over each octave.
+float fBm(vec2 P, float octaves, float lacunarity, float gain)
+{
+  float frequency = 1;
+  float amplitude = 0.5;
+  float sum = 0;
+  for (int i = 0; i < octaves; i++)
+  {
+    sum += snoise(P * frequency) * amplitude;
+    frequency *= lacunarity;
+    amplitude *= gain;
+  }
+  return sum;
+}
+float fBm(vec3 P, float octaves, float lacunarity, float gain)
+{
+  float frequency = 1;
+  float amplitude = 0.5;
+  float sum = 0;
+  for (int i = 0; i < octaves; i++)
+  {
+    sum += snoise(P * frequency) * amplitude;
+    frequency *= lacunarity;
+    amplitude *= gain;
+  }
+  return sum;
+}
+
+// Similar to fBm but uses the sum of abs(noise).
+float Turbulence(vec2 P, float octaves, float lacunarity, float gain)
+{
+  float frequency = 1;
+  float amplitude = 0.5;
+  float sum = 0;
+  for (int i = 0; i < octaves; i++)
+  {
+    sum += abs(snoise(P * frequency)) * amplitude;
+    frequency *= lacunarity;
+    amplitude *= gain;
+  }
+  return sum;
+}
+
+float GetHeightAt(vec3 P)
+{
+  const float lacunarity = 3.5;
+  const float octaves = 7;
+  const float gain = 0.5123;
+  float height = fBm(P, octaves, lacunarity, gain);
+  return height;
+}
+
+//-----------------------------------------------------------------------------------
+// Band-limited fractals.
+//
+// A fragment which covers a large part of the surface can't show octaves whose detail is
+// smaller than itself: they only alias, so there's no point paying for them. Procedural
+// functions take a "filter width", the size of the fragment's footprint in the units of the
+// function's input, and drop the octaves finer than it. The last octave kept is faded out
+// rather than cut off so that there's no pop as the width changes.
+
+// The filter width of a position in a fragment shader. (A macro so that common.glsl still
+// compiles into vertex shaders, where derivatives don't exist.)
+#define FILTER_WIDTH(P) max(length(dFdx(P)), length(dFdy(P)))
+
+// The number of octaves (with a fractional part for the fading one) whose detail is coarser
+// than the filter width. Octave i has a frequency of lacunarity^i, and detail is lost once
+// a fragment spans more than half of its wavelength.
+float FractalOctaves(float filterWidth, float octaves, float lacunarity)
+{
+  float visible = (log2(0.5 / max(filterWidth, 1.0e-8)) / log2(lacunarity)) + 1.0;
+  return clamp(visible, 0.0, octaves);
+}
+
+// As fBm, but with only the octaves visible at the filter width...
+float fBm(vec3 P, float filterWidth, float octaves, float lacunarity, float gain)
+{
+  float visible = FractalOctaves(filterWidth, octaves, lacunarity);
+  float frequency = 1;
+  float amplitude = 0.5;
+  float sum = 0;
+  for (int i = 0; i < visible; i++)
+  {
+    float fade = clamp(visible - float(i), 0.0, 1.0);
+    sum += snoise(P * frequency) * amplitude * fade;
+    frequency *= lacunarity;
+    amplitude *= gain;
+  }
+  return sum;
+}
+
+float GetHeightAt(vec3 P, float filterWidth)
+{
+  const float lacunarity = 3.5;
+  const float octaves = 7;
+  const float gain = 0.5123;
+  float height = fBm(P, filterWidth, octaves, lacunarity, gain);
+  return height;
+}
+
+//-----------------------------------------------------------------------------------
+// Lighting calculation for a world-space position P and normal N.
+vec3 ComputeLight(vec3 P, vec3 N, MaterialStruct material)
+{
+	vec3 emittedLight = material.Ke;
+	vec3 ambientLight = material.Ka * AmbientLight;
+
+	// Assume that the sun is always at the origin...
+	vec3 L = normalize(-P);
+	float NdotL = dot(L,N);
+	float diffuseAmount = max(NdotL, 0);
+	vec3 diffuseLight = material.Kd * diffuseAmount; // sunlight colour is assumed to be == 1.0
+
+	return emittedLight + ambientLight + diffuseLight;
+}
+
+// Diffuse colours of the terrain...
+const vec3 land = vec3(0,1,0);
+const vec3 sea = vec3(0,0,1);
@@ -0,0 +1,7 @@
+
+// The fragment stage of the position-only programs used by the depth pre-pass. Colour
+// writes are off, so there is nothing to compute.
+
+void main()
+{
+}
@@ -0,0 +1,71 @@
+#version 430
+
+// Writes a grid of vertices over a square region of one or more cube faces onto the sphere,
+// straight into a vertex buffer bound as a shader storage block. This replaces the
+// #version line of common.glsl, so must stay the first line.
+//
+// Invocation (x, y, z) builds vertex (x, y) of face (FirstFace + z). Faces follow one after
+// another, each (VerticesPerEdge * VerticesPerEdge) vertices long.
+
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// Written as raw 32-bit words so that floats and packed values can share a vertex...
+layout (std430, binding = 0) writeonly buffer Vertices
+{
+	uint vertexData[];
+};
+
+uniform int		FirstFace;
+uniform vec2	GridOrigin;			// face coordinate of the grid's (0,0) corner
+uniform float	GridSize;			// extent of the grid in face coordinates
+uniform int		VerticesPerEdge;
+uniform float	Radius;				// radius of the sphere
+
+// The vertex layout, all counted in 32-bit words...
+uniform int		FirstValue;			// where the first vertex starts in the buffer
+uniform int		VertexStride;
+uniform int		PositionOffset;		// -1 to leave out positions
+uniform int		DirectionOffset;	// -1 to leave out octahedral snorm16x2 directions
+uniform int		NormalOffset;		// -1 to leave out normals
+uniform int		HeightOffset;		// -1 to leave out terrain heights
+
+void main()
+{
+	ivec2 vertex = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(vertex, ivec2(VerticesPerEdge))))
+	{
+		return;
+	}
+
+	int face = FirstFace + int(gl_GlobalInvocationID.z);
+	vec2 uv = GridOrigin + (vec2(vertex) * (GridSize / float(VerticesPerEdge - 1)));
+	vec3 N = CubeFaceToSphere(face, uv);
+
+	int index = (int(gl_GlobalInvocationID.z) * VerticesPerEdge * VerticesPerEdge) + (vertex.y * VerticesPerEdge) + vertex.x;
+	int base = FirstValue + (index * VertexStride);
+
+	if (PositionOffset >= 0)
+	{
+		vec3 P = N * Radius;
+		vertexData[base + PositionOffset + 0] = floatBitsToUint(P.x);
+		vertexData[base + PositionOffset + 1] = floatBitsToUint(P.y);
+		vertexData[base + PositionOffset + 2] = floatBitsToUint(P.z);
+	}
+
+	if (DirectionOffset >= 0)
+	{
+		vertexData[base + DirectionOffset] = packSnorm2x16(OctahedralEncode(N));
+	}
+
+	if (NormalOffset >= 0)
+	{
+		vertexData[base + NormalOffset + 0] = floatBitsToUint(N.x);
+		vertexData[base + NormalOffset + 1] = floatBitsToUint(N.y);
+		vertexData[base + NormalOffset + 2] = floatBitsToUint(N.z);
+	}
+
+	if (HeightOffset >= 0)
+	{
+		vertexData[base + HeightOffset] = floatBitsToUint(GetHeightAt(N));
+	}
+}
@@ -0,0 +1,35 @@
+uniform MaterialStruct Material;
+
+// Baked terrain tiles: red is the height, green is 1 on land and 0 at sea...
+uniform sampler2DArray HeightTiles;
+
+in vec3 vertexSurfaceNormal;
+in vec3 vertexWorldPos;		// vertex world space position
+in vec3 vertexSurfacePos;	// vertex object space coordinate
+in vec2 vertexTileCoord;
+flat in float vertexTileLayer;
+
+out vec4 fragColour;
+
+void main()
+{
+	MaterialStruct material = Material;
+
+	// Look the terrain up in the patch's tile, falling back on evaluating it when the tile
+	// cache had no room for it this frame...
+	float isLand;
+	if (vertexTileLayer >= 0)
+	{
+		isLand = texture(HeightTiles, vec3(vertexTileCoord, vertexTileLayer)).g;
+	}
+	else
+	{
+		vec3 objectNormal = normalize(vertexSurfacePos);
+		isLand = float(GetHeightAt(objectNormal, FILTER_WIDTH(objectNormal)) <= 0);
+	}
+	material.Kd = mix(sea, land, isLand);
+
+	vec3 N = normalize(vertexSurfaceNormal);
+	fragColour.rgb = ComputeLight(vertexWorldPos, N, material);
+	fragColour.a = 1.0f;
+}
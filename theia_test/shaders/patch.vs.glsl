@@ -0,0 +1,83 @@
+
+// Places one copy of the shared patch grid onto the sphere.
+// The grid is morphed towards the grid of the parent patch as the eye moves away, so that
+// the patch matches its parent exactly at the distance where the quadtree swaps them.
+//
+// Every patch is drawn by one multi-draw call with no vertex attributes. Patch n is drawn
+// with a base vertex of (n * vertices per patch), so gl_VertexID gives both the patch and
+// the vertex within its grid.
+
+// Three texels per patch:
+//   [0] = (origin.x, origin.y, size, face)
+//   [1] = (morph start, morph end, level, 0)
+//   [2] = (tile offset.x, tile offset.y, tile scale, tile layer or -1 if no tile covers the patch yet)
+// A patch whose own tile is still being baked is given the part of an ancestor's tile
+// which covers it.
+uniform samplerBuffer PatchData;
+
+uniform float	PatchResolution;	// number of quads along an edge of the patch grid
+uniform float	Radius;				// radius of the sphere
+uniform vec3	ObjectEyePosition;	// eye position in the object space of the sphere
+uniform float	TileSize;			// texels along each edge of a baked tile
+
+// The depth pre-pass program must place every vertex exactly where this one does...
+invariant gl_Position;
+
+out vec3 vertexWorldPos;
+out vec3 vertexSurfacePos;
+out vec3 vertexSurfaceNormal;
+flat out int vertexFace;
+flat out int vertexPatch;
+out vec2 vertexTileCoord;
+flat out float vertexTileLayer;
+
+int		patchFace;
+vec2	patchOrigin;
+float	patchSize;
+
+// Move odd grid vertices onto their even neighbours by the morph factor k.
+vec2 MorphVertex(vec2 gridCoord, float k)
+{
+	vec2 fraction = fract(gridCoord * PatchResolution * 0.5) * 2.0 / PatchResolution;
+	return gridCoord - (fraction * k);
+}
+
+vec3 PatchToSphere(vec2 gridCoord)
+{
+	return Radius * CubeFaceToSphere(patchFace, patchOrigin + (gridCoord * patchSize));
+}
+
+void main()
+{
+	int verticesPerEdge = int(PatchResolution) + 1;
+	int verticesPerPatch = verticesPerEdge * verticesPerEdge;
+	int patchVertex = gl_VertexID % verticesPerPatch;
+	vertexPatch = gl_VertexID / verticesPerPatch;
+
+	vec4 placement = texelFetch(PatchData, (vertexPatch * 3) + 0);
+	vec4 morphRange = texelFetch(PatchData, (vertexPatch * 3) + 1);
+	vec4 tile = texelFetch(PatchData, (vertexPatch * 3) + 2);
+	patchOrigin = placement.xy;
+	patchSize = placement.z;
+	patchFace = int(placement.w);
+	vertexFace = patchFace;
+
+	vec2 gridCoord = vec2(patchVertex % verticesPerEdge, patchVertex / verticesPerEdge) / PatchResolution;
+
+	vec3 P = PatchToSphere(gridCoord);
+	float eyeDistance = distance(P, ObjectEyePosition);
+	float morph = clamp((eyeDistance - morphRange.x) / (morphRange.y - morphRange.x), 0.0, 1.0);
+	vec2 morphedCoord = MorphVertex(gridCoord, morph);
+	P = PatchToSphere(morphedCoord);
+
+	// The tile's edge texels lie on the patch's edges...
+	vec2 tileCoord = tile.xy + (morphedCoord * tile.z);
+	vertexTileCoord = (tileCoord * ((TileSize - 1.0) / TileSize)) + (0.5 / TileSize);
+	vertexTileLayer = tile.w;
+
+	gl_Position = WorldViewProjection * vec4(P + EyePosition, 1);
+
+	vertexSurfaceNormal = mat3(World) * normalize(P);
+	vertexWorldPos = vec3(World * vec4(P, 1));
+	vertexSurfacePos = P;
+}
@@ -0,0 +1,49 @@
+#version 400
+
+// Chooses how finely to tessellate each coarse patch of a cube face. Each edge is split so
+// that its segments cover about TargetEdgePixels on screen. The level of an edge depends only
+// on its two corners, so the patches either side of it agree and there are no cracks.
+//
+// Corners are (0,0), (1,0), (1,1), (0,1) in the patch's uv domain.
+
+layout (vertices = 4) out;
+
+in vec3 controlCorner[];
+out vec3 evaluationCorner[];
+
+uniform float	Radius;				// radius of the sphere
+uniform vec3	ObjectEyePosition;	// eye position in the object space of the sphere
+uniform float	ProjectionScale;	// pixels covered by a length of 1 at a distance of 1
+uniform float	TargetEdgePixels;	// screen-space length of each tessellated edge
+
+vec3 CornerPosition(int i)
+{
+	return Radius * CubeFaceToSphere(int(controlCorner[i].z), controlCorner[i].xy);
+}
+
+float EdgeLevel(vec3 a, vec3 b)
+{
+	float eyeDistance = max(distance(0.5 * (a + b), ObjectEyePosition), 1.0e-3);
+	float pixels = (distance(a, b) * ProjectionScale) / eyeDistance;
+	return clamp(pixels / TargetEdgePixels, 1.0, float(gl_MaxTessGenLevel));
+}
+
+void main()
+{
+	evaluationCorner[gl_InvocationID] = controlCorner[gl_InvocationID];
+
+	if (gl_InvocationID == 0)
+	{
+		vec3 P0 = CornerPosition(0);
+		vec3 P1 = CornerPosition(1);
+		vec3 P2 = CornerPosition(2);
+		vec3 P3 = CornerPosition(3);
+
+		gl_TessLevelOuter[0] = EdgeLevel(P0, P3);	// u = 0
+		gl_TessLevelOuter[1] = EdgeLevel(P0, P1);	// v = 0
+		gl_TessLevelOuter[2] = EdgeLevel(P1, P2);	// u = 1
+		gl_TessLevelOuter[3] = EdgeLevel(P3, P2);	// v = 1
+		gl_TessLevelInner[0] = max(gl_TessLevelOuter[1], gl_TessLevelOuter[3]);
+		gl_TessLevelInner[1] = max(gl_TessLevelOuter[0], gl_TessLevelOuter[2]);
+	}
+}
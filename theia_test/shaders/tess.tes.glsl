@@ -0,0 +1,38 @@
+#version 400
+
+// Places each tessellated vertex on the sphere and raises the land above the sea by
+// TerrainHeight times the procedural height. test.vs.glsl displaces the grid the same way
+// and gives the same outputs, so the tessellation benchmark compares like with like.
+
+layout (quads, fractional_even_spacing, cw) in;
+
+in vec3 evaluationCorner[];
+
+uniform float	Radius;				// radius of the sphere
+uniform float	TerrainHeight;		// displacement of the highest land, or 0 for a smooth sphere
+
+// The depth pre-pass program must place every vertex exactly where this one does...
+invariant gl_Position;
+
+out vec3 vertexWorldPos;
+out vec3 vertexSurfacePos;
+out vec3 vertexSurfaceNormal;
+flat out int vertexFace;
+
+void main()
+{
+	vec2 bottom = mix(evaluationCorner[0].xy, evaluationCorner[1].xy, gl_TessCoord.x);
+	vec2 top = mix(evaluationCorner[3].xy, evaluationCorner[2].xy, gl_TessCoord.x);
+	vec2 faceCoord = mix(bottom, top, gl_TessCoord.y);
+	vertexFace = int(evaluationCorner[0].z);
+
+	vec3 N = CubeFaceToSphere(vertexFace, faceCoord);
+	float elevation = (TerrainHeight != 0.0) ? max(-GetHeightAt(N), 0.0) * TerrainHeight : 0.0;
+	vec3 position = N * (Radius + elevation);
+
+	gl_Position = WorldViewProjection * vec4(position + EyePosition, 1);
+
+	vertexSurfaceNormal = mat3(World) * N;
+	vertexWorldPos = vec3(World * vec4(position, 1));
+	vertexSurfacePos = position;
+}
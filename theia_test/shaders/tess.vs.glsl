@@ -0,0 +1,12 @@
+
+// Hands the corners of the coarse cube-face patches on to the tessellation stages, which do
+// all the work of placing vertices on the sphere.
+
+layout (location = 0) in vec3 inPatchCorner;	// face coordinate in xy, face in z
+
+out vec3 controlCorner;
+
+void main()
+{
+	controlCorner = inPatchCorner;
+}
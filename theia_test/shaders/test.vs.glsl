@@ -1,17 +1,51 @@
+layout (location = 0) in vec2 inDirection;	// fixed grid: octahedral direction from the centre
+layout (location = 1) in vec2 inGridCoord;	// unit grid: face coordinate in [0,1]
+layout (location = 2) in int inFace;		// unit grid: per-instance cube face
 
-layout (location = 0) in vec3 inPosition;
+// The depth pre-pass program must place every vertex exactly where this one does...
+invariant gl_Position;
 
 out vec3 vertexWorldPos;
 out vec3 vertexSurfacePos;
 out vec3 vertexSurfaceNormal;
+flat out int vertexFace;
+
+// Each face is drawn with a base vertex of (face * VerticesPerFace), which gl_VertexID includes...
+uniform int VerticesPerFace;
+
+// When non-zero, one shared unit grid is drawn once per face and placed on the sphere here
+// instead of reading precomputed positions...
+uniform int		UnitGrid;
+uniform float	Radius;
+
+// Land is raised above the sea by this times the procedural height, as in tess.tes.glsl, so
+// that the grid and tessellated paths do the same work per vertex. 0 leaves a smooth sphere.
+uniform float	TerrainHeight;
 
 void main()
 {
-	vec4 P = vec4(inPosition + EyePosition, 1);
+	vec3 position;
+	if (UnitGrid != 0)
+	{
+		position = Radius * CubeFaceToSphere(inFace, inGridCoord);
+		vertexFace = inFace;
+	}
+	else
+	{
+		position = Radius * DecodeOctahedral(inDirection);
+		vertexFace = gl_VertexID / VerticesPerFace;
+	}
+
+	vec3 N = normalize(position);
+	if (TerrainHeight != 0.0)
+	{
+		position += N * (max(-GetHeightAt(N), 0.0) * TerrainHeight);
+	}
+
+	vec4 P = vec4(position + EyePosition, 1);
 	gl_Position = WorldViewProjection * P;
 
-	vec3 N = normalize(inPosition);
 	vertexSurfaceNormal = mat3(World) * N;
-	vertexWorldPos = World * vec4(inPosition,1);
-	vertexSurfacePos = inPosition;
+	vertexWorldPos = (World * vec4(position,1)).xyz;
+	vertexSurfacePos = position;
 }
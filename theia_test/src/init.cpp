@@ -1,6 +1,9 @@
 #include <SDL.h>
+#include <theia/graphics/headless_context.h>
 #include <theia/graphics/gl/gl_loader.h>
 #include <theia/misc/debug.h>
+#include <theia/resource_loader.h>
+#include "../resources.h"
 
 //----------------------------------------------
 
@@ -19,6 +22,7 @@ static void ConfigureSDL()
     { "SDL_GL_BLUE_SIZE",     SDL_GL_BLUE_SIZE,               8 },
     { "SDL_GL_ALPHA_SIZE",    SDL_GL_ALPHA_SIZE,              8 },
     { "SDL_GL_BUFFER_SIZE",   SDL_GL_BUFFER_SIZE,             24 },
+    { "SDL_GL_DEPTH_SIZE",    SDL_GL_DEPTH_SIZE,              24 },
     { "SDL_GL_MULTISAMPLEBUFFERS", SDL_GL_MULTISAMPLEBUFFERS, 1 },
     { "SDL_GL_MULTISAMPLESAMPLES", SDL_GL_MULTISAMPLESAMPLES, 4 }
   };
@@ -37,6 +41,9 @@ static void ConfigureGL()
   glCullFace(GL_BACK);
   glFrontFace(GL_CW);
 
+  glEnable(GL_DEPTH_TEST);
+  glDepthFunc(GL_LESS);
+
   //glClearColor(1, 0, 0, 1);
 }
 
@@ -58,3 +65,49 @@ void InitSystem(int screenWidth, int screenHeight)
   LOG("GLSL version: %s\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
   ConfigureGL();
 }
+
+//----------------------------------------------
+
+// Where there are no resource sections the shaders are read from the files they are built
+// from, relative to the working directory...
+static void RegisterShaderFiles()
+{
+#if !defined(_WIN32)
+  static const struct ShaderFile
+  {
+    uint32_t    id;
+    const char* path;
+  } shaderFiles[] =
+  {
+    { IDR_TEST_VS,        "shaders/test.vs.glsl" },
+    { IDR_TEST_FS,        "shaders/test.fs.glsl" },
+    { IDR_SHADER_COMMON,  "shaders/common.glsl" },
+    { IDR_PATCH_VS,       "shaders/patch.vs.glsl" },
+    { IDR_PATCH_FS,       "shaders/patch.fs.glsl" },
+    { IDR_GRID_CS,        "shaders/grid.cs.glsl" },
+    { IDR_TESS_VS,        "shaders/tess.vs.glsl" },
+    { IDR_TESS_TCS,       "shaders/tess.tcs.glsl" },
+    { IDR_TESS_TES,       "shaders/tess.tes.glsl" },
+    { IDR_DEPTH_FS,       "shaders/depth.fs.glsl" }
+  };
+  const int NumShaderFiles = sizeof(shaderFiles)/sizeof(shaderFiles[0]);
+  for (int i = 0; i < NumShaderFiles; ++i)
+  {
+    theia::ResourceLoader::Register(shaderFiles[i].id, shaderFiles[i].path);
+  }
+#endif
+}
+
+// No window: draw into an offscreen framebuffer instead...
+theia::HeadlessContextPtr InitHeadless(int screenWidth, int screenHeight)
+{
+  theia::HeadlessContextPtr headless = theia::HeadlessContext::Create(screenWidth, screenHeight);
+  if (headless)
+  {
+    RegisterShaderFiles();
+    LOG("GL v%d.%d\n", ogl_GetMajorVersion(), ogl_GetMinorVersion());
+    LOG("GLSL version: %s\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
+    ConfigureGL();
+  }
+  return headless;
+}
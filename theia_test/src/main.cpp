@@ -3,15 +3,42 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <vector>
 #include <stdint.h>
 #include <stddef.h>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 #include <theia/misc/debug.h>
 #include <theia/graphics/shader.h>
 #include <theia/graphics/material.h>
+#include <theia/graphics/depth_prepass.h>
+#include <theia/graphics/mesh_optimiser.h>
+#include <theia/graphics/draw_batch.h>
+#include <theia/graphics/frame_sync.h>
+#include <theia/graphics/gpu_profiler.h>
+#include <theia/graphics/headless_context.h>
+#include <theia/graphics/render_queue.h>
+#include <theia/graphics/texture_buffer.h>
 #include <theia/graphics/index_buffer.h>
 #include <theia/graphics/vertex_buffer.h>
+#include <theia/graphics/vertex_layout.h>
 #include <theia/graphics/gl/gl_loader.h>
+#include <theia/input/keyboard.h>
+#include <theia/misc/frame_clock.h>
+#include <theia/misc/frame_pipeline.h>
+#include <theia/misc/job_system.h>
+#include <theia/misc/profiler.h>
+#include <theia/terrain/cube_sphere.h>
+#include <theia/terrain/gpu_grid_builder.h>
+#include <theia/terrain/grid_builder.h>
+#include <theia/terrain/patch_culler.h>
+#include <theia/terrain/patch_mesh.h>
+#include <theia/terrain/quadtree.h>
+#include <theia/terrain/tile_cache.h>
+#include <theia/terrain/tile_store.h>
 #include "../resources.h"
 
 // Fucking steam-powered Windows segmented memory cruft...!
@@ -24,16 +51,108 @@ const int screenHeight = 720;
 const float halfFOV = 45.0f;
 const float aspectRatio = (float)screenWidth / (float)screenHeight;
 const int gridSize = 256;
+const int unitGridSize = 512;
+const int patchResolution = 32;
+const int tessPatchesPerEdge = 16;
+const float tessEdgePixels = 8.0f;
+const double simulationStep = 1.0 / 60.0;
+const int maxSimulationSteps = 8;
 //----------------------------------------------
 
+enum RenderMode
+{
+  RenderMode_FixedGrid,   // six fixed grids, one per cube face
+  RenderMode_UnitGrid,    // one shared 2D grid drawn once per face and mapped onto the sphere by the vertex shader
+  RenderMode_Quadtree,    // quadtree patches chosen each frame by screen-space error
+  RenderMode_Tessellated, // coarse patches of each face tessellated on the GPU by screen-space edge length
+  NumRenderModes
+};
+
+// A vertex of the fixed grids. Every vertex lies on the sphere, so it only needs its direction
+// from the centre, octahedral-encoded in 4 bytes rather than a 12 byte position...
 struct Vertex
 {
-  glm::vec3 position;
+  int16_t direction[2];
 
   static void Configure()
   {
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, position));
+    theia::VertexLayout(sizeof(Vertex))
+      .Add(0, theia::VertexFormat::SNorm16x2, offsetof(Vertex, direction))
+      .Configure();
+  }
+};
+
+// A vertex of the shared unit grid: a face coordinate in [0,1] stored as normalized 16-bit values...
+struct UnitGridVertex
+{
+  uint16_t u;
+  uint16_t v;
+
+  static void Configure()
+  {
+    theia::VertexLayout(sizeof(UnitGridVertex))
+      .Add(1, theia::VertexFormat::UNorm16x2, offsetof(UnitGridVertex, u))
+      .Configure();
+  }
+};
+
+// The face each instance of the unit grid is placed on...
+struct UnitGridInstance
+{
+  uint8_t face;
+
+  static void Configure()
+  {
+    theia::VertexLayout(sizeof(UnitGridInstance))
+      .Add(2, theia::VertexFormat::UInt8, offsetof(UnitGridInstance, face))
+      .Configure(1);
+  }
+};
+
+// Encodes bands of full-precision grid positions into fixed grid vertices...
+struct EncodeDirections
+{
+  const glm::vec3*  positions;
+  Vertex*           vertices;
+
+  void operator()(int begin, int end) const
+  {
+    for (int i = begin; i < end; ++i)
+    {
+      theia::VertexEncoding::EncodeNormal(glm::normalize(positions[i]), vertices[i].direction);
+    }
+  }
+};
+
+// A job which builds the full-precision positions of every fixed grid face, spreading its
+// rows across the other threads...
+struct BuildSphereGrid
+{
+  theia::JobSystem*       jobs;
+  int                     verticesPerEdge;
+  float                   radius;
+  std::vector<glm::vec3>* positions;
+
+  void operator()() const
+  {
+    theia::terrain::GridBuilder::BuildFaces(jobs, verticesPerEdge, radius, positions->data(), sizeof(glm::vec3));
+  }
+};
+
+// A job which encodes the built positions into fixed grid vertices, which may be a mapped
+// vertex buffer...
+struct EncodeSphereGrid
+{
+  theia::JobSystem*             jobs;
+  const std::vector<glm::vec3>* positions;
+  Vertex*                       vertices;
+
+  void operator()() const
+  {
+    EncodeDirections encode;
+    encode.positions = positions->data();
+    encode.vertices = vertices;
+    jobs->ParallelFor((int)positions->size(), 4096, encode);
   }
 };
 
@@ -49,6 +168,9 @@ static const glm::vec3 Left(-1,0,0);
 
 // set the Radius of the sphere...
 const float Radius = 6300;
+// ...and how far its highest land is raised above the sea, by the grid and tessellated paths
+const float TerrainHeight = Radius * 0.002f;
+static const glm::vec3 PlanetPosition(500000,0,500000);
 
 struct CameraState
 {
@@ -61,49 +183,30 @@ struct CameraState
   glm::mat4 view;
 };
 
-const struct Tangent
-{
-  glm::vec3 x;
-  glm::vec3 y;
-} tangents[] =
-{
-  { glm::vec3(1,0,0), glm::vec3(0,1,0) },
-  { glm::vec3(0,0,-1),glm::vec3(0,1,0) },
-  { glm::vec3(-1,0,0),glm::vec3(0,1,0) },
-  { glm::vec3(0,0,1),glm::vec3(0,1,0) },
-  { glm::vec3(1,0,0),glm::vec3(0,0,-1) },
-  { glm::vec3(1,0,0),glm::vec3(0,0,1) }
-};
-
 //----------------------------------------------
 
 extern void InitSystem(int screenWidth, int screenHeight);
+extern theia::HeadlessContextPtr InitHeadless(int screenWidth, int screenHeight);
 
 //----------------------------------------------
 
-static void BuildGrid(const glm::vec3& X, const glm::vec3& Y, int gridSize, Vertex* vertices)
+static void BuildUnitGrid(int gridSize, UnitGridVertex* vertices)
 {
-  const glm::vec3 normal(glm::normalize(glm::cross(X, Y)));
-  const glm::vec3 stepX(X / ((float)gridSize-1));
-  const glm::vec3 stepY(Y / ((float)gridSize-1));
-
-  glm::vec3 P((X+Y) * -0.5f);
-
   int i = 0;
   for (int y = 0; y < gridSize; ++y)
   {
     for (int x = 0; x < gridSize; ++x)
     {
-      vertices[i].position = Radius * glm::normalize(P + ((float)x * stepX) + (0.5f * normal));
+      vertices[i].u = (uint16_t)((x * 65535) / (gridSize - 1));
+      vertices[i].v = (uint16_t)((y * 65535) / (gridSize - 1));
       ++i;
     }
-    P += stepY;
   }
 }
 
 //----------------------------------------------
 
-static void BuildIndices(int gridSize, std::vector<unsigned short>& indices)
+static void BuildIndices(int gridSize, uint32_t* indices)
 {
   // Set indices for a triangle strip...
   int i = 0;
@@ -112,16 +215,16 @@ static void BuildIndices(int gridSize, std::vector<unsigned short>& indices)
   {
     for (int x = 0; x < gridSize; ++x)
     {
-      indices[i++] = x + (z * gridSize);
-      indices[i++] = x + ((z + 1) * gridSize);
+      indices[i++] = (uint32_t)(x + (z * gridSize));
+      indices[i++] = (uint32_t)(x + ((z + 1) * gridSize));
     }
     ++z;
     if (z < gridSize - 1)
     {
       for (int x = gridSize - 1; x >= 0; --x)
       {
-        indices[i++] = x + ((z + 1) * gridSize);
-        indices[i++] = x + (z * gridSize);
+        indices[i++] = (uint32_t)(x + ((z + 1) * gridSize));
+        indices[i++] = (uint32_t)(x + (z * gridSize));
       }
     }
     ++z;
@@ -130,24 +233,759 @@ static void BuildIndices(int gridSize, std::vector<unsigned short>& indices)
 
 //----------------------------------------------
 
+// Turn the grid's strip into a triangle list ordered for the post-transform cache. The strip
+// runs the full width of the grid, so every vertex has dropped out of the cache by the time
+// the next row wants it again...
+static void BuildOptimisedIndices(int gridSize, std::vector<uint32_t>& indices)
+{
+  std::vector<uint32_t> strip(gridSize * 2 * (gridSize-1));
+  BuildIndices(gridSize, strip.data());
+
+  std::vector<uint32_t> list;
+  theia::MeshOptimiser::StripToList(strip.data(), strip.size(), list);
+
+  const size_t numVertices = gridSize * gridSize;
+  const int cacheSize = theia::MeshOptimiser::DefaultCacheSize;
+  indices.resize(list.size());
+  theia::MeshOptimiser::OptimiseTriangleList(list.data(), list.size(), numVertices, cacheSize, indices.data());
+
+  const theia::MeshOptimiser::CacheStats before = theia::MeshOptimiser::AnalyseCache(list.data(), list.size(), numVertices, cacheSize);
+  const theia::MeshOptimiser::CacheStats after = theia::MeshOptimiser::AnalyseCache(indices.data(), indices.size(), numVertices, cacheSize);
+  LOG("%dx%d grid: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", gridSize, gridSize, before.acmr, after.acmr, before.atvr, after.atvr);
+}
+
+//----------------------------------------------
+
+// Create an index buffer holding the indices as the given type...
+template <typename Index>
+static theia::IndexBufferPtr CreateIndexBuffer(const std::vector<uint32_t>& indices)
+{
+  std::vector<Index> converted(indices.begin(), indices.end());
+  theia::IndexBufferPtr ib = theia::IndexBuffer::Create(converted.size() * sizeof(Index));
+  ib->SetData(converted.size() * sizeof(Index), 0, converted.data());
+  return ib;
+}
+
+//----------------------------------------------
+
+// Each program here has at most one material, so the key only needs to tell drawing with it
+// from drawing without...
+static uint64_t MakeSortKey(const theia::Shader& program, const theia::MaterialState* material, GLuint vao, float depth)
+{
+  return theia::SortKey::Make(0, program.program, (NULL != material) ? 1 : 0, vao, depth);
+}
+
+// Give the last packet recorded the parameters shared by every program which renders the planet...
+static void AddTransformConstants(theia::RenderQueue& queue, theia::Shader& shader, const CameraState& camera, const glm::mat4& model, const glm::mat4& mvp)
+{
+  queue.AddConstant(shader.GetParameter("EyePosition"), camera.position);
+  queue.AddConstant(shader.GetParameter("World"), model);
+  queue.AddConstant(shader.GetParameter("WorldViewProjection"), mvp);
+}
+
+// Sort and issue the packets recorded for a pass, timing it on the GPU and adding its counters
+// to the running totals...
+static void SubmitQueue(theia::RenderQueue& queue, theia::RenderQueueStats& totals, theia::GpuProfiler& gpu, int pass)
+{
+  theia::GpuProfileScope gpuScope(gpu, (0 == pass) ? "GPU depth pass" : "GPU shading pass");
+  queue.Submit();
+  totals.draws += queue.stats.draws;
+  totals.programChanges += queue.stats.programChanges;
+  totals.materialChanges += queue.stats.materialChanges;
+  totals.vaoChanges += queue.stats.vaoChanges;
+  totals.textureChanges += queue.stats.textureChanges;
+  totals.patchVerticesChanges += queue.stats.patchVerticesChanges;
+}
+
+//----------------------------------------------
+
+// Prepare to draw every patch with a single multi-draw call. The per-patch parameters go into
+// a buffer texture which the vertex shader indexes by patch, and each patch's terrain comes
+// from its tile in the cache...
+static void PreparePatches(const theia::terrain::PatchMesh& mesh, const std::vector<theia::terrain::Patch>& patches,
+                           const glm::vec3& eye, theia::TextureBufferPtr& patchData, theia::terrain::TileCache& tiles, theia::DrawBatch& batch)
+{
+  batch.Clear();
+  if (patches.empty())
+  {
+    return;
+  }
+
+  std::vector<glm::vec4> data(patches.size() * 3);
+  for (size_t i = 0; i < patches.size(); ++i)
+  {
+    const theia::terrain::Patch& patch = patches[i];
+
+    // Tiles of patches which look biggest on screen are baked first...
+    const glm::vec3 centre(theia::terrain::CubeSphere::FaceToSphere(patch.face, patch.origin + glm::vec2(0.5f * patch.size), Radius));
+    const float priority = patch.size / glm::max(glm::length(centre - eye), 1.0e-3f);
+    const theia::terrain::TileRef tile = tiles.Acquire(patch, priority);
+
+    data[(i * 3) + 0] = glm::vec4(patch.origin.x, patch.origin.y, patch.size, (float)patch.face);
+    data[(i * 3) + 1] = glm::vec4(patch.morphRange.x, patch.morphRange.y, (float)patch.level, 0);
+    data[(i * 3) + 2] = glm::vec4(tile.offset.x, tile.offset.y, tile.scale, (float)tile.layer);
+    batch.Add(mesh.numIndices, 0, (GLint)i * mesh.verticesPerPatch, (GLuint)i);
+  }
+
+  const size_t sizeInBytes = data.size() * sizeof(glm::vec4);
+  if (!patchData || (patchData->sizeInBytes < sizeInBytes))
+  {
+    patchData = theia::TextureBuffer::Create(sizeInBytes * 2, GL_RGBA32F);
+  }
+  patchData->SetData(sizeInBytes, 0, data.data());
+}
+
+// Record a draw of the patches prepared by PreparePatches, returning false if there are none.
+// Only the shading program, which is the one given a material, samples the tiles...
+static bool RecordPatches(theia::RenderQueue& queue, theia::Shader& shader, const theia::MaterialState* material, const theia::terrain::PatchMesh& mesh,
+                          const theia::TextureBufferPtr& patchData, theia::terrain::TileCache& tiles, theia::DrawBatch& batch)
+{
+  if (batch.commands.empty())
+  {
+    return false;
+  }
+
+  theia::DrawPacket& packet = queue.Add(MakeSortKey(shader, material, mesh.vao, 0.0f), &shader, mesh.vao, GL_TRIANGLES, GL_UNSIGNED_SHORT, 0, 0);
+  packet.material = material;
+  packet.batch = &batch;
+  packet.textureTargets[0] = GL_TEXTURE_BUFFER;
+  packet.textures[0] = patchData->texture;
+  queue.AddConstant(shader.GetParameter("PatchData"), 0);
+  if (NULL != material)
+  {
+    packet.textureTargets[1] = GL_TEXTURE_2D_ARRAY;
+    packet.textures[1] = tiles.texture->texture;
+    queue.AddConstant(shader.GetParameter("HeightTiles"), 1);
+  }
+  return true;
+}
+
+//----------------------------------------------
+
+// Start pass 0 (depth only) or pass 1 (shading) of a frame, returning the program to draw it with...
+static theia::Shader& BeginPass(theia::DepthPrepass& prepass, int pass, theia::Shader& depthProgram, theia::Shader& shadingProgram)
+{
+  if (0 == pass)
+  {
+    prepass.BeginDepthPass();
+    return depthProgram;
+  }
+  prepass.BeginShadingPass();
+  return shadingProgram;
+}
+
+//----------------------------------------------
+
+// Test a whole cube face against the culler...
+static bool IsFaceVisible(theia::terrain::PatchCuller& culler, int face)
+{
+  glm::vec3 boundsMin;
+  glm::vec3 boundsMax;
+  theia::terrain::CubeSphere::ComputeBounds(face, glm::vec2(0), 1.0f, Radius, boundsMin, boundsMax);
+  return (theia::terrain::PatchCuller::Culled != culler.Test(face, glm::vec2(0), 1.0f, boundsMin, boundsMax, true));
+}
+
+// Test each cube face against the culler, returning the number of visible faces...
+static int CullFaces(theia::terrain::PatchCuller& culler, int visibleFaces[theia::terrain::CubeSphere::NumFaces])
+{
+  int numVisible = 0;
+  for (int face = 0; face < theia::terrain::CubeSphere::NumFaces; ++face)
+  {
+    if (IsFaceVisible(culler, face))
+    {
+      visibleFaces[numVisible++] = face;
+    }
+  }
+  culler.stats.drawn += numVisible;
+  return numVisible;
+}
+
+static void AddCullStats(theia::terrain::CullStats& totals, const theia::terrain::CullStats& stats)
+{
+  totals.tested += stats.tested;
+  totals.frustumCulled += stats.frustumCulled;
+  totals.horizonCulled += stats.horizonCulled;
+  totals.drawn += stats.drawn;
+}
+
+//----------------------------------------------
+
+// Selects the quadtree patches of each face on whichever thread picks it up. Every face has
+// its own culler and patch list, so the results are the same however the faces are spread...
+struct SelectFaces
+{
+  const theia::terrain::Quadtree* quadtree;
+  glm::mat4                       objectProjection;
+  glm::vec3                       eye;
+  float                           lodScale;
+  float                           occluderRadius;
+  std::vector<theia::terrain::Patch>* facePatches;
+  theia::terrain::CullStats*      faceStats;
+
+  void operator()(int begin, int end) const
+  {
+    for (int face = begin; face < end; ++face)
+    {
+      theia::terrain::PatchCuller culler(objectProjection, eye, occluderRadius, Radius);
+      facePatches[face].clear();
+      quadtree->SelectFace(face, eye, lodScale, facePatches[face], &culler);
+      faceStats[face] = culler.stats;
+    }
+  }
+};
+
+// Records a packet per visible tessellated face for each pass, into the queues of the thread
+// doing the work. Packets only touch GL once the queues are merged and submitted on the main
+// thread...
+struct RecordTessellatedFaces
+{
+  theia::Shader*      programs[2];    // depth-only and shading programs, or NULL to skip a pass
+  GLuint              vao;
+  GLsizei             verticesPerFace;
+  const CameraState*  camera;
+  glm::mat4           model;
+  glm::mat4           mvp;
+  glm::vec3           eye;
+  float               depthScale;
+  const int*          faces;          // the visible faces, indexed by the loop
+  std::vector<theia::RenderQueuePtr>* passQueues; // for each pass, a queue per thread
+
+  void operator()(int thread, int begin, int end) const
+  {
+    for (int i = begin; i < end; ++i)
+    {
+      const int face = faces[i];
+
+      // Nearer faces first, so that they hide more of the ones behind them...
+      const glm::vec3 centre(theia::terrain::CubeSphere::FaceToSphere(face, glm::vec2(0.5f), Radius));
+      const float depth = glm::length(centre - eye) * depthScale;
+      for (int pass = 0; pass < 2; ++pass)
+      {
+        theia::Shader* const program = programs[pass];
+        if (NULL == program) { continue; }
+
+        theia::RenderQueue& queue = *passQueues[pass][thread];
+        theia::DrawPacket& packet = queue.Add(MakeSortKey(*program, NULL, vao, depth), program, vao,
+          GL_PATCHES, 0, face * verticesPerFace, verticesPerFace);
+        packet.patchVertices = 4;
+        AddTransformConstants(queue, *program, *camera, model, mvp);
+        queue.AddConstant(program->GetParameter("ObjectEyePosition"), eye);
+      }
+    }
+  }
+};
+
+//----------------------------------------------
+
+// Show the culling counters in the window title, or the log if there's no window...
+static void ShowCullStats(RenderMode renderMode, const theia::terrain::CullStats& stats, bool inWindow)
+{
+  char caption[128];
+  sprintf(caption, "theia - %s: tested %d, culled %d (frustum %d, horizon %d), drawn %d",
+    (RenderMode_Quadtree == renderMode) ? "patches" : "faces",
+    stats.tested, stats.frustumCulled + stats.horizonCulled, stats.frustumCulled, stats.horizonCulled, stats.drawn);
+  if (inWindow) { SDL_WM_SetCaption(caption, NULL); }
+  else          { LOG("%s\n", caption); }
+}
+
+//----------------------------------------------
+
+// Where a running benchmark has got to, chosen by the simulation along with the frame it
+// applies to...
+struct BenchmarkFrame
+{
+  int step;   // altitude * 2 + setting
+  int frame;  // within the step, counting the warm-up frames
+};
+
+// Flies the camera down through a range of altitudes, timing the GPU for a number of frames
+// at each with one setting and then with another, and logs how they compare. The simulation
+// schedules the frames and applies whichever setting IsSecond() asks for; the renderer times
+// them. Each thread only touches its own half of the state.
+//
+// The GPU's results are read a few frames after they were queried, once they are available,
+// so that timing a frame doesn't stall the pipeline...
+struct ComparisonBenchmark
+{
+  static const int NumAltitudes = 5;
+  static const int WarmupFrames = 10;
+  static const int TimedFrames = 60;
+
+  /// Number of frames of queries in flight: one more than the CPU can be ahead of the GPU.
+  static const int Latency = theia::FrameSync::MaxFramesInFlight + 1;
+
+  ComparisonBenchmark(const char* name, const char* first, const char* second)
+    : name(name), step(-1), frame(0), elapsed(0), primitives(0), nextQuery(0), numPending(0)
+  {
+    labels[0] = first;
+    labels[1] = second;
+    glGenQueries(Latency * 2, &queries[0][0]);
+  }
+
+  ~ComparisonBenchmark()
+  {
+    glDeleteQueries(Latency * 2, &queries[0][0]);
+  }
+
+  static float AltitudeAt(int step) { return Radius * powf(0.25f, (float)(step / 2)); }
+  static bool IsSecond(int step) { return (step % 2) != 0; }
+
+  bool IsRunning() const { return step >= 0; }
+
+  void Start()
+  {
+    LOG("%s benchmark: %d frames per altitude\n", name, TimedFrames);
+    step = 0;
+    frame = 0;
+  }
+
+  /// Return the frame to simulate next and move on, to the next altitude or setting once
+  /// enough frames have been handed out. Simulation thread only.
+  BenchmarkFrame Advance()
+  {
+    BenchmarkFrame current;
+    current.step = step;
+    current.frame = frame;
+    if (++frame == (WarmupFrames + TimedFrames))
+    {
+      frame = 0;
+      if (++step == (NumAltitudes * 2)) { step = -1; }
+    }
+    return current;
+  }
+
+  /// Start timing a frame handed out by Advance. Render thread only.
+  void BeginFrame(const BenchmarkFrame& current)
+  {
+    if (current.frame >= WarmupFrames)
+    {
+      // Every pair is only still pending if the GPU is further behind than FrameSync lets it
+      // get, so waiting for the oldest should cost nothing...
+      if (Latency == numPending) { CollectOldest(); }
+      glBeginQuery(GL_TIME_ELAPSED, queries[nextQuery][0]);
+      glBeginQuery(GL_PRIMITIVES_GENERATED, queries[nextQuery][1]);
+    }
+  }
+
+  /// Finish timing the frame. Its results are read by a later Collect. Render thread only.
+  void EndFrame(const BenchmarkFrame& current)
+  {
+    if (current.frame < WarmupFrames) { return; }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    glEndQuery(GL_PRIMITIVES_GENERATED);
+    queryFrames[nextQuery] = current;
+    nextQuery = (nextQuery + 1) % Latency;
+    ++numPending;
+  }
+
+  /// Read the results of every timed frame whose queries have finished, oldest first, and
+  /// log each step once its last frame is in. Call every frame, whether or not it is being
+  /// timed, so that the last few frames of a run are collected too. Render thread only.
+  void Collect()
+  {
+    while (numPending > 0)
+    {
+      const int oldest = (nextQuery + Latency - numPending) % Latency;
+      GLuint timeAvailable = GL_FALSE;
+      GLuint countAvailable = GL_FALSE;
+      glGetQueryObjectuiv(queries[oldest][0], GL_QUERY_RESULT_AVAILABLE, &timeAvailable);
+      glGetQueryObjectuiv(queries[oldest][1], GL_QUERY_RESULT_AVAILABLE, &countAvailable);
+      if ((GL_FALSE == timeAvailable) || (GL_FALSE == countAvailable)) { return; }
+      CollectOldest();
+    }
+  }
+
+  // Read the oldest pending frame's results, waiting for them if need be...
+  void CollectOldest()
+  {
+    const int oldest = (nextQuery + Latency - numPending) % Latency;
+    const BenchmarkFrame& current = queryFrames[oldest];
+    --numPending;
+
+    GLuint64 nanoseconds = 0;
+    GLuint64 count = 0;
+    glGetQueryObjectui64v(queries[oldest][0], GL_QUERY_RESULT, &nanoseconds);
+    glGetQueryObjectui64v(queries[oldest][1], GL_QUERY_RESULT, &count);
+    elapsed += nanoseconds;
+    primitives += count;
+
+    if ((current.frame + 1) < (WarmupFrames + TimedFrames)) { return; }
+
+    const int s = current.step;
+    results[s] = (float)((double)elapsed / (1.0e6 * TimedFrames));
+    triangles[s] = (int)(primitives / TimedFrames);
+    if (IsSecond(s))
+    {
+      const float a = results[s - 1];
+      const float b = results[s];
+      LOG("  altitude %8.1f: %s %6.3fms (%d triangles), %s %6.3fms (%d triangles), %.0f%% saved\n",
+        AltitudeAt(s), labels[0], a, triangles[s - 1], labels[1], b, triangles[s], (a > 0.0f) ? 100.0f * (a - b) / a : 0.0f);
+    }
+    elapsed = 0;
+    primitives = 0;
+  }
+
+  const char* name;
+  const char* labels[2];
+
+  // Simulation thread...
+  int       step;     // altitude * 2 + setting, or -1 when not running
+  int       frame;
+
+  // Render thread...
+  GLuint64        elapsed;
+  GLuint64        primitives;
+  GLuint          queries[Latency][2];    // time and primitives of each frame in flight
+  BenchmarkFrame  queryFrames[Latency];   // the frame each pair timed
+  int             nextQuery;              // pair to time the next frame with
+  int             numPending;             // pairs before nextQuery waiting to be read
+  float           results[NumAltitudes * 2];
+  int             triangles[NumAltitudes * 2];
+};
+
+//----------------------------------------------
+
+// Everything the render thread needs to draw a frame, filled in by the simulation thread and
+// left alone once handed over...
+struct FramePacket
+{
+  RenderMode  renderMode;
+  bool        adaptiveOctaves;
+  bool        depthPrepass;
+  CameraState camera;
+  glm::mat4   model;
+  glm::mat4   mvp;
+  glm::vec3   eye;        // in the object space of the planet
+  float       depthScale; // sort keys order draws by distance over the furthest a point on the sphere can be
+
+  // The faces to draw, or for the quadtree the patches...
+  int         numVisibleFaces;
+  int         visibleFaces[theia::terrain::CubeSphere::NumFaces];
+  std::vector<theia::terrain::Patch> patches;
+  theia::terrain::CullStats cullStats;
+
+  ComparisonBenchmark* benchmark; // NULL unless a benchmark is timing this frame
+  BenchmarkFrame       benchmarkFrame;
+};
+
+// Keyboard input for the simulation, gathered by the main thread which owns the window...
+struct SimulationInput
+{
+  SimulationInput() : moveUp(false), moveDown(false) { }
+
+  bool                moveUp;
+  bool                moveDown;
+  std::vector<SDLKey> keys;   // pressed since the simulation last looked
+};
+
+// Passes input from the main thread to the simulation thread...
+struct InputMailbox
+{
+  void Post(const SimulationInput& input)
+  {
+    boost::mutex::scoped_lock lock(mutex);
+    pending.moveUp = input.moveUp;
+    pending.moveDown = input.moveDown;
+    pending.keys.insert(pending.keys.end(), input.keys.begin(), input.keys.end());
+  }
+
+  void Take(SimulationInput& input)
+  {
+    boost::mutex::scoped_lock lock(mutex);
+    input.moveUp = pending.moveUp;
+    input.moveDown = pending.moveDown;
+    input.keys.swap(pending.keys);
+    pending.keys.clear();
+  }
+
+  boost::mutex    mutex;
+  SimulationInput pending;
+};
+
+// The animated part of the simulation, which is moved on in fixed steps and interpolated
+// between the last two of them for drawing...
+struct SimulationState
+{
+  float angle;          // of the planet's rotation, in degrees
+  float cameraAltitude;
+};
+
+// Animates the planet and camera, applies the view settings chosen from the keyboard, and
+// culls and selects what to draw, writing a packet per frame for the render thread. Runs a
+// frame ahead of the renderer on its own thread...
+struct Simulation
+{
+  Simulation()
+    : jobs(NULL), pipeline(NULL), mailbox(NULL), quadtree(NULL), lodScale(0), tessellationSupported(false), stepPerFrame(false),
+      shadingBenchmark(NULL), tessellationBenchmark(NULL), benchmark(NULL),
+      renderMode(RenderMode_FixedGrid), adaptiveOctaves(true), timestep(simulationStep, maxSimulationSteps)
+  {
+    for (int mode = 0; mode < NumRenderModes; ++mode) { occluderRadii[mode] = Radius; }
+
+    // The modes which shade noise in every fragment lay down depth first; the quadtree's
+    // fragments only sample a tile, so drawing its geometry twice costs more than it saves.
+    // F9 toggles the pre-pass for the current mode...
+    depthPrepassModes[RenderMode_FixedGrid] = true;
+    depthPrepassModes[RenderMode_UnitGrid] = true;
+    depthPrepassModes[RenderMode_Quadtree] = false;
+    depthPrepassModes[RenderMode_Tessellated] = true;
+
+    camera.up = Up;
+    camera.target = Forward;
+    current.angle = 0.0f;
+    // start the eye at some multiple of the Radius (so we can see the damn thing)...
+    current.cameraAltitude = Radius * 2.0f;
+    previous = current;
+  }
+
+  // The simulation thread: fill in packets until the pipeline is closed...
+  void Run()
+  {
+    theia::Profiler::SetThreadName("simulation");
+    for (;;)
+    {
+      FramePacket* const packet = pipeline->BeginWrite();
+      if (NULL == packet) { break; }
+      SimulationInput input;
+      mailbox->Take(input);
+      Step(input, *packet);
+      pipeline->EndWrite();
+    }
+  }
+
+  void HandleKey(SDLKey key)
+  {
+    switch (key)
+    {
+    case SDLK_F1: renderMode = RenderMode_FixedGrid; break;
+    case SDLK_F2: renderMode = RenderMode_Quadtree; break;
+    case SDLK_F3: renderMode = RenderMode_UnitGrid; break;
+    case SDLK_F5:
+      adaptiveOctaves = !adaptiveOctaves;
+      LOG("terrain octaves: %s\n", adaptiveOctaves ? "adaptive" : "all");
+      break;
+    case SDLK_F6:
+      if (NULL == benchmark) { benchmark = shadingBenchmark; benchmark->Start(); }
+      break;
+    case SDLK_F7:
+      if (tessellationSupported) { renderMode = RenderMode_Tessellated; }
+      break;
+    case SDLK_F8:
+      if ((NULL == benchmark) && tessellationSupported) { benchmark = tessellationBenchmark; benchmark->Start(); }
+      break;
+    case SDLK_F9:
+      depthPrepassModes[renderMode] = !depthPrepassModes[renderMode];
+      LOG("depth pre-pass: %s\n", depthPrepassModes[renderMode] ? "on" : "off");
+      break;
+    default: break;
+    }
+  }
+
+  // Move the animation on by one fixed step...
+  void Update(const SimulationInput& input, float seconds)
+  {
+    current.angle += 20.0f * seconds;
+
+    // Move the eye towards or away from the surface, halving or doubling the altitude every second...
+    if (input.moveUp)   { current.cameraAltitude *= powf(0.5f, seconds); }
+    if (input.moveDown) { current.cameraAltitude *= powf(2.0f, seconds); }
+    current.cameraAltitude = glm::clamp(current.cameraAltitude, 1.0f, Radius * 10.0f);
+  }
+
+  void Step(const SimulationInput& input, FramePacket& packet)
+  {
+    PROFILE_SCOPE("Simulation::Step");
+    for (size_t i = 0; i < input.keys.size(); ++i) { HandleKey(input.keys[i]); }
+
+    // Run however many steps have come due since the last frame, and draw the state part of
+    // the way from the one before the last to the last, by how far real time has got towards
+    // the next. The animation then moves at the same rate, smoothly, whatever the frame rate.
+    // Unattended runs take exactly one step a frame instead, so that frame N always shows the
+    // same thing however long it took to draw...
+    const int steps = stepPerFrame ? 1 : timestep.Advance(theia::FrameClock::Now());
+    for (int i = 0; i < steps; ++i)
+    {
+      previous = current;
+      Update(input, (float)timestep.stepSeconds);
+    }
+
+    packet.benchmark = benchmark;
+    if (NULL != benchmark)
+    {
+      packet.benchmarkFrame = benchmark->Advance();
+      const int step = packet.benchmarkFrame.step;
+      current.cameraAltitude = ComparisonBenchmark::AltitudeAt(step);
+      previous.cameraAltitude = current.cameraAltitude;
+      if (benchmark == shadingBenchmark)
+      {
+        renderMode = RenderMode_FixedGrid;
+        adaptiveOctaves = ComparisonBenchmark::IsSecond(step);
+      }
+      else
+      {
+        renderMode = ComparisonBenchmark::IsSecond(step) ? RenderMode_Tessellated : RenderMode_FixedGrid;
+      }
+      if (!benchmark->IsRunning()) { benchmark = NULL; }
+    }
+    packet.renderMode = renderMode;
+    packet.adaptiveOctaves = adaptiveOctaves;
+    packet.depthPrepass = depthPrepassModes[renderMode];
+
+    const float alpha = stepPerFrame ? 1.0f : timestep.Alpha();
+    const float angle = glm::mix(previous.angle, current.angle, alpha);
+    const float cameraAltitude = glm::mix(previous.cameraAltitude, current.cameraAltitude, alpha);
+
+    const float cameraDistance = Radius + cameraAltitude;
+    camera.position = PlanetPosition + (glm::vec3(0,0,-1) * cameraDistance);
+    // try to minimise the distance between the near and far bounding planes:
+    // near must be closer than the sphere while far need be no further than the horizon...
+    camera.near = 0.5f * cameraAltitude;
+    camera.far = sqrtf((cameraDistance * cameraDistance) - (Radius * Radius)) + camera.near;
+    camera.perspective = glm::perspective(halfFOV, aspectRatio, camera.near, camera.far);
+
+    // Constant translation and axial tilt...
+    const glm::mat4 planet(   glm::translate(MatrixIdentity, PlanetPosition)
+                            * glm::rotate(MatrixIdentity, 20.0f, glm::vec3(0,0,1))
+                          );
+    // Rotation animation...
+    glm::mat4 rotation(glm::rotate(MatrixIdentity, angle, Up));
+    // Final transform...
+    glm::mat4 model(planet * rotation);
+
+    // Combine the view and model transform matrices and translate the result to make objects
+    // relative to the eye before making the final screen-space perspective transform...
+    camera.view = glm::lookAt(camera.position, PlanetPosition, camera.up);
+
+    glm::mat4 mv(glm::translate(camera.view * model, -camera.position));
+    //glm::mat4 mv(camera.view * model);
+
+    packet.camera = camera;
+    packet.model = model;
+    packet.mvp = camera.perspective * mv;
+    packet.depthScale = 1.0f / (cameraDistance + Radius);
+
+    // Culling and LOD selection happen in the object space of the planet...
+    const glm::vec3 eye(glm::inverse(model) * glm::vec4(camera.position, 1));
+    const glm::mat4 objectProjection(camera.perspective * camera.view * model);
+    packet.eye = eye;
+
+    packet.cullStats = theia::terrain::CullStats();
+    packet.numVisibleFaces = 0;
+    packet.patches.clear();
+    if (RenderMode_Quadtree == renderMode)
+    {
+      SelectFaces select;
+      select.quadtree = quadtree;
+      select.objectProjection = objectProjection;
+      select.eye = eye;
+      select.lodScale = lodScale;
+      select.occluderRadius = occluderRadii[renderMode];
+      select.facePatches = facePatches;
+      select.faceStats = faceStats;
+      jobs->ParallelFor(theia::terrain::CubeSphere::NumFaces, 1, select);
+
+      for (int face = 0; face < theia::terrain::CubeSphere::NumFaces; ++face)
+      {
+        packet.patches.insert(packet.patches.end(), facePatches[face].begin(), facePatches[face].end());
+        AddCullStats(packet.cullStats, faceStats[face]);
+      }
+    }
+    else
+    {
+      theia::terrain::PatchCuller culler(objectProjection, eye, occluderRadii[renderMode], Radius);
+      packet.numVisibleFaces = CullFaces(culler, packet.visibleFaces);
+      packet.cullStats = culler.stats;
+    }
+  }
+
+  // Set up by the main thread before the simulation thread starts...
+  theia::JobSystem*                         jobs;
+  theia::FramePipeline<FramePacket>*        pipeline;
+  InputMailbox*                             mailbox;
+  const theia::terrain::Quadtree*           quadtree;
+  float                                     lodScale;
+  float                                     occluderRadii[NumRenderModes]; // spheres beneath every triangle of each mode's mesh
+  bool                                      tessellationSupported;
+  bool                                      stepPerFrame;  // rather than stepping in real time
+  ComparisonBenchmark*                      shadingBenchmark;
+  ComparisonBenchmark*                      tessellationBenchmark;
+
+  // Simulation thread...
+  ComparisonBenchmark*                      benchmark;
+  RenderMode                                renderMode;
+  bool                                      adaptiveOctaves;
+  bool                                      depthPrepassModes[NumRenderModes];
+  CameraState                               camera;
+  theia::FixedTimestep                      timestep;
+  SimulationState                           previous;
+  SimulationState                           current;
+  std::vector<theia::terrain::Patch>        facePatches[theia::terrain::CubeSphere::NumFaces];
+  theia::terrain::CullStats                 faceStats[theia::terrain::CubeSphere::NumFaces];
+};
+
+struct RunSimulation
+{
+  Simulation* simulation;
+
+  void operator()() const { simulation->Run(); }
+};
+
 int main(int argc, char* argv[])
 {
   LOG("----\n");
-  InitSystem(1280,720);
 
-  const glm::vec3 PlanetPosition(500000,0,500000);
+  // "--cpu-grid" builds the sphere on the CPU even where compute shaders are available;
+  // "--max-fps N" limits the frame rate, which F10 also steps through; "--frames-in-flight N"
+  // lets the CPU get up to N frames ahead of the GPU, which F11 also steps through.
+  // "--headless" draws offscreen with no window, for running unattended, where "--frames N"
+  // quits after N frames, "--png-every N" saves every Nth frame as frame_NNNNN.png and
+  // "--benchmark shading|tessellation" starts one of the benchmarks straight away...
+  bool cpuGrid = false;
+  double maxFrameRate = 0.0;
+  int framesInFlight = 2;
+  bool headlessMode = false;
+  int maxFrames = 0;
+  int pngInterval = 0;
+  SDLKey startBenchmark = SDLK_UNKNOWN;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (0 == strcmp(argv[i], "--cpu-grid")) { cpuGrid = true; }
+    if ((0 == strcmp(argv[i], "--max-fps")) && ((i + 1) < argc)) { maxFrameRate = atof(argv[++i]); }
+    if ((0 == strcmp(argv[i], "--frames-in-flight")) && ((i + 1) < argc)) { framesInFlight = atoi(argv[++i]); }
+    if (0 == strcmp(argv[i], "--headless")) { headlessMode = true; }
+    if ((0 == strcmp(argv[i], "--frames")) && ((i + 1) < argc)) { maxFrames = atoi(argv[++i]); }
+    if ((0 == strcmp(argv[i], "--png-every")) && ((i + 1) < argc)) { pngInterval = atoi(argv[++i]); }
+    if ((0 == strcmp(argv[i], "--benchmark")) && ((i + 1) < argc))
+    {
+      ++i;
+      if (0 == strcmp(argv[i], "shading"))      { startBenchmark = SDLK_F6; }
+      if (0 == strcmp(argv[i], "tessellation")) { startBenchmark = SDLK_F8; }
+    }
+  }
 
-  CameraState camera;
-  camera.up = Up;
-  camera.target = Forward;
-  // set the eye position to some multiple of the Radius (so we can see the damn thing)...
-  camera.position = PlanetPosition + (glm::vec3(0,0,-1) * Radius * 3.0f);
-  // try to minimise the distance between the near and far bounding planes:
-  // near must be closer than the sphere while far bounding plane must be at least (near + sphere_location)...
-  camera.near = Radius * 1.1f;
-  camera.far = glm::distance(camera.position, PlanetPosition) + camera.near;
-  camera.perspective = glm::perspective(halfFOV, aspectRatio, camera.near, camera.far);
+  theia::HeadlessContextPtr headless;
+  if (headlessMode)
+  {
+    headless = InitHeadless(screenWidth, screenHeight);
+    if (!headless)
+    {
+      return EXIT_FAILURE;
+    }
+  }
+  else
+  {
+    InitSystem(screenWidth, screenHeight);
+  }
+  theia::Profiler::SetThreadName("main");
+
+  theia::input::Keyboard keyboard;
+  // F6 compares every terrain octave against adaptive ones; F8 the fixed grid against the
+  // tessellated faces...
+  ComparisonBenchmark shadingBenchmark("shading", "all octaves", "adaptive");
+  ComparisonBenchmark tessellationBenchmark("tessellation", "grid", "tessellated");
 
+  theia::DepthPrepassPtr depthPrepass = theia::DepthPrepass::Create();
 
   theia::ShaderPtr shader(new theia::Shader());
   shader->Compile(IDR_SHADER_COMMON, IDR_TEST_VS, IDR_TEST_FS);
@@ -155,28 +993,77 @@ int main(int argc, char* argv[])
   theia::MaterialState material(shader);
   theia::Material::Apply(material);
 
-  // create one vertex buffer with all the vertices for all 6 faces of the cube...
+  theia::JobSystemPtr jobs = theia::JobSystem::Create();
+
+  const bool useGpuGrid = !cpuGrid && theia::terrain::GpuGridBuilder::IsSupported();
+
+  // create one vertex buffer with all the vertices for all 6 faces of the cube, written in
+  // place by a compute shader or else generated by jobs which run while the rest of the
+  // scene is set up and encode straight into the buffer, mapped here on the GL thread...
   theia::VertexBufferPtr sphereVertices;
+  std::vector<glm::vec3> cpuGridPositions;
+  Vertex* cpuGridMapping = NULL;
+  std::vector<Vertex> cpuGridVertices; // only used if the buffer could not be mapped
+  EncodeSphereGrid cpuGridEncode;
+  theia::JobCounter cpuGridBuilt;
+  theia::JobCounter cpuGridEncoded;
   {
-    std::vector<Vertex> vertices(gridSize * gridSize * 6);
-    for (int face = 0; face < 6; ++face)
+    const size_t sizeInBytes = gridSize * gridSize * 6 * sizeof(Vertex);
+    sphereVertices = theia::VertexBuffer::Create(sizeInBytes);
+
+    theia::terrain::GpuGridBuilderPtr gpuGridBuilder;
+    if (useGpuGrid)
+    {
+      theia::ShaderPtr gridShader(new theia::Shader());
+      if (gridShader->CompileCompute(IDR_SHADER_COMMON, IDR_GRID_CS))
+      {
+        gpuGridBuilder = theia::terrain::GpuGridBuilder::Create(gridShader);
+      }
+    }
+    LOG("sphere grid built on the %s\n", gpuGridBuilder ? "GPU" : "CPU");
+
+    if (gpuGridBuilder)
     {
-      const int offset = gridSize * gridSize;
-      BuildGrid(tangents[face].x, tangents[face].y, gridSize, vertices.data() + (offset * face));
+      theia::terrain::GridLayout layout(sizeof(Vertex));
+      layout.positionOffset = -1;
+      layout.directionOffset = offsetof(Vertex, direction);
+      gpuGridBuilder->BuildFaces(*sphereVertices, 0, gridSize, Radius, layout);
+    }
+    else
+    {
+      // The reference builder makes full-precision positions, which are then encoded...
+      cpuGridPositions.resize(gridSize * gridSize * 6);
+      cpuGridMapping = (Vertex*)sphereVertices->Map(sizeInBytes, 0);
+      if (NULL == cpuGridMapping)
+      {
+        LOG("failed to map the sphere vertex buffer, staging the grid instead\n");
+        cpuGridVertices.resize(cpuGridPositions.size());
+      }
+
+      BuildSphereGrid build;
+      build.jobs = jobs.get();
+      build.verticesPerEdge = gridSize;
+      build.radius = Radius;
+      build.positions = &cpuGridPositions;
+      jobs->Run(build, &cpuGridBuilt);
+
+      cpuGridEncode.jobs = jobs.get();
+      cpuGridEncode.positions = &cpuGridPositions;
+      cpuGridEncode.vertices = (NULL != cpuGridMapping) ? cpuGridMapping : cpuGridVertices.data();
+      jobs->RunAfter(cpuGridBuilt, cpuGridEncode, &cpuGridEncoded);
     }
-    sphereVertices = theia::VertexBuffer::Create(vertices.size() * sizeof(Vertex));
-    sphereVertices->SetData(vertices.size() * sizeof(Vertex), 0, vertices.data());
   }
 
-  // Create one index buffer that defines a triangle strip for just a single face of the cube.
-  // An instanced render call is used later to run this triangle strip 6 times over the vertex
+  // Create one index buffer that defines a triangle list for just a single face of the cube.
+  // A multi-draw call is used later to run this triangle list 6 times over the vertex
   // buffer...
-  const int numIndices = gridSize * 2 * (gridSize-1);
-  theia::IndexBufferPtr ib = theia::IndexBuffer::Create(numIndices * sizeof(unsigned short));
+  GLsizei numIndices;
+  theia::IndexBufferPtr ib;
   {
-    std::vector<unsigned short> indices(numIndices);
-    BuildIndices(gridSize, indices);
-    ib->SetData(indices.size() * sizeof(unsigned short), 0, indices.data());
+    std::vector<uint32_t> indices;
+    BuildOptimisedIndices(gridSize, indices);
+    numIndices = (GLsizei)indices.size();
+    ib = CreateIndexBuffer<unsigned short>(indices);
   }
 
   // Create an object to hold all the buffer state in a single place...
@@ -196,72 +1083,554 @@ int main(int argc, char* argv[])
   shader->SetParameter(shader->GetParameter("AmbientLight"), glm::vec3(0.2f));
   shader->SetParameter(shader->GetParameter("GridLineWidth"), glm::vec2(1));
   shader->SetParameter(shader->GetParameter("GridResolution"), glm::vec2(1.0f / 20.0f, 1.0f / 10.0f));
+  shader->SetParameter(shader->GetParameter("VerticesPerFace"), gridSize * gridSize);
+  shader->SetParameter(shader->GetParameter("Radius"), Radius);
+  shader->SetParameter(shader->GetParameter("TerrainHeight"), TerrainHeight);
+
+  // Each program has a position-only twin for the depth pre-pass, sharing its vertex stages...
+  theia::ShaderPtr depthShader(new theia::Shader());
+  depthShader->Compile(IDR_SHADER_COMMON, IDR_TEST_VS, IDR_DEPTH_FS);
+  depthShader->SetParameter(depthShader->GetParameter("VerticesPerFace"), gridSize * gridSize);
+  depthShader->SetParameter(depthShader->GetParameter("Radius"), Radius);
+  depthShader->SetParameter(depthShader->GetParameter("TerrainHeight"), TerrainHeight);
+
+  // The unit grid path stores a single 2D grid, a sixth of the vertices, and draws it as one instance per visible face. Grids too big for 16-bit indices
+  // switch to 32-bit ones...
+  GLsizei numUnitGridIndices;
+  const GLenum unitGridIndexType = ((unitGridSize * unitGridSize) > 65536) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+  theia::VertexBufferPtr unitGridVertices;
+  theia::IndexBufferPtr unitGridIndices;
+  theia::VertexBufferPtr unitGridInstances[theia::FrameSync::MaxFramesInFlight];
+  GLuint unitGridVaos[theia::FrameSync::MaxFramesInFlight];
+  {
+    std::vector<UnitGridVertex> vertices(unitGridSize * unitGridSize);
+    BuildUnitGrid(unitGridSize, vertices.data());
+    unitGridVertices = theia::VertexBuffer::Create(vertices.size() * sizeof(UnitGridVertex));
+    unitGridVertices->SetData(vertices.size() * sizeof(UnitGridVertex), 0, vertices.data());
+
+    std::vector<uint32_t> indices;
+    BuildOptimisedIndices(unitGridSize, indices);
+    numUnitGridIndices = (GLsizei)indices.size();
+    unitGridIndices = (GL_UNSIGNED_INT == unitGridIndexType) ? CreateIndexBuffer<uint32_t>(indices) : CreateIndexBuffer<uint16_t>(indices);
+
+    // The visible faces are rewritten every frame, so like the draw batches below each frame
+    // in flight has its own instance buffer, and a vertex array object to go with it...
+    glGenVertexArrays(theia::FrameSync::MaxFramesInFlight, unitGridVaos);
+    for (int slot = 0; slot < theia::FrameSync::MaxFramesInFlight; ++slot)
+    {
+      unitGridInstances[slot] = theia::VertexBuffer::Create(theia::terrain::CubeSphere::NumFaces * sizeof(UnitGridInstance));
+
+      glBindVertexArray(unitGridVaos[slot]);
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, unitGridIndices->buffer);
+      glBindBuffer(GL_ARRAY_BUFFER, unitGridVertices->buffer);
+      UnitGridVertex::Configure();
+      glBindBuffer(GL_ARRAY_BUFFER, unitGridInstances[slot]->buffer);
+      UnitGridInstance::Configure();
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  // Both paths submit all of their faces or patches with one multi-draw call. The batches'
+  // indirect buffers and the patch data are rewritten every frame, so each frame in flight
+  // has its own, which the GPU has finished with by the time the frame's slot comes round...
+  theia::FrameSyncPtr frameSync = theia::FrameSync::Create(framesInFlight);
+  theia::GpuProfilerPtr gpuProfiler = theia::GpuProfiler::Create();
+  theia::DrawBatch drawBatches[theia::FrameSync::MaxFramesInFlight];
+  theia::TextureBufferPtr patchData[theia::FrameSync::MaxFramesInFlight];
+  LOG("multi-draw path: %s\n", drawBatches[0].useIndirect ? "glMultiDrawElementsIndirect" : "glMultiDrawElementsBaseVertex");
+
+  // The quadtree path draws many copies of one small patch grid, placed and morphed on the
+  // sphere by the vertex shader...
+  theia::terrain::QuadtreeSettings quadtreeSettings;
+  quadtreeSettings.radius = Radius;
+  quadtreeSettings.patchResolution = patchResolution;
+  const theia::terrain::Quadtree quadtree(quadtreeSettings);
+  const float lodScale = theia::terrain::Quadtree::ComputeLODScale((float)screenHeight, halfFOV);
+
+  theia::ShaderPtr patchShader(new theia::Shader());
+  patchShader->Compile(IDR_SHADER_COMMON, IDR_PATCH_VS, IDR_PATCH_FS);
+
+  theia::MaterialState patchMaterial(patchShader);
+  theia::Material::Apply(patchMaterial);
+
+  theia::terrain::PatchMeshPtr patchMesh = theia::terrain::PatchMesh::Create(patchResolution);
+
+  patchShader->SetParameter(patchShader->GetParameter("AmbientLight"), glm::vec3(0.2f));
+  patchShader->SetParameter(patchShader->GetParameter("PatchResolution"), (float)patchResolution);
+  patchShader->SetParameter(patchShader->GetParameter("Radius"), Radius);
+
+  // Terrain for the patches is baked into tiles as they come into view, rather than summing
+  // octaves of noise in every fragment. Tiles are baked on worker threads and uploaded a few
+  // at a time so that fast camera moves don't stall a frame...
+  theia::terrain::TileCacheSettings tileSettings;
+  // Tiles baked on earlier runs are read back from disk rather than baked again...
+  theia::terrain::TileStorePtr tileStore = theia::terrain::TileStore::Open(".", tileSettings.tileSize, tileSettings.noise, 2048);
+  theia::terrain::TileCachePtr tileCache = theia::terrain::TileCache::Create(tileSettings, tileStore);
+  theia::terrain::TileCacheStats tileStats;
+  patchShader->SetParameter(patchShader->GetParameter("TileSize"), (float)tileSettings.tileSize);
+
+  theia::ShaderPtr patchDepthShader(new theia::Shader());
+  patchDepthShader->Compile(IDR_SHADER_COMMON, IDR_PATCH_VS, IDR_DEPTH_FS);
+  patchDepthShader->SetParameter(patchDepthShader->GetParameter("PatchResolution"), (float)patchResolution);
+  patchDepthShader->SetParameter(patchDepthShader->GetParameter("Radius"), Radius);
+
+  // Each face as coarse quads which the GPU tessellates to a constant size on screen. The
+  // patch corners are laid out face by face so that any visible face can be drawn alone...
+  const bool tessellationSupported = (NULL != glPatchParameteri);
+  theia::ShaderPtr tessShader;
+  theia::ShaderPtr tessDepthShader;
+  theia::VertexBufferPtr tessCorners;
+  GLuint tessVao = 0;
+  const GLsizei tessVerticesPerFace = tessPatchesPerEdge * tessPatchesPerEdge * 4;
+  if (tessellationSupported)
+  {
+    tessShader.reset(new theia::Shader());
+    tessShader->Compile(IDR_SHADER_COMMON, IDR_TESS_VS, IDR_TESS_TCS, IDR_TESS_TES, IDR_TEST_FS);
+
+    theia::MaterialState tessMaterial(tessShader);
+    theia::Material::Apply(tessMaterial);
+
+    std::vector<glm::vec3> corners;
+    corners.reserve(theia::terrain::CubeSphere::NumFaces * tessVerticesPerFace);
+    const float step = 1.0f / (float)tessPatchesPerEdge;
+    for (int face = 0; face < theia::terrain::CubeSphere::NumFaces; ++face)
+    {
+      for (int y = 0; y < tessPatchesPerEdge; ++y)
+      {
+        for (int x = 0; x < tessPatchesPerEdge; ++x)
+        {
+          const float u0 = x * step, u1 = (x + 1) * step;
+          const float v0 = y * step, v1 = (y + 1) * step;
+          corners.push_back(glm::vec3(u0, v0, (float)face));
+          corners.push_back(glm::vec3(u1, v0, (float)face));
+          corners.push_back(glm::vec3(u1, v1, (float)face));
+          corners.push_back(glm::vec3(u0, v1, (float)face));
+        }
+      }
+    }
+    tessCorners = theia::VertexBuffer::Create(corners.size() * sizeof(glm::vec3));
+    tessCorners->SetData(corners.size() * sizeof(glm::vec3), 0, corners.data());
+
+    glGenVertexArrays(1, &tessVao);
+    glBindVertexArray(tessVao);
+    glBindBuffer(GL_ARRAY_BUFFER, tessCorners->buffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (const void*)0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    tessShader->SetParameter(tessShader->GetParameter("AmbientLight"), glm::vec3(0.2f));
+    tessShader->SetParameter(tessShader->GetParameter("Radius"), Radius);
+    tessShader->SetParameter(tessShader->GetParameter("ProjectionScale"), lodScale);
+    tessShader->SetParameter(tessShader->GetParameter("TargetEdgePixels"), tessEdgePixels);
+    tessShader->SetParameter(tessShader->GetParameter("TerrainHeight"), TerrainHeight);
+
+    tessDepthShader.reset(new theia::Shader());
+    tessDepthShader->Compile(IDR_SHADER_COMMON, IDR_TESS_VS, IDR_TESS_TCS, IDR_TESS_TES, IDR_DEPTH_FS);
+    tessDepthShader->SetParameter(tessDepthShader->GetParameter("Radius"), Radius);
+    tessDepthShader->SetParameter(tessDepthShader->GetParameter("ProjectionScale"), lodScale);
+    tessDepthShader->SetParameter(tessDepthShader->GetParameter("TargetEdgePixels"), tessEdgePixels);
+    tessDepthShader->SetParameter(tessDepthShader->GetParameter("TerrainHeight"), TerrainHeight);
+  }
+  else
+  {
+    LOG("tessellation shaders are not supported\n");
+  }
+
+
+  // Every draw is recorded as a packet and issued when its pass is submitted, sorted so that
+  // draws sharing state are adjacent and nearer ones go first...
+  theia::RenderQueuePtr renderQueue = theia::RenderQueue::Create();
+  theia::RenderQueueStats queueStats;
+  int queueFrames = 0;
+
+  // Modes with many draws record them on every core, each thread into its own queue for
+  // each pass; the queues are merged into renderQueue before it is sorted and submitted...
+  std::vector<theia::RenderQueuePtr> threadQueues[2];
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    for (int thread = 0; thread < jobs->NumThreads(); ++thread)
+    {
+      threadQueues[pass].push_back(theia::RenderQueue::Create());
+    }
+  }
+
+  // The rest of the scene is ready, so the CPU-built sphere grid (if any) is waited for,
+  // helping with its jobs meanwhile, and unmapped. If the mapping was lost the positions are
+  // still around to be encoded again...
+  jobs->Wait(cpuGridEncoded);
+  if (NULL != cpuGridMapping)
+  {
+    const size_t sizeInBytes = cpuGridPositions.size() * sizeof(Vertex);
+    while (!sphereVertices->Unmap())
+    {
+      cpuGridMapping = (Vertex*)sphereVertices->Map(sizeInBytes, 0);
+      if (NULL == cpuGridMapping)
+      {
+        LOG("failed to map the sphere vertex buffer again, staging the grid instead\n");
+        cpuGridVertices.resize(cpuGridPositions.size());
+        cpuGridEncode.vertices = cpuGridVertices.data();
+        cpuGridEncode();
+        break;
+      }
+      cpuGridEncode.vertices = cpuGridMapping;
+      cpuGridEncode();
+    }
+  }
+  if (!cpuGridVertices.empty())
+  {
+    sphereVertices->SetData(cpuGridVertices.size() * sizeof(Vertex), 0, cpuGridVertices.data());
+  }
 
-  const float frameRate = 1000.0f / 60.0f;
-  float previousTime = 0.0f;
-  float angle = 0.0f;
+  // The frame is split into two stages which overlap: while this thread, which owns the GL
+  // context and the window, draws one frame the simulation thread gets the next one ready...
+  theia::FramePipeline<FramePacket> pipeline;
+  InputMailbox mailbox;
+
+  Simulation simulation;
+  simulation.jobs = jobs.get();
+  simulation.pipeline = &pipeline;
+  simulation.mailbox = &mailbox;
+  simulation.quadtree = &quadtree;
+  simulation.lodScale = lodScale;
+  // Spheres which lie beneath every triangle of each path's mesh, used for horizon culling...
+  simulation.occluderRadii[RenderMode_FixedGrid] = theia::terrain::PatchCuller::ComputeOccluderRadius(Radius, gridSize - 1);
+  simulation.occluderRadii[RenderMode_UnitGrid] = theia::terrain::PatchCuller::ComputeOccluderRadius(Radius, unitGridSize - 1);
+  simulation.occluderRadii[RenderMode_Quadtree] = theia::terrain::PatchCuller::ComputeOccluderRadius(Radius, patchResolution);
+  simulation.occluderRadii[RenderMode_Tessellated] = theia::terrain::PatchCuller::ComputeOccluderRadius(Radius, tessPatchesPerEdge);
+  simulation.tessellationSupported = tessellationSupported;
+  simulation.stepPerFrame = headlessMode;
+  simulation.shadingBenchmark = &shadingBenchmark;
+  simulation.tessellationBenchmark = &tessellationBenchmark;
+
+  if (SDLK_UNKNOWN != startBenchmark)
+  {
+    SimulationInput input;
+    input.keys.push_back(startBenchmark);
+    mailbox.Post(input);
+  }
+
+  RunSimulation runSimulation;
+  runSimulation.simulation = &simulation;
+  boost::thread simulationThread(runSimulation);
+
+  static const double frameRateLimits[] = { 0.0, 30.0, 60.0, 120.0 };
+  const int numFrameRateLimits = sizeof(frameRateLimits) / sizeof(frameRateLimits[0]);
+  int frameRateLimit = 0;
+  theia::FrameClock frameClock;
+  frameClock.SetMaxFrameRate(maxFrameRate);
+
+  double statsTime = 0.0;
+  int frameCount = 0;
   bool quit = false;
+  std::vector<theia::ProfileSummaryEntry> profile;
   while (!quit)
   {
-    float now = (float)SDL_GetTicks();
-    float deltaMS = (now - previousTime) / 1000.0f;
-    if (deltaMS > frameRate) { deltaMS = frameRate; }
-    previousTime = now;
-    angle += 20 * deltaMS;
-
-    // Constant translation and axial tilt...
-    const glm::mat4 planet(   glm::translate(MatrixIdentity, PlanetPosition)
-                            * glm::rotate(MatrixIdentity, 20.0f, glm::vec3(0,0,1))
-                          );
-    // Rotation animation...
-    glm::mat4 rotation(glm::rotate(MatrixIdentity, angle, Up));
-    // Final transform...
-    glm::mat4 model(planet * rotation);
+    theia::Profiler::EndFrame();
+    PROFILE_SCOPE("Frame");
+    frameClock.Tick();
 
-    // Combine the view and model transform matrices and translate the result to make objects
-    // relative to the eye before making the final screen-space perspective transform...
-    camera.view = glm::lookAt(camera.position, PlanetPosition, camera.up);
+    // Wait for the GPU if it is too far behind...
+    const int slot = frameSync->BeginFrame();
+    theia::DrawBatch& drawBatch = drawBatches[slot];
 
-    glm::mat4 mv(glm::translate(camera.view * model, -camera.position));
-    //glm::mat4 mv(camera.view * model);
+    // GL work queued by jobs since the last frame...
+    jobs->RunMainThreadJobs();
 
-    glm::mat4 mvp(camera.perspective * mv);
+    const FramePacket& frame = *pipeline.BeginRead();
+    const double now = theia::FrameClock::Now();
+    const CameraState& camera = frame.camera;
+    const glm::mat4& model = frame.model;
+    const glm::mat4& mvp = frame.mvp;
+    const glm::vec3& eye = frame.eye;
+    const RenderMode renderMode = frame.renderMode;
 
-    shader->SetParameter(shader->GetParameter("EyePosition"), camera.position);
-    shader->SetParameter(shader->GetParameter("World"), model);
-    shader->SetParameter(shader->GetParameter("WorldViewProjection"), mvp);
+    // Everything drawn from here to the swap is timed on the GPU, as is each pass...
+    gpuProfiler->BeginFrame();
+    const int gpuFrame = gpuProfiler->BeginScope("GPU frame");
 
+    if (NULL != frame.benchmark) { frame.benchmark->BeginFrame(frame.benchmarkFrame); }
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    shader->Activate();
+    shader->SetParameter(shader->GetParameter("AdaptiveOctaves"), frame.adaptiveOctaves ? 1 : 0);
 
-    glBindVertexArray(vao);
-    // Render the vertices as 6 instances of indexed triangle strips...
-    for (int i = 0; i < 6; ++i)
+    // With the pre-pass on, each mode draws its geometry twice: pass 0 lays down depth with a
+    // position-only program, pass 1 shades only the visible samples...
+    const int firstPass = frame.depthPrepass ? 0 : 1;
+
+    const int numVisibleFaces = frame.numVisibleFaces;
+    const int* const visibleFaces = frame.visibleFaces;
+    if (RenderMode_FixedGrid == renderMode)
     {
-      // See http://stackoverflow.com/questions/9431923/using-an-offset-with-vbos-in-opengl/9434876#9434876
-      // for a quick summary...
-      glDrawElementsBaseVertex(
-        GL_TRIANGLE_STRIP,        // what kind of thing to render
-        numIndices,               // how many elements (_NOT_ primitives!) to render
-        GL_UNSIGNED_SHORT,        // index type
-        (const void*)0,           // offset from start of index buffer
-        gridSize * gridSize * i); // offset to add to each index
+      // Render the vertices as 6 instances of indexed triangle lists...
+      drawBatch.Clear();
+      for (int f = 0; f < numVisibleFaces; ++f)
+      {
+        const int i = visibleFaces[f];
+
+        // See http://stackoverflow.com/questions/9431923/using-an-offset-with-vbos-in-opengl/9434876#9434876
+        // for a quick summary...
+        drawBatch.Add(
+          numIndices,               // how many elements (_NOT_ primitives!) to render
+          0,                        // offset from start of index buffer
+          gridSize * gridSize * i,  // offset to add to each index
+          i);                       // face index
+      }
+      for (int pass = firstPass; pass < 2; ++pass)
+      {
+        theia::Shader& program = BeginPass(*depthPrepass, pass, *depthShader, *shader);
+        const theia::MaterialState* const passMaterial = (1 == pass) ? &material : NULL;
+        theia::DrawPacket& packet = renderQueue->Add(MakeSortKey(program, passMaterial, vao, 0.0f), &program, vao, GL_TRIANGLES, GL_UNSIGNED_SHORT, 0, 0);
+        packet.material = passMaterial;
+        packet.batch = &drawBatch;
+        AddTransformConstants(*renderQueue, program, camera, model, mvp);
+        renderQueue->AddConstant(program.GetParameter("UnitGrid"), 0);
+        SubmitQueue(*renderQueue, queueStats, *gpuProfiler, pass);
+      }
     }
+    else if (RenderMode_UnitGrid == renderMode)
+    {
+      if (numVisibleFaces > 0)
+      {
+        UnitGridInstance instances[theia::terrain::CubeSphere::NumFaces];
+        for (int f = 0; f < numVisibleFaces; ++f) { instances[f].face = (uint8_t)visibleFaces[f]; }
+        unitGridInstances[slot]->SetData(numVisibleFaces * sizeof(UnitGridInstance), 0, instances);
+        const GLuint unitGridVao = unitGridVaos[slot];
+
+        for (int pass = firstPass; pass < 2; ++pass)
+        {
+          theia::Shader& program = BeginPass(*depthPrepass, pass, *depthShader, *shader);
+          const theia::MaterialState* const passMaterial = (1 == pass) ? &material : NULL;
+          theia::DrawPacket& packet = renderQueue->Add(MakeSortKey(program, passMaterial, unitGridVao, 0.0f), &program, unitGridVao,
+            GL_TRIANGLES, unitGridIndexType, 0, numUnitGridIndices);
+          packet.material = passMaterial;
+          packet.instanceCount = numVisibleFaces;
+          AddTransformConstants(*renderQueue, program, camera, model, mvp);
+          renderQueue->AddConstant(program.GetParameter("UnitGrid"), 1);
+          SubmitQueue(*renderQueue, queueStats, *gpuProfiler, pass);
+        }
+      }
+    }
+    else if (RenderMode_Tessellated == renderMode)
+    {
+      tessShader->SetParameter(tessShader->GetParameter("AdaptiveOctaves"), frame.adaptiveOctaves ? 1 : 0);
+
+      RecordTessellatedFaces record;
+      record.programs[0] = (0 == firstPass) ? tessDepthShader.get() : NULL;
+      record.programs[1] = tessShader.get();
+      record.vao = tessVao;
+      record.verticesPerFace = tessVerticesPerFace;
+      record.camera = &camera;
+      record.model = model;
+      record.mvp = mvp;
+      record.eye = eye;
+      record.depthScale = frame.depthScale;
+      record.faces = visibleFaces;
+      record.passQueues = threadQueues;
+      jobs->ParallelForWithThread(numVisibleFaces, 1, record);
+
+      for (int pass = firstPass; pass < 2; ++pass)
+      {
+        BeginPass(*depthPrepass, pass, *tessDepthShader, *tessShader);
+        for (size_t thread = 0; thread < threadQueues[pass].size(); ++thread)
+        {
+          renderQueue->Merge(*threadQueues[pass][thread]);
+        }
+        SubmitQueue(*renderQueue, queueStats, *gpuProfiler, pass);
+      }
+    }
+    else
+    {
+      tileCache->BeginFrame();
+      PreparePatches(*patchMesh, frame.patches, eye, patchData[slot], *tileCache, drawBatch);
+      for (int pass = firstPass; pass < 2; ++pass)
+      {
+        theia::Shader& program = BeginPass(*depthPrepass, pass, *patchDepthShader, *patchShader);
+        if (RecordPatches(*renderQueue, program, (1 == pass) ? &patchMaterial : NULL, *patchMesh, patchData[slot], *tileCache, drawBatch))
+        {
+          AddTransformConstants(*renderQueue, program, camera, model, mvp);
+          renderQueue->AddConstant(program.GetParameter("ObjectEyePosition"), eye);
+          SubmitQueue(*renderQueue, queueStats, *gpuProfiler, pass);
+        }
+      }
+      tileCache->EndFrame();
+      tileStats.fallbacks += tileCache->stats.fallbacks;
+      tileStats.requests += tileCache->stats.requests;
+      tileStats.uploads += tileCache->stats.uploads;
+      tileStats.evictions += tileCache->stats.evictions;
+      tileStats.overflows += tileCache->stats.overflows;
+    }
+    depthPrepass->End();
+    gpuProfiler->EndScope(gpuFrame);
+    glBindVertexArray(0);
+    ++queueFrames;
+    if (NULL != frame.benchmark) { frame.benchmark->EndFrame(frame.benchmarkFrame); }
+    shadingBenchmark.Collect();
+    tessellationBenchmark.Collect();
+
+    // Everything needed from the packet has been drawn or copied, so the simulation can have
+    // it back before this thread waits for the swap...
+    const theia::terrain::CullStats cullStats = frame.cullStats;
+    const bool depthPrepassOn = frame.depthPrepass;
+    pipeline.EndRead();
+
+    if ((now - statsTime) >= 1.0)
+    {
+      ShowCullStats(renderMode, cullStats, !headless);
+      statsTime = now;
+
+      const theia::FrameTimeStats frameTimes = frameClock.TakeStats();
+      if (frameTimes.frames > 0)
+      {
+        LOG("frame time: %.2fms mean, %.2fms min, %.2fms max, %.2fms jitter\n",
+          frameTimes.MeanMS(), frameTimes.minMS, frameTimes.maxMS, frameTimes.JitterMS());
+      }
+      // Where the CPU's time went, for the most expensive few scopes...
+      const int profileFrames = theia::Profiler::TakeSummary(profile);
+      for (size_t i = 0; (i < profile.size()) && (i < 6) && (profileFrames > 0); ++i)
+      {
+        LOG("%s %s: %.3fms per frame, %.1f calls, longest %.3fms\n", (0 == i) ? "profile:" : "        ",
+          profile[i].name, profile[i].totalMS / profileFrames, (double)profile[i].calls / profileFrames, profile[i].maxMS);
+      }
 
-    SDL_GL_SwapBuffers();
+      const int gpuFrames = gpuProfiler->TakeSummary(profile);
+      for (size_t i = 0; (i < profile.size()) && (gpuFrames > 0); ++i)
+      {
+        LOG("%s %s: %.3fms per frame, longest %.3fms\n", (0 == i) ? "gpu:" : "    ",
+          profile[i].name, profile[i].totalMS / gpuFrames, profile[i].maxMS);
+      }
+      if (gpuProfiler->droppedFrames > 0)
+      {
+        LOG("gpu: %d frames not finished in time to be timed\n", gpuProfiler->droppedFrames);
+        gpuProfiler->droppedFrames = 0;
+      }
+
+      const theia::FrameSyncStats& syncStats = frameSync->stats;
+      if (syncStats.frames > 0)
+      {
+        LOG("frame sync: %d frames in flight, waited for the GPU in %d of %d frames, %.2fms per frame\n",
+          frameSync->FramesInFlight(), syncStats.stalls, syncStats.frames, syncStats.waitMS / syncStats.frames);
+        frameSync->stats = theia::FrameSyncStats();
+      }
+
+      // Whichever stage waits the longest for the other is the faster one...
+      const theia::FramePipelineStats pipelineStats = pipeline.TakeStats();
+      if (pipelineStats.frames > 0)
+      {
+        LOG("frame pipeline: simulation waited %.2fms, render waited %.2fms per frame\n",
+          pipelineStats.producerWaitMS / pipelineStats.frames, pipelineStats.consumerWaitMS / pipelineStats.frames);
+      }
+
+      // Samples which pass the depth pass's test are what shading would have cost without it...
+      const theia::DepthPrepassStats& samples = depthPrepass->stats;
+      if (samples.frames > 0)
+      {
+        const double saved = (double)(samples.depthSamples - samples.shadedSamples);
+        LOG("depth pre-pass %s: %.0f samples shaded per frame, %.0f (%.0f%%) saved\n", depthPrepassOn ? "on" : "off",
+          (double)samples.shadedSamples / samples.frames, saved / samples.frames,
+          (samples.depthSamples > 0) ? (100.0 * saved / (double)samples.depthSamples) : 0.0);
+      }
+      if (samples.droppedFrames > 0)
+      {
+        LOG("depth pre-pass: %d frames not finished in time to be counted\n", samples.droppedFrames);
+      }
+      depthPrepass->stats = theia::DepthPrepassStats();
+      if (queueFrames > 0)
+      {
+        const float perFrame = 1.0f / (float)queueFrames;
+        LOG("render queue: %.1f draws, %.1f program, %.1f material, %.1f vertex array, %.1f texture and %.1f patch size changes per frame\n",
+          queueStats.draws * perFrame, queueStats.programChanges * perFrame, queueStats.materialChanges * perFrame,
+          queueStats.vaoChanges * perFrame, queueStats.textureChanges * perFrame, queueStats.patchVerticesChanges * perFrame);
+        queueStats = theia::RenderQueueStats();
+        queueFrames = 0;
+      }
+      if ((tileStats.requests + tileStats.uploads + tileStats.overflows) > 0)
+      {
+        LOG("tiles: %d requested, %d uploaded, %d evicted, %d without room, %d drawn from an ancestor\n",
+          tileStats.requests, tileStats.uploads, tileStats.evictions, tileStats.overflows, tileStats.fallbacks);
+        tileStats = theia::terrain::TileCacheStats();
+      }
+    }
+
+    if (headless)
+    {
+      // Reading a frame back waits for the GPU to finish it, so the frames saved take longer
+      // than the rest...
+      if ((pngInterval > 0) && (0 == (frameCount % pngInterval)))
+      {
+        char path[32];
+        sprintf(path, "frame_%05d.png", frameCount);
+        headless->SaveFrame(path);
+      }
+      PROFILE_SCOPE("HeadlessContext::Present");
+      headless->Present();
+    }
+    else
+    {
+      PROFILE_SCOPE("SDL_GL_SwapBuffers");
+      SDL_GL_SwapBuffers();
+    }
+    frameSync->EndFrame();
+    frameClock.Pace();
+    ++frameCount;
+    if ((maxFrames > 0) && (frameCount >= maxFrames)) { quit = true; }
+
+    // With no window there's no input, beyond what the command line asked for...
+    if (headless)
+    {
+      continue;
+    }
     
+    // The rest of the input is the simulation's, so is passed on to it...
+    SimulationInput input;
     SDL_Event event;
     while (SDL_PollEvent(&event))
     {
       switch (event.type)
       {
       case SDL_QUIT: quit = true; break;
-      case SDL_KEYDOWN: quit = (event.key.keysym.sym == SDLK_ESCAPE); break;
+      case SDL_KEYDOWN:
+        switch (event.key.keysym.sym)
+        {
+        case SDLK_ESCAPE: quit = true; break;
+        case SDLK_F4:
+          // Toggle between the two multi-draw paths to compare them...
+          drawBatch.useIndirect = !drawBatch.useIndirect && theia::DrawBatch::IsIndirectSupported();
+          for (int i = 0; i < theia::FrameSync::MaxFramesInFlight; ++i) { drawBatches[i].useIndirect = drawBatch.useIndirect; }
+          LOG("multi-draw path: %s\n", drawBatch.useIndirect ? "glMultiDrawElementsIndirect" : "glMultiDrawElementsBaseVertex");
+          break;
+        case SDLK_F12:
+          // Capture every scope until pressed again...
+          if (theia::Profiler::IsCapturing()) { theia::Profiler::StopCapture("theia_trace.json"); }
+          else                                { theia::Profiler::StartCapture(); LOG("profile capture started\n"); }
+          break;
+        case SDLK_F11:
+          frameSync->SetFramesInFlight((frameSync->FramesInFlight() % theia::FrameSync::MaxFramesInFlight) + 1);
+          LOG("frames in flight: %d\n", frameSync->FramesInFlight());
+          break;
+        case SDLK_F10:
+          frameRateLimit = (frameRateLimit + 1) % numFrameRateLimits;
+          frameClock.SetMaxFrameRate(frameRateLimits[frameRateLimit]);
+          if (frameRateLimit > 0) { LOG("frame rate limited to %.0f per second\n", frameRateLimits[frameRateLimit]); }
+          else                    { LOG("frame rate unlimited\n"); }
+          break;
+        default: input.keys.push_back(event.key.keysym.sym); break;
+        }
+        break;
       default: break;
       }
     }
+    keyboard.Update();
+    input.moveUp = keyboard.IsKeyDown(SDLK_UP);
+    input.moveDown = keyboard.IsKeyDown(SDLK_DOWN);
+    mailbox.Post(input);
   }
 
+  // Wakes the simulation thread if it is waiting for a free packet...
+  pipeline.Close();
+  simulationThread.join();
+
   return 0;
 }
@@ -0,0 +1,81 @@
+/// Times the fixed-grid build, and fBm over the built positions, on job systems with one
+/// thread up to one per hardware thread, to show how they scale across cores.
+///
+/// Usage:
+///   jobbench [vertices per edge] [repeats]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <boost/chrono.hpp>
+#include <glm/glm.hpp>
+#include <theia/math/noise.h>
+#include <theia/misc/job_system.h>
+#include <theia/terrain/cube_sphere.h>
+#include <theia/terrain/grid_builder.h>
+
+typedef boost::chrono::high_resolution_clock Clock;
+
+//----------------------------------------------
+
+static double ElapsedMS(const Clock::time_point& start)
+{
+  return boost::chrono::duration<double, boost::milli>(Clock::now() - start).count();
+}
+
+//----------------------------------------------
+
+int main(int argc, char* argv[])
+{
+  const int verticesPerEdge = (argc > 1) ? atoi(argv[1]) : 512;
+  const int repeats = (argc > 2) ? atoi(argv[2]) : 5;
+  if ((verticesPerEdge < 2) || (repeats < 1))
+  {
+    fprintf(stderr, "usage: jobbench [vertices per edge] [repeats]\n");
+    return EXIT_FAILURE;
+  }
+
+  const float radius = 6300.0f;
+  const size_t numVertices = (size_t)verticesPerEdge * verticesPerEdge * theia::terrain::CubeSphere::NumFaces;
+  std::vector<glm::vec3> positions(numVertices);
+  std::vector<float> heights(numVertices);
+  const theia::Noise::FractalSettings settings;
+
+  int maxThreads = (int)boost::thread::hardware_concurrency();
+  if (maxThreads < 1) { maxThreads = 1; }
+
+  printf("%d faces of %dx%d vertices, best of %d\n", theia::terrain::CubeSphere::NumFaces, verticesPerEdge, verticesPerEdge, repeats);
+  printf("threads      grid  speed-up       fBm  speed-up\n");
+
+  double gridBase = 0.0;
+  double noiseBase = 0.0;
+  for (int numThreads = 1; numThreads <= maxThreads; ++numThreads)
+  {
+    theia::JobSystemPtr jobs = theia::JobSystem::Create(numThreads);
+
+    double gridBest = 0.0;
+    double noiseBest = 0.0;
+    for (int i = 0; i < repeats; ++i)
+    {
+      Clock::time_point start = Clock::now();
+      theia::terrain::GridBuilder::BuildFaces(jobs.get(), verticesPerEdge, radius, positions.data(), sizeof(glm::vec3));
+      const double grid = ElapsedMS(start);
+
+      start = Clock::now();
+      theia::Noise::fBm(jobs.get(), positions.data(), numVertices, settings, heights.data());
+      const double noise = ElapsedMS(start);
+
+      if ((0 == i) || (grid < gridBest)) { gridBest = grid; }
+      if ((0 == i) || (noise < noiseBest)) { noiseBest = noise; }
+    }
+
+    if (1 == numThreads)
+    {
+      gridBase = gridBest;
+      noiseBase = noiseBest;
+    }
+    printf("%7d %7.2fms %8.2fx %7.2fms %8.2fx\n", numThreads, gridBest, gridBase / gridBest, noiseBest, noiseBase / noiseBest);
+  }
+
+  return EXIT_SUCCESS;
+}
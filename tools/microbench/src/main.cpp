@@ -0,0 +1,535 @@
+/// Times the engine's CPU hot paths in isolation: grid and index building, shader parameter
+/// caching and lookup, OBJ parsing and keyboard polling. GL calls go to a null driver, so
+/// only theia's own code is timed and no window or context is needed.
+///
+/// Each benchmark is run enough times to take --min-time seconds, and that is repeated
+/// --repetitions times; the median time per operation is reported, along with the fastest.
+/// --json writes the results in Google Benchmark's JSON layout, so that runs from different
+/// commits can be compared with its compare.py. Times are wall-clock, so cpu_time is the same
+/// as real_time.
+///
+/// Usage:
+///   microbench [--filter text] [--min-time seconds] [--repetitions N] [--json file] [--no-profiler]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <boost/chrono.hpp>
+#include <boost/thread/thread.hpp>
+#include <glm/glm.hpp>
+#include <theia/graphics/mesh_optimiser.h>
+#include <theia/graphics/obj_loader.h>
+#include <theia/graphics/shader.h>
+#include <theia/input/keyboard.h>
+#include <theia/misc/profiler.h>
+#include <theia/terrain/cube_sphere.h>
+#include <theia/terrain/grid_builder.h>
+#include "null_gl.h"
+
+typedef boost::chrono::high_resolution_clock Clock;
+
+//----------------------------------------------
+
+namespace
+{
+  const float Radius = 6300.0f;
+
+  // Grid sizes from a patch up to the fixed grid...
+  const int GridSizes[] = { 33, 65, 129, 257 };
+  const int NumGridSizes = sizeof(GridSizes) / sizeof(GridSizes[0]);
+
+  // Results are written here so that the compiler can't throw the work away...
+  volatile uint32_t sink = 0;
+
+  struct Options
+  {
+    Options() : filter(NULL), minSeconds(0.2), repetitions(5), jsonPath(NULL), profiler(true) { }
+
+    const char* filter;
+    double      minSeconds;   // per repetition
+    int         repetitions;
+    const char* jsonPath;
+    bool        profiler;
+  };
+
+  struct Result
+  {
+    std::string name;
+    int64_t     iterations;   // per repetition
+    double      medianNS;     // per operation
+    double      minNS;
+    double      itemsPerOp;   // zero if the operation has no natural unit of work
+  };
+
+  template <typename Body>
+  double TimeIterations(Body& body, int64_t iterations)
+  {
+    const Clock::time_point start = Clock::now();
+    for (int64_t i = 0; i < iterations; ++i)
+    {
+      body();
+    }
+    return boost::chrono::duration<double, boost::nano>(Clock::now() - start).count();
+  }
+
+  // Time one benchmark, unless the filter leaves it out...
+  template <typename Body>
+  void Run(const std::string& name, Body& body, double itemsPerOp, const Options& options, std::vector<Result>& results)
+  {
+    if ((NULL != options.filter) && (std::string::npos == name.find(options.filter)))
+    {
+      return;
+    }
+
+    // Double the iterations until a run is long enough to time reliably, then scale them
+    // up to the time wanted. The first run also warms the caches...
+    const double minNS = options.minSeconds * 1.0e9;
+    int64_t iterations = 1;
+    double ns = TimeIterations(body, iterations);
+    while ((ns < (minNS * 0.1)) && (iterations < ((int64_t)1 << 40)))
+    {
+      iterations *= 2;
+      ns = TimeIterations(body, iterations);
+    }
+    iterations = std::max((int64_t)1, (int64_t)((double)iterations * (minNS / std::max(ns, 1.0))));
+
+    std::vector<double> perOp;
+    for (int i = 0; i < options.repetitions; ++i)
+    {
+      perOp.push_back(TimeIterations(body, iterations) / (double)iterations);
+    }
+    std::sort(perOp.begin(), perOp.end());
+
+    Result result;
+    result.name = name;
+    result.iterations = iterations;
+    result.medianNS = perOp[perOp.size() / 2];
+    result.minNS = perOp[0];
+    result.itemsPerOp = itemsPerOp;
+    results.push_back(result);
+
+    printf("%-48s %14.1fns %14.1fns %12lld", name.c_str(), result.medianNS, result.minNS, (long long)iterations);
+    if (itemsPerOp > 0.0) { printf(" %10.2fM/s", itemsPerOp * 1.0e3 / result.medianNS); }
+    printf("\n");
+  }
+
+  std::string Named(const char* name, int size)
+  {
+    char buffer[128];
+    sprintf(buffer, "%s/%d", name, size);
+    return buffer;
+  }
+}
+
+//----------------------------------------------
+
+// The grid's triangle strip, as theia_test builds it before optimising it into a list...
+static void BuildIndices(int gridSize, uint32_t* indices)
+{
+  int i = 0;
+  int z = 0;
+  while (z < gridSize - 1)
+  {
+    for (int x = 0; x < gridSize; ++x)
+    {
+      indices[i++] = (uint32_t)(x + (z * gridSize));
+      indices[i++] = (uint32_t)(x + ((z + 1) * gridSize));
+    }
+    ++z;
+    if (z < gridSize - 1)
+    {
+      for (int x = gridSize - 1; x >= 0; --x)
+      {
+        indices[i++] = (uint32_t)(x + ((z + 1) * gridSize));
+        indices[i++] = (uint32_t)(x + (z * gridSize));
+      }
+    }
+    ++z;
+  }
+}
+
+struct BuildFaces
+{
+  void operator()()
+  {
+    theia::terrain::GridBuilder::BuildFaces(NULL, verticesPerEdge, Radius, positions.data(), sizeof(glm::vec3));
+    sink += (uint32_t)positions[0].x;
+  }
+
+  int                     verticesPerEdge;
+  std::vector<glm::vec3>  positions;
+};
+
+struct BuildStrip
+{
+  void operator()()
+  {
+    BuildIndices(gridSize, indices.data());
+    sink += indices.back();
+  }
+
+  int                   gridSize;
+  std::vector<uint32_t> indices;
+};
+
+struct OptimiseIndices
+{
+  void operator()()
+  {
+    theia::MeshOptimiser::OptimiseTriangleList(list.data(), list.size(), numVertices, theia::MeshOptimiser::DefaultCacheSize, optimised.data());
+    sink += optimised[0];
+  }
+
+  std::vector<uint32_t> list;
+  std::vector<uint32_t> optimised;
+  size_t                numVertices;
+};
+
+static void RunGridBenchmarks(const Options& options, std::vector<Result>& results)
+{
+  for (int i = 0; i < NumGridSizes; ++i)
+  {
+    const int size = GridSizes[i];
+
+    BuildFaces faces;
+    faces.verticesPerEdge = size;
+    faces.positions.resize(size * size * theia::terrain::CubeSphere::NumFaces);
+    Run(Named("GridBuilder::BuildFaces", size), faces, (double)faces.positions.size(), options, results);
+
+    BuildStrip strip;
+    strip.gridSize = size;
+    strip.indices.resize(size * 2 * (size - 1));
+    Run(Named("BuildIndices", size), strip, (double)strip.indices.size(), options, results);
+
+    OptimiseIndices optimise;
+    BuildIndices(size, strip.indices.data());
+    theia::MeshOptimiser::StripToList(strip.indices.data(), strip.indices.size(), optimise.list);
+    optimise.optimised.resize(optimise.list.size());
+    optimise.numVertices = size * size;
+    Run(Named("MeshOptimiser::OptimiseTriangleList", size), optimise, (double)(optimise.list.size() / 3), options, results);
+  }
+}
+
+//----------------------------------------------
+
+// Add a parameter as if the shader had been compiled with it...
+static theia::Shader::Parameter* AddParameter(theia::Shader& shader, const char* name, GLenum type)
+{
+  theia::Shader::Parameter param;
+  memset(&param, 0, sizeof(param));
+  param.location = (GLuint)shader.params.size();
+  param.type = type;
+  strncpy(param.name, name, sizeof(param.name) - 1);
+  shader.params.push_back(param);
+  return &shader.params.back();
+}
+
+// Alternating between two values makes every call a change which has to be cached; with
+// both the same, every call after the first is redundant and skipped...
+template <typename Value>
+struct SetParameter
+{
+  SetParameter(theia::Shader* shader, theia::Shader::Parameter* param, const Value& a, const Value& b)
+    : shader(shader), param(param), next(0)
+  {
+    values[0] = a;
+    values[1] = b;
+  }
+
+  void operator()()
+  {
+    shader->SetParameter(param, values[next]);
+    next ^= 1;
+  }
+
+  theia::Shader*            shader;
+  theia::Shader::Parameter* param;
+  Value                     values[2];
+  int                       next;
+};
+
+template <typename Value>
+static void RunSetParameter(const char* name, GLenum type, const Value& a, const Value& b, const Options& options, std::vector<Result>& results)
+{
+  theia::Shader shader;
+  SetParameter<Value> set(&shader, AddParameter(shader, "Value", type), a, b);
+  Run(std::string("Shader::SetParameter/") + name, set, 0.0, options, results);
+}
+
+struct SetRawParameter
+{
+  void operator()()
+  {
+    shader->SetParameter(param, values[next], sizeof(values[next]));
+    next ^= 1;
+  }
+
+  theia::Shader*            shader;
+  theia::Shader::Parameter* param;
+  float                     values[2][16];
+  int                       next;
+};
+
+// Look up every parameter in turn, so the average is over every position in the list...
+struct GetParameter
+{
+  void operator()()
+  {
+    sink += shader->GetParameter(names[next].c_str())->location;
+    next = (next + 1) % names.size();
+  }
+
+  theia::Shader*            shader;
+  std::vector<std::string>  names;
+  size_t                    next;
+};
+
+struct FlushParameters
+{
+  void operator()()
+  {
+    for (size_t i = 0; i < shader->params.size(); ++i)
+    {
+      shader->params[i].dirty = true;
+    }
+    shader->Flush();
+  }
+
+  theia::Shader* shader;
+};
+
+static void RunShaderBenchmarks(const Options& options, std::vector<Result>& results)
+{
+  RunSetParameter("int", GL_INT, 1, 2, options, results);
+  RunSetParameter("float", GL_FLOAT, 1.0f, 2.0f, options, results);
+  RunSetParameter("vec2", GL_FLOAT_VEC2, glm::vec2(1.0f), glm::vec2(2.0f), options, results);
+  RunSetParameter("vec3", GL_FLOAT_VEC3, glm::vec3(1.0f), glm::vec3(2.0f), options, results);
+  RunSetParameter("vec4", GL_FLOAT_VEC4, glm::vec4(1.0f), glm::vec4(2.0f), options, results);
+  RunSetParameter("mat3", GL_FLOAT_MAT3, glm::mat3(1.0f), glm::mat3(2.0f), options, results);
+  RunSetParameter("mat4", GL_FLOAT_MAT4, glm::mat4(1.0f), glm::mat4(2.0f), options, results);
+  RunSetParameter("double", GL_DOUBLE, 1.0, 2.0, options, results);
+  RunSetParameter("dvec2", GL_DOUBLE_VEC2, glm::dvec2(1.0), glm::dvec2(2.0), options, results);
+  RunSetParameter("dvec3", GL_DOUBLE_VEC3, glm::dvec3(1.0), glm::dvec3(2.0), options, results);
+  RunSetParameter("dvec4", GL_DOUBLE_VEC4, glm::dvec4(1.0), glm::dvec4(2.0), options, results);
+  RunSetParameter("dmat3", GL_FLOAT_MAT3, glm::dmat3(1.0), glm::dmat3(2.0), options, results);
+  RunSetParameter("dmat4", GL_FLOAT_MAT4, glm::dmat4(1.0), glm::dmat4(2.0), options, results);
+  RunSetParameter("vec4/unchanged", GL_FLOAT_VEC4, glm::vec4(1.0f), glm::vec4(1.0f), options, results);
+  RunSetParameter("mat4/unchanged", GL_FLOAT_MAT4, glm::mat4(1.0f), glm::mat4(1.0f), options, results);
+  {
+    theia::Shader shader;
+    SetRawParameter set;
+    set.shader = &shader;
+    set.param = AddParameter(shader, "Value", GL_FLOAT_MAT4);
+    for (int i = 0; i < 16; ++i)
+    {
+      set.values[0][i] = 1.0f;
+      set.values[1][i] = 2.0f;
+    }
+    set.next = 0;
+    Run("Shader::SetParameter/raw", set, 0.0, options, results);
+  }
+
+  // The test program's own uniforms come first, then made-up ones up to the count wanted:
+  // from a small program's worth to a large one's...
+  static const char* const commonNames[] =
+  {
+    "World", "View", "Projection", "WorldView", "WorldViewProjection", "AmbientLight", "EyePosition", "Radius",
+    "VerticesPerFace", "UnitGrid", "AdaptiveOctaves", "GridLineWidth", "GridResolution", "ObjectEyePosition"
+  };
+  static const GLenum types[] = { GL_FLOAT_MAT4, GL_FLOAT_VEC3, GL_FLOAT, GL_INT, GL_FLOAT_VEC2, GL_FLOAT_VEC4 };
+  const int numCommonNames = sizeof(commonNames) / sizeof(commonNames[0]);
+  const int numTypes = sizeof(types) / sizeof(types[0]);
+  const int counts[] = { 8, 16, 32, 64 };
+  for (int c = 0; c < (int)(sizeof(counts) / sizeof(counts[0])); ++c)
+  {
+    theia::Shader shader;
+    GetParameter get;
+    get.shader = &shader;
+    get.next = 0;
+    for (int i = 0; i < counts[c]; ++i)
+    {
+      char name[32];
+      if (i < numCommonNames) { strcpy(name, commonNames[i]); }
+      else                    { sprintf(name, "Parameter%d", i); }
+      AddParameter(shader, name, types[i % numTypes]);
+      get.names.push_back(name);
+    }
+    Run(Named("Shader::GetParameter", counts[c]), get, 0.0, options, results);
+
+    FlushParameters flush;
+    flush.shader = &shader;
+    Run(Named("Shader::Flush", counts[c]), flush, (double)counts[c], options, results);
+  }
+}
+
+//----------------------------------------------
+
+// A grid of quads with positions, texcoords and normals, as an exporter would write it...
+static void BuildObjText(int verticesPerEdge, std::string& text)
+{
+  char line[128];
+  for (int y = 0; y < verticesPerEdge; ++y)
+  {
+    for (int x = 0; x < verticesPerEdge; ++x)
+    {
+      const float u = (float)x / (float)(verticesPerEdge - 1);
+      const float v = (float)y / (float)(verticesPerEdge - 1);
+      sprintf(line, "v %.6f %.6f %.6f\n", u * 2.0f - 1.0f, 0.1f * sinf(u * 6.0f) * cosf(v * 6.0f), v * 2.0f - 1.0f);
+      text += line;
+      sprintf(line, "vt %.6f %.6f\n", u, v);
+      text += line;
+      sprintf(line, "vn 0.000000 1.000000 0.000000\n");
+      text += line;
+    }
+  }
+  for (int y = 0; y < verticesPerEdge - 1; ++y)
+  {
+    for (int x = 0; x < verticesPerEdge - 1; ++x)
+    {
+      const int v00 = 1 + x + (y * verticesPerEdge);
+      const int v10 = v00 + 1;
+      const int v01 = v00 + verticesPerEdge;
+      const int v11 = v01 + 1;
+      sprintf(line, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", v00, v00, v00, v01, v01, v01, v11, v11, v11, v10, v10, v10);
+      text += line;
+    }
+  }
+}
+
+struct ReadObj
+{
+  void operator()()
+  {
+    theia::ObjMesh mesh;
+    theia::ReadOBJ(text.c_str(), mesh);
+    sink += (uint32_t)mesh.indices.size();
+  }
+
+  std::string text;
+};
+
+static void RunObjBenchmarks(const Options& options, std::vector<Result>& results)
+{
+  const int sizes[] = { 32, 128, 256 };
+  for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); ++i)
+  {
+    ReadObj read;
+    BuildObjText(sizes[i], read.text);
+    const double triangles = 2.0 * (sizes[i] - 1) * (sizes[i] - 1);
+    Run(Named("ReadOBJ", sizes[i]), read, triangles, options, results);
+  }
+}
+
+//----------------------------------------------
+
+struct UpdateKeyboard
+{
+  void operator()()
+  {
+    keyboard.Update();
+    sink += keyboard.IsKeyDown(SDLK_UP) ? 1 : 0;
+  }
+
+  theia::input::Keyboard keyboard;
+};
+
+//----------------------------------------------
+
+static bool WriteJson(const char* path, const std::vector<Result>& results)
+{
+  FILE* file = fopen(path, "w");
+  if (NULL == file)
+  {
+    fprintf(stderr, "unable to write %s\n", path);
+    return false;
+  }
+
+  char date[32];
+  const time_t now = time(NULL);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+  fprintf(file, "{\n  \"context\": {\n");
+  fprintf(file, "    \"date\": \"%s\",\n", date);
+  fprintf(file, "    \"num_cpus\": %u,\n", boost::thread::hardware_concurrency());
+#if defined(NDEBUG)
+  fprintf(file, "    \"library_build_type\": \"release\"\n");
+#else
+  fprintf(file, "    \"library_build_type\": \"debug\"\n");
+#endif
+  fprintf(file, "  },\n  \"benchmarks\": [\n");
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const Result& result = results[i];
+    fprintf(file, "    {\n");
+    fprintf(file, "      \"name\": \"%s\",\n", result.name.c_str());
+    fprintf(file, "      \"run_name\": \"%s\",\n", result.name.c_str());
+    fprintf(file, "      \"run_type\": \"iteration\",\n");
+    fprintf(file, "      \"iterations\": %lld,\n", (long long)result.iterations);
+    fprintf(file, "      \"real_time\": %.3f,\n", result.medianNS);
+    fprintf(file, "      \"cpu_time\": %.3f,\n", result.medianNS);
+    fprintf(file, "      \"min_time\": %.3f,\n", result.minNS);
+    if (result.itemsPerOp > 0.0)
+    {
+      fprintf(file, "      \"items_per_second\": %.1f,\n", result.itemsPerOp * 1.0e9 / result.medianNS);
+    }
+    fprintf(file, "      \"time_unit\": \"ns\"\n");
+    fprintf(file, "    }%s\n", ((i + 1) < results.size()) ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+
+  const bool written = (0 == ferror(file));
+  fclose(file);
+  return written;
+}
+
+//----------------------------------------------
+
+int main(int argc, char* argv[])
+{
+  Options options;
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool hasValue = ((i + 1) < argc);
+    if      (hasValue && (0 == strcmp(argv[i], "--filter")))      { options.filter = argv[++i]; }
+    else if (hasValue && (0 == strcmp(argv[i], "--min-time")))    { options.minSeconds = atof(argv[++i]); }
+    else if (hasValue && (0 == strcmp(argv[i], "--repetitions"))) { options.repetitions = atoi(argv[++i]); }
+    else if (hasValue && (0 == strcmp(argv[i], "--json")))        { options.jsonPath = argv[++i]; }
+    else if (0 == strcmp(argv[i], "--no-profiler"))               { options.profiler = false; }
+    else
+    {
+      fprintf(stderr, "usage: microbench [--filter text] [--min-time seconds] [--repetitions N] [--json file] [--no-profiler]\n");
+      return EXIT_FAILURE;
+    }
+  }
+  if ((options.minSeconds <= 0.0) || (options.repetitions < 1))
+  {
+    fprintf(stderr, "--min-time and --repetitions must be positive\n");
+    return EXIT_FAILURE;
+  }
+
+  // Shipping builds leave the profiler on, so its scopes are timed along with the rest
+  // unless asked not to...
+  theia::Profiler::SetEnabled(options.profiler);
+  NullGL::Install();
+
+  printf("%-48s %16s %16s %12s %12s\n", "benchmark", "median", "fastest", "iterations", "throughput");
+  std::vector<Result> results;
+  RunGridBenchmarks(options, results);
+  RunShaderBenchmarks(options, results);
+  RunObjBenchmarks(options, results);
+  {
+    UpdateKeyboard update;
+    Run("Keyboard::Update", update, 0.0, options, results);
+  }
+
+  if ((NULL != options.jsonPath) && !WriteJson(options.jsonPath, results))
+  {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,49 @@
+#include "null_gl.h"
+
+//----------------------------------------------
+
+namespace
+{
+  int calls = 0;
+  GLuint programs = 0;
+
+  GLuint CODEGEN_FUNCPTR CreateProgram() { ++calls; return ++programs; }
+  void CODEGEN_FUNCPTR DeleteProgram(GLuint) { ++calls; }
+  void CODEGEN_FUNCPTR UseProgram(GLuint) { ++calls; }
+
+  void CODEGEN_FUNCPTR UniformIV(GLint, GLsizei, const GLint*) { ++calls; }
+  void CODEGEN_FUNCPTR UniformFV(GLint, GLsizei, const GLfloat*) { ++calls; }
+  void CODEGEN_FUNCPTR UniformDV(GLint, GLsizei, const GLdouble*) { ++calls; }
+  void CODEGEN_FUNCPTR UniformMatrixFV(GLint, GLsizei, GLboolean, const GLfloat*) { ++calls; }
+  void CODEGEN_FUNCPTR UniformMatrixDV(GLint, GLsizei, GLboolean, const GLdouble*) { ++calls; }
+}
+
+//----------------------------------------------
+
+void NullGL::Install()
+{
+  calls = 0;
+
+  // Shader's lifetime, activation and uniform uploads...
+  glCreateProgram = CreateProgram;
+  glDeleteProgram = DeleteProgram;
+  glUseProgram = UseProgram;
+  glUniform1iv = UniformIV;
+  glUniform1fv = UniformFV;
+  glUniform2fv = UniformFV;
+  glUniform3fv = UniformFV;
+  glUniform4fv = UniformFV;
+  glUniform1dv = UniformDV;
+  glUniform2dv = UniformDV;
+  glUniform3dv = UniformDV;
+  glUniform4dv = UniformDV;
+  glUniformMatrix3fv = UniformMatrixFV;
+  glUniformMatrix4fv = UniformMatrixFV;
+  glUniformMatrix3dv = UniformMatrixDV;
+  glUniformMatrix4dv = UniformMatrixDV;
+}
+
+int NullGL::Calls()
+{
+  return calls;
+}
@@ -0,0 +1,20 @@
+/// A stand-in for the GL driver, so that code which makes GL calls can be timed without a
+/// context and without the driver's own cost muddying the results.
+
+#if ! defined(__MICROBENCH_NULL_GL__)
+#define __MICROBENCH_NULL_GL__
+
+#include <theia/graphics/gl/gl_loader.h>
+
+namespace NullGL
+{
+  /// Point the GL functions used by the code under test at ones which do nothing but count
+  /// the calls. Any other GL function is left NULL, so calling one crashes rather than
+  /// silently timing nothing.
+  void Install();
+
+  /// GL calls made since Install.
+  int Calls();
+}
+
+#endif // __MICROBENCH_NULL_GL__
@@ -0,0 +1,379 @@
+/// Checks that the CPU noise functions agree with each other and with the GLSL they follow:
+/// the batched (SSE2 or AVX) Simplex and fBm against the scalar ones, fBm spread over a job
+/// system against scalar fBm, and GetHeightAt against the one in common.glsl, run by the grid
+/// compute shader. The shader comparison needs a headless GL context (a THEIA_EGL build) and
+/// is skipped without one. Prints the largest error of each check and fails if any is above
+/// the tolerance.
+///
+/// Usage:
+///   noisecheck [--points N] [--tolerance error] [--shaders dir]
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <theia/graphics/headless_context.h>
+#include <theia/graphics/shader.h>
+#include <theia/graphics/vertex_buffer.h>
+#include <theia/math/noise.h>
+#include <theia/misc/job_system.h>
+#include <theia/terrain/cube_sphere.h>
+#include <theia/terrain/gpu_grid_builder.h>
+
+//----------------------------------------------
+
+namespace
+{
+  struct Options
+  {
+    Options() : numPoints(100003), tolerance(1.0e-5f), shaderDir("theia_test/shaders") { }
+
+    int         numPoints;    // deliberately not a multiple of Noise::BatchSize
+    float       tolerance;
+    const char* shaderDir;
+  };
+
+  // The largest difference seen by one check, and where it was...
+  struct ErrorStats
+  {
+    ErrorStats() : maxError(0.0f), worst(0.0f), count(0) { }
+
+    void Add(const glm::vec3& P, float value, float reference)
+    {
+      const float error = fabsf(value - reference);
+      if (error > maxError)
+      {
+        maxError = error;
+        worst = P;
+      }
+      ++count;
+    }
+
+    float     maxError;
+    glm::vec3 worst;
+    size_t    count;
+  };
+}
+
+//----------------------------------------------
+
+static bool ReadFile(const char* path, std::string& text)
+{
+  FILE* file = fopen(path, "rb");
+  if (NULL == file)
+  {
+    fprintf(stderr, "unable to open %s\n", path);
+    return false;
+  }
+
+  char buffer[4096];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+  {
+    text.append(buffer, count);
+  }
+  fclose(file);
+  return true;
+}
+
+// A fixed sequence of points, so that every run checks the same ones...
+static void BuildPoints(int count, float scale, std::vector<glm::vec3>& points)
+{
+  uint32_t state = 12345;
+  points.resize(count);
+  for (int i = 0; i < count; ++i)
+  {
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      state = (state * 1664525u) + 1013904223u;
+      points[i][axis] = (((float)(state >> 8) / (float)(1 << 24)) * 2.0f - 1.0f) * scale;
+    }
+  }
+}
+
+static bool Report(const char* name, const ErrorStats& stats, float tolerance)
+{
+  const bool passed = (stats.maxError <= tolerance);
+  printf("  %-36s max error %-12g over %u points", name, stats.maxError, (unsigned int)stats.count);
+  if (stats.maxError > 0.0f)
+  {
+    printf(", worst at (%.9g, %.9g, %.9g)", stats.worst.x, stats.worst.y, stats.worst.z);
+  }
+  printf("%s\n", passed ? "" : "  FAILED");
+  return passed;
+}
+
+//----------------------------------------------
+
+// The batched functions take Noise::BatchSize points at a time as separate x, y and z
+// arrays. Points past the end of a short final batch repeat the last one...
+template <typename Batch>
+static void EvaluateBatches(const std::vector<glm::vec3>& points, const Batch& batch, std::vector<float>& results)
+{
+  results.resize(points.size());
+  for (size_t first = 0; first < points.size(); first += theia::Noise::BatchSize)
+  {
+    float x[theia::Noise::BatchSize];
+    float y[theia::Noise::BatchSize];
+    float z[theia::Noise::BatchSize];
+    float values[theia::Noise::BatchSize];
+    for (size_t i = 0; i < (size_t)theia::Noise::BatchSize; ++i)
+    {
+      const glm::vec3& P = points[std::min(first + i, points.size() - 1)];
+      x[i] = P.x;
+      y[i] = P.y;
+      z[i] = P.z;
+    }
+
+    batch(x, y, z, values);
+    for (size_t i = 0; (i < (size_t)theia::Noise::BatchSize) && ((first + i) < points.size()); ++i)
+    {
+      results[first + i] = values[i];
+    }
+  }
+}
+
+struct SimplexBatch
+{
+  void operator()(const float* x, const float* y, const float* z, float* result) const
+  {
+    theia::Noise::Simplex(x, y, z, result);
+  }
+};
+
+struct FractalBatch
+{
+  theia::Noise::FractalSettings settings;
+
+  void operator()(const float* x, const float* y, const float* z, float* result) const
+  {
+    theia::Noise::fBm(x, y, z, settings, result);
+  }
+};
+
+//----------------------------------------------
+
+// Compare the batched and threaded paths against the scalar functions they must match...
+static bool CheckBatches(const Options& options)
+{
+  bool passed = true;
+  const theia::Noise::FractalSettings settings;
+
+  // Simplex over a range which covers plenty of lattice cells, including negative ones...
+  std::vector<glm::vec3> points;
+  BuildPoints(options.numPoints, 100.0f, points);
+  {
+    std::vector<float> batched;
+    EvaluateBatches(points, SimplexBatch(), batched);
+
+    ErrorStats stats;
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+      stats.Add(points[i], batched[i], theia::Noise::Simplex(points[i]));
+    }
+    passed = Report("batched Simplex vs scalar", stats, options.tolerance) && passed;
+  }
+
+  // fBm on the unit sphere, where the terrain evaluates it...
+  for (size_t i = 0; i < points.size(); ++i)
+  {
+    points[i] = glm::normalize(points[i]);
+  }
+
+  std::vector<float> scalar(points.size());
+  for (size_t i = 0; i < points.size(); ++i)
+  {
+    scalar[i] = theia::Noise::fBm(points[i], settings);
+  }
+
+  {
+    FractalBatch batch;
+    batch.settings = settings;
+    std::vector<float> batched;
+    EvaluateBatches(points, batch, batched);
+
+    ErrorStats stats;
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+      stats.Add(points[i], batched[i], scalar[i]);
+    }
+    passed = Report("batched fBm vs scalar", stats, options.tolerance) && passed;
+  }
+
+  {
+    theia::JobSystemPtr jobs = theia::JobSystem::Create();
+    std::vector<float> threaded(points.size());
+    theia::Noise::fBm(jobs.get(), points.data(), points.size(), settings, threaded.data());
+
+    ErrorStats stats;
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+      stats.Add(points[i], threaded[i], scalar[i]);
+    }
+    passed = Report("fBm over the job system vs scalar", stats, options.tolerance) && passed;
+  }
+
+  return passed;
+}
+
+//----------------------------------------------
+
+// The noise isn't quite continuous: its kernels reach a little past the edges of a simplex
+// cell, so the value jumps as a point crosses from one cell into the next. A point within
+// rounding of an edge can land in either cell, and the shader compiler is free to fuse or
+// reorder the arithmetic which decides, so there the CPU and GPU can't be expected to agree.
+// Such a point is found by nudging it a few ulps along each axis...
+static bool IsOnSeam(const glm::vec3& P, float value, float tolerance)
+{
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    const float ulp = FLT_EPSILON * glm::max(fabsf(P[axis]), 1.0f);
+    for (int steps = -4; steps <= 4; ++steps)
+    {
+      glm::vec3 Q(P);
+      Q[axis] += (float)steps * ulp;
+      if (fabsf(theia::Noise::GetHeightAt(Q) - value) > tolerance)
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Compare GetHeightAt against the shader's, at the directions of a grid which the compute
+// shader builds along with the heights. The CPU is given the shader's own directions, so
+// that only the noise is compared...
+static bool CheckShader(const Options& options)
+{
+  if (!theia::HeadlessContext::IsSupported())
+  {
+    printf("  GetHeightAt vs common.glsl: skipped, this build has no headless GL context\n");
+    return true;
+  }
+
+  theia::HeadlessContextPtr context = theia::HeadlessContext::Create(16, 16);
+  if (!context)
+  {
+    printf("  GetHeightAt vs common.glsl: skipped, no GL context could be created\n");
+    return true;
+  }
+  if (!theia::terrain::GpuGridBuilder::IsSupported())
+  {
+    printf("  GetHeightAt vs common.glsl: skipped, the context has no compute shaders\n");
+    return true;
+  }
+
+  std::string commonSrc;
+  std::string computeSrc;
+  if (   !ReadFile((std::string(options.shaderDir) + "/common.glsl").c_str(), commonSrc)
+      || !ReadFile((std::string(options.shaderDir) + "/grid.cs.glsl").c_str(), computeSrc))
+  {
+    return false;
+  }
+
+  theia::ShaderPtr shader(new theia::Shader());
+  if (!shader->CompileCompute(commonSrc.c_str(), computeSrc.c_str()))
+  {
+    fprintf(stderr, "unable to compile the grid compute shader\n");
+    return false;
+  }
+  theia::terrain::GpuGridBuilderPtr builder = theia::terrain::GpuGridBuilder::Create(shader);
+  if (!builder)
+  {
+    return false;
+  }
+
+  // Enough vertices per face edge to cover about as many points as the other checks...
+  const int numFaces = theia::terrain::CubeSphere::NumFaces;
+  const int verticesPerEdge = glm::max(2, (int)sqrtf((float)options.numPoints / (float)numFaces));
+  const size_t numVertices = (size_t)verticesPerEdge * verticesPerEdge * numFaces;
+
+  theia::terrain::GridLayout layout(4 * sizeof(float));
+  layout.positionOffset = -1;
+  layout.normalOffset = 0;
+  layout.heightOffset = 3 * sizeof(float);
+
+  theia::VertexBufferPtr vertices = theia::VertexBuffer::Create(numVertices * layout.stride);
+  if (!builder->BuildFaces(*vertices, 0, verticesPerEdge, 1.0f, layout))
+  {
+    return false;
+  }
+
+  std::vector<glm::vec4> results(numVertices);
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+  glBindBuffer(GL_ARRAY_BUFFER, vertices->buffer);
+  glGetBufferSubData(GL_ARRAY_BUFFER, 0, numVertices * layout.stride, results.data());
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  ErrorStats stats;
+  ErrorStats seams;
+  for (size_t i = 0; i < numVertices; ++i)
+  {
+    const glm::vec3 N(results[i]);
+    const float height = theia::Noise::GetHeightAt(N);
+    if ((fabsf(height - results[i].w) > options.tolerance) && IsOnSeam(N, height, options.tolerance))
+    {
+      seams.Add(N, height, results[i].w);
+    }
+    else
+    {
+      stats.Add(N, height, results[i].w);
+    }
+  }
+
+  const bool passed = Report("GetHeightAt vs common.glsl", stats, options.tolerance);
+  if (seams.count > 0)
+  {
+    printf("  %-36s max error %-12g over %u points, not counted\n", "  on the seams between cells", seams.maxError, (unsigned int)seams.count);
+  }
+  return passed;
+}
+
+//----------------------------------------------
+
+int main(int argc, char* argv[])
+{
+  Options options;
+  for (int i = 1; i < argc; ++i)
+  {
+    if ((0 == strcmp("--points", argv[i])) && ((i + 1) < argc))
+    {
+      options.numPoints = atoi(argv[++i]);
+    }
+    else if ((0 == strcmp("--tolerance", argv[i])) && ((i + 1) < argc))
+    {
+      options.tolerance = (float)atof(argv[++i]);
+    }
+    else if ((0 == strcmp("--shaders", argv[i])) && ((i + 1) < argc))
+    {
+      options.shaderDir = argv[++i];
+    }
+    else
+    {
+      fprintf(stderr, "usage: noisecheck [--points N] [--tolerance error] [--shaders dir]\n");
+      return EXIT_FAILURE;
+    }
+  }
+  if (options.numPoints < 1)
+  {
+    fprintf(stderr, "at least one point is needed\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("noise tolerance %g, batches compiled for %s\n", options.tolerance, theia::Noise::BatchInstructionSet());
+  if (0 == strcmp("scalar", theia::Noise::BatchInstructionSet()))
+  {
+    printf("  the batch functions are scalar in this build, so only the shader comparison means anything\n");
+  }
+  bool passed = CheckBatches(options);
+  passed = CheckShader(options) && passed;
+
+  printf("%s\n", passed ? "passed" : "FAILED");
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,170 @@
+/// Reports how well a mesh's index order uses the post-transform vertex cache, before and
+/// after optimisation, and for OBJ meshes how much the compact vertex format saves.
+///
+/// Usage:
+///   vcache <file.obj> [cache size...]
+///   vcache --grid <vertices per edge> [cache size...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <theia/graphics/mesh_optimiser.h>
+#include <theia/graphics/obj_loader.h>
+#include <theia/graphics/vertex_layout.h>
+
+//----------------------------------------------
+
+static bool ReadFile(const char* path, std::string& text)
+{
+  FILE* file = fopen(path, "rb");
+  if (NULL == file)
+  {
+    fprintf(stderr, "unable to open %s\n", path);
+    return false;
+  }
+
+  char buffer[4096];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+  {
+    text.append(buffer, count);
+  }
+  fclose(file);
+  return true;
+}
+
+//----------------------------------------------
+
+// Build a grid the way the planet patches are: rows of quads, two triangles each...
+static void BuildGrid(int verticesPerEdge, std::vector<uint32_t>& indices)
+{
+  for (int y = 0; y < verticesPerEdge - 1; ++y)
+  {
+    for (int x = 0; x < verticesPerEdge - 1; ++x)
+    {
+      const uint32_t v00 = x + (y * verticesPerEdge);
+      const uint32_t v10 = v00 + 1;
+      const uint32_t v01 = v00 + verticesPerEdge;
+      const uint32_t v11 = v01 + 1;
+      indices.push_back(v00); indices.push_back(v01); indices.push_back(v10);
+      indices.push_back(v10); indices.push_back(v01); indices.push_back(v11);
+    }
+  }
+}
+
+//----------------------------------------------
+
+// Encode the mesh's vertices as theia::CompactVertex and measure what is lost...
+static void ReportCompaction(const theia::ObjMesh& mesh)
+{
+  std::vector<theia::CompactVertex> compact;
+  theia::VertexEncoding::PositionQuantiser quantiser;
+  theia::CompactMesh(mesh, compact, quantiser);
+
+  float positionError = 0.0f;
+  float normalError = 0.0f;
+  float texcoordError = 0.0f;
+  for (size_t i = 0; i < compact.size(); ++i)
+  {
+    positionError = glm::max(positionError, glm::length(quantiser.Decode(compact[i].position) - mesh.positions[i]));
+    if (i < mesh.normals.size())
+    {
+      normalError = glm::max(normalError, glm::length(theia::VertexEncoding::DecodeNormal(compact[i].normal) - glm::normalize(mesh.normals[i])));
+    }
+    if (i < mesh.texcoords.size())
+    {
+      const glm::vec2 uv(theia::VertexEncoding::HalfToFloat(compact[i].texcoord[0]), theia::VertexEncoding::HalfToFloat(compact[i].texcoord[1]));
+      texcoordError = glm::max(texcoordError, glm::length(uv - mesh.texcoords[i]));
+    }
+  }
+
+  const size_t fullSize = sizeof(glm::vec3) + (mesh.normals.empty() ? 0 : sizeof(glm::vec3)) + (mesh.texcoords.empty() ? 0 : sizeof(glm::vec2));
+  const glm::vec3 extent(quantiser.extent);
+  printf("vertex size %u -> %u bytes\n", (unsigned int)fullSize, (unsigned int)sizeof(theia::CompactVertex));
+  printf("  max error: position %g (%.5f%% of the bounds), normal %g, texcoord %g\n",
+    positionError, 100.0f * positionError / glm::max(extent.x, glm::max(extent.y, extent.z)), normalError, texcoordError);
+}
+
+//----------------------------------------------
+
+static void Report(const char* name, const theia::MeshOptimiser::CacheStats& stats)
+{
+  printf("  %-10s ACMR %.3f  ATVR %.3f  (%u transforms)\n", name, stats.acmr, stats.atvr, (unsigned int)stats.transforms);
+}
+
+//----------------------------------------------
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: vcache <file.obj> [cache size...]\n");
+    fprintf(stderr, "       vcache --grid <vertices per edge> [cache size...]\n");
+    return EXIT_FAILURE;
+  }
+
+  std::vector<uint32_t> indices;
+  size_t numVertices = 0;
+  int nextArg = 2;
+
+  if (0 == strcmp("--grid", argv[1]))
+  {
+    const int verticesPerEdge = (argc > 2) ? atoi(argv[2]) : 0;
+    if (verticesPerEdge < 2)
+    {
+      fprintf(stderr, "a grid needs at least 2 vertices per edge\n");
+      return EXIT_FAILURE;
+    }
+    BuildGrid(verticesPerEdge, indices);
+    numVertices = verticesPerEdge * verticesPerEdge;
+    nextArg = 3;
+  }
+  else
+  {
+    std::string text;
+    theia::ObjMesh mesh;
+    if (!ReadFile(argv[1], text) || !theia::ReadOBJ(text.c_str(), mesh))
+    {
+      return EXIT_FAILURE;
+    }
+    ReportCompaction(mesh);
+    indices.swap(mesh.indices);
+    numVertices = mesh.positions.size();
+  }
+
+  std::vector<int> cacheSizes;
+  for (int i = nextArg; i < argc; ++i)
+  {
+    cacheSizes.push_back(atoi(argv[i]));
+  }
+  if (cacheSizes.empty())
+  {
+    cacheSizes.push_back(8);
+    cacheSizes.push_back(16);
+    cacheSizes.push_back(theia::MeshOptimiser::DefaultCacheSize);
+    cacheSizes.push_back(32);
+  }
+
+  printf("%u vertices, %u triangles\n", (unsigned int)numVertices, (unsigned int)(indices.size() / 3));
+
+  std::vector<uint32_t> optimised(indices.size());
+  for (size_t i = 0; i < cacheSizes.size(); ++i)
+  {
+    const int cacheSize = cacheSizes[i];
+    if (cacheSize < 3)
+    {
+      fprintf(stderr, "ignoring cache size %d\n", cacheSize);
+      continue;
+    }
+
+    theia::MeshOptimiser::OptimiseTriangleList(indices.data(), indices.size(), numVertices, cacheSize, optimised.data());
+
+    printf("cache size %d:\n", cacheSize);
+    Report("original", theia::MeshOptimiser::AnalyseCache(indices.data(), indices.size(), numVertices, cacheSize));
+    Report("optimised", theia::MeshOptimiser::AnalyseCache(optimised.data(), optimised.size(), numVertices, cacheSize));
+  }
+
+  return EXIT_SUCCESS;
+}